@@ -49,6 +49,12 @@ enum {
 	OPTION_PROGRESS,
 	OPTION_SACRIFICE_RATIO,
 	OPTION_READ_REPEATED,
+	OPTION_MINIMAL_PREREAD,
+	OPTION_SHADOW_CACHE,
+	OPTION_VERIFY_CHANGED,
+	OPTION_TIME_OPTIMAL_ERASE,
+	OPTION_SFDP,
+	OPTION_BATCH,
 #if CONFIG_RPMC_ENABLED == 1
 	OPTION_RPMC_READ_DATA,
 	OPTION_RPMC_WRITE_ROOT_KEY,
@@ -61,14 +67,24 @@ enum {
 #endif /* CONFIG_RPMC_ENABLED */
 };
 
+#define MAX_CLI_PROGRAMMERS 32
+
 struct cli_options {
 	bool read_it, extract_it, write_it, erase_it, verify_it;
-	bool dont_verify_it, dont_verify_all;
+	bool dont_verify_it, dont_verify_all, verify_changed;
+	bool minimal_preread;
+	bool time_optimal_erase;
+	bool use_sfdp;
 	bool list_supported;
+	bool print_help, print_version;
 	char *filename;
 
-	const struct programmer_entry *prog;
-	char *pparam;
+	/* Programmers given with -p. With more than one, the operation runs on each of them in turn. */
+	struct cli_programmer {
+		const struct programmer_entry *prog;
+		char *pparam;
+	} programmers[MAX_CLI_PROGRAMMERS];
+	size_t programmer_count;
 
 	bool ifd, fmap, fmap_verify;
 	struct flashrom_layout *layout;
@@ -86,6 +102,11 @@ struct cli_options {
 	bool show_progress;
 	char *logfile;
 	char *referencefile;
+	char *shadow_cache_dir;
+	char *batchfile;
+	/* Operations read from the batch file, run in one programmer session. */
+	struct cli_options *batch;
+	size_t batch_len;
 	const char *chip_to_probe;
 	int sacrifice_ratio;
 	int read_repeated;
@@ -125,6 +146,8 @@ static void cli_classic_usage(const char *name)
 	       " -f | --force                       force specific operations (see man page)\n"
 	       " -n | --noverify                    don't auto-verify\n"
 	       " -N | --noverify-all                verify included regions only (cf. -i)\n"
+	       "      --verify-changed              only verify blocks changed by the write, plus\n"
+	       "                                    a few samples of the unchanged ones\n"
 	       " -x | --extract                     extract regions to files\n"
 	       " -l | --layout <layoutfile>         read ROM layout from <layoutfile>\n"
 	       "      --wp-disable                  disable write protection\n"
@@ -145,6 +168,12 @@ static void cli_classic_usage(const char *name)
 	       "      --image <region>[:<file>]     deprecated, please use --include\n"
 	       " -o | --output <logfile>            log output to <logfile>\n"
 	       "      --flash-contents <ref-file>   assume flash contents to be <ref-file>\n"
+	       "      --minimal-preread             before writing, only read the parts of the\n"
+	       "                                    included regions needed to plan the write\n"
+	       "      --shadow-cache <dir>          keep a copy of the flash contents in <dir> and use\n"
+	       "                                    it as reference contents on later writes\n"
+	       "      --batch <file>|-              run the operations from <file> (one per line)\n"
+	       "                                    in a single programmer session\n"
 	       " -L | --list-supported              print supported devices\n"
 	       "      --progress                    show progress percentage on the standard output\n"
 	       "      --sacrifice-ratio <ratio>     Fraction (as a percentage, 0-50) of an erase block\n"
@@ -154,7 +183,11 @@ static void cli_classic_usage(const char *name)
 	       "				    Default is 0, tradeoff is the speed of programming\n"
 	       "                                    operation VS the longevity of the chip. Default is\n"
 	       "                                    longevity.\n"
+	       "      --time-optimal-erase          choose erase blocks by estimated total time instead\n"
+	       "                                    of --sacrifice-ratio (wears the chip faster)\n"
 	       "                                    DANGEROUS! It wears your chip faster!\n"
+	       "      --sfdp                        complete the chip's database entry with its\n"
+	       "                                    SFDP parameters (timings, fast reads)\n"
 	       "      --read-repeated[=<count>] [<file>]\n"
 	       "                                    read flash <count> times (default: 3,\n"
 	       "                                    min: 3, max: 100) and use majority\n"
@@ -175,7 +208,8 @@ static void cli_classic_usage(const char *name)
 	       "      --key-data <value>            hex number to use as key data (default: 0)\n"
 #endif /* CONFIG_RPMC_ENABLED */
 	       "PROGRAMMER SELECTION OPTIONS\n"
-	       " -p | --programmer <name>[:<param>] specify the programmer device. One of\n");
+	       " -p | --programmer <name>[:<param>] specify the programmer device, may be given more\n"
+	       "                                    than once to run the operation on each of them. One of\n");
 	list_programmers_linebreak(4, 80, 0);
 	printf(".\n\nYou can specify one of -h, -R, -L, -E, -r, -w, -v"
 #if CONFIG_RPMC_ENABLED == 1
@@ -193,11 +227,28 @@ static void cli_classic_abort_usage(const char *msg)
 	exit(1);
 }
 
-static void cli_classic_validate_singleop(int *operation_specified)
+/*
+ * Reports invalid options. On the command line (batch_line is 0) this exits,
+ * for a line of a batch file it returns 1 so that the caller can clean up.
+ */
+static int cli_classic_parse_error(unsigned int batch_line, const char *msg)
 {
-	if (++(*operation_specified) > 1) {
-		cli_classic_abort_usage("More than one operation specified. Aborting.\n");
-	}
+	if (!batch_line)
+		cli_classic_abort_usage(msg);
+
+	if (!msg)
+		msg = "Invalid arguments.\n";
+	else if (!strncmp(msg, "Error: ", strlen("Error: ")))
+		msg += strlen("Error: ");
+	msg_gerr("Error: Batch file line %u: %s", batch_line, msg);
+	return 1;
+}
+
+static int cli_classic_validate_singleop(int *operation_specified, unsigned int batch_line)
+{
+	if (++(*operation_specified) > 1)
+		return cli_classic_parse_error(batch_line, "More than one operation specified. Aborting.\n");
+	return 0;
 }
 
 static int check_filename(char *filename, const char *type)
@@ -671,7 +722,51 @@ static int do_read_repeated(struct flashctx *const flash, int count, const char
 	return ret;
 }
 
-static int do_read(struct flashctx *const flash, const char *const filename)
+static bool any_wp_op(const struct cli_options *options)
+{
+	return options->set_wp_range || options->set_wp_region || options->enable_wp ||
+		options->disable_wp || options->print_wp_status || options->print_wp_ranges;
+}
+
+static bool any_rpmc_op(const struct cli_options *options)
+{
+#if CONFIG_RPMC_ENABLED == 1
+	return options->rpmc_read_data || options->rpmc_write_root_key || options->rpmc_update_hmac_key ||
+		options->rpmc_increment_counter || options->rpmc_get_counter;
+#else
+	return false;
+#endif /* CONFIG_RPMC_ENABLED */
+}
+
+static bool any_op(const struct cli_options *options)
+{
+	return options->read_it || options->write_it || options->verify_it ||
+		options->erase_it || options->flash_name || options->flash_size ||
+		options->extract_it || any_wp_op(options) || any_rpmc_op(options) ||
+		options->read_repeated > 0;
+}
+
+/* Remembers `buf` as the chip contents for later steps of a batch, if `known` is given. */
+static void remember_contents(uint8_t **known, const uint8_t *buf, size_t size)
+{
+	if (!known)
+		return;
+	if (!*known)
+		*known = malloc(size);
+	if (*known)
+		memcpy(*known, buf, size);
+}
+
+static void forget_contents(uint8_t **known)
+{
+	if (!known)
+		return;
+	free(*known);
+	*known = NULL;
+}
+
+static int do_read(struct flashctx *const flash, const char *const filename, const char *const cachefile,
+		   uint8_t **known)
 {
 	int ret;
 
@@ -690,6 +785,10 @@ static int do_read(struct flashctx *const flash, const char *const filename)
 	}
 	if (filename)
 		ret = write_buf_to_file(buf, size, filename);
+	if (!ret && cachefile)
+		shadow_cache_store(cachefile, buf, size);
+	if (!ret)
+		remember_contents(known, buf, size);
 
 free_out:
 	free(buf);
@@ -699,18 +798,26 @@ free_out:
 static int do_extract(struct flashctx *const flash)
 {
 	prepare_layout_for_extraction(flash);
-	return do_read(flash, NULL);
+	return do_read(flash, NULL, NULL, NULL);
 }
 
-static int do_write(struct flashctx *const flash, const char *const filename, const char *const referencefile)
+/*
+ * `cachefile` is the shadow cache entry for the chip (or NULL). It is used as
+ * reference contents if no `referencefile` is given and updated after a
+ * verified write if `full_image` is set, i.e. no layout is in use. Contents
+ * known from an earlier batch step (`known`) take precedence over the cache.
+ */
+static int do_write(struct flashctx *const flash, const char *const filename, const char *const referencefile,
+		    const char *const cachefile, bool full_image, uint8_t **known)
 {
 	const size_t flash_size = flashrom_flash_getsize(flash);
+	const bool have_known = known && *known;
 	int ret = 1;
 
 	uint8_t *const newcontents = alloc_flashsize_buf(flash);
-	uint8_t *const refcontents = referencefile ? alloc_flashsize_buf(flash) : NULL;
+	uint8_t *refcontents = (referencefile || cachefile || have_known) ? alloc_flashsize_buf(flash) : NULL;
 
-	if (!newcontents || (referencefile && !refcontents))
+	if (!newcontents || ((referencefile || cachefile || have_known) && !refcontents))
 		goto _free_ret;
 
 	/* Read '-w' argument first... */
@@ -728,17 +835,43 @@ static int do_write(struct flashctx *const flash, const char *const filename, co
 	if (referencefile) {
 		if (read_buf_from_file(refcontents, flash_size, referencefile))
 			goto _free_ret;
+	} else if (have_known) {
+		msg_cinfo("Using flash contents from the previous batch step as reference.\n");
+		memcpy(refcontents, *known, flash_size);
+	} else if (cachefile && shadow_cache_load(flash, cachefile, refcontents, flash_size)) {
+		free(refcontents);
+		refcontents = NULL;
 	}
 
+	/* The chip contents are about to change, an interrupted write must not leave a stale entry. */
+	if (cachefile)
+		shadow_cache_drop(cachefile);
+
 	ret = flashrom_image_write(flash, newcontents, flash_size, refcontents);
 
+	if (!ret && cachefile && full_image && flashrom_flag_get(flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE))
+		shadow_cache_store(cachefile, newcontents, flash_size);
+
+	/* Only verified contents are passed on, and only regions that were written change. */
+	if (ret || !flashrom_flag_get(flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE)) {
+		forget_contents(known);
+	} else if (full_image) {
+		remember_contents(known, newcontents, flash_size);
+	} else if (have_known) {
+		const struct romentry *entry = NULL;
+		while ((entry = layout_next_included(get_layout(flash), entry)))
+			memcpy(*known + entry->region.start, newcontents + entry->region.start,
+			       entry->region.end - entry->region.start + 1);
+	}
+
 _free_ret:
 	free(refcontents);
 	free(newcontents);
 	return ret;
 }
 
-static int do_verify(struct flashctx *const flash, const char *const filename)
+static int do_verify(struct flashctx *const flash, const char *const filename, const char *const cachefile,
+		     uint8_t **known)
 {
 	const size_t flash_size = flashrom_flash_getsize(flash);
 	int ret = 1;
@@ -760,6 +893,10 @@ static int do_verify(struct flashctx *const flash, const char *const filename)
 		goto _free_ret;
 
 	ret = flashrom_image_verify(flash, newcontents, flash_size);
+	if (!ret && cachefile)
+		shadow_cache_store(cachefile, newcontents, flash_size);
+	if (!ret)
+		remember_contents(known, newcontents, flash_size);
 
 _free_ret:
 	free(newcontents);
@@ -810,9 +947,13 @@ static unsigned int count_max_decode_exceedings(const struct flashctx *flash,
 	return limitexceeded;
 }
 
-static void parse_options(int argc, char **argv, const char *optstring,
-			  const struct option *long_options,
-			  struct cli_options *options)
+/*
+ * Parses the options of the command line, or of line batch_line of a batch
+ * file. Only the command line exits on errors, see cli_classic_parse_error().
+ */
+static int parse_options(int argc, char **argv, const char *optstring,
+			 const struct option *long_options,
+			 struct cli_options *options, unsigned int batch_line)
 {
 	const char *name;
 	int namelen, opt;
@@ -825,27 +966,30 @@ static void parse_options(int argc, char **argv, const char *optstring,
 				  long_options, &option_index)) != EOF) {
 		switch (opt) {
 		case 'r':
-			cli_classic_validate_singleop(&operation_specified);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
 			options->filename = get_optional_filename(argv);
 			options->read_it = true;
 			break;
 		case 'w':
-			cli_classic_validate_singleop(&operation_specified);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
 			options->filename = get_optional_filename(argv);
 			options->write_it = true;
 			break;
 		case 'v':
 			//FIXME: gracefully handle superfluous -v
-			cli_classic_validate_singleop(&operation_specified);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
 			if (options->dont_verify_it) {
-				cli_classic_abort_usage("--verify and --noverify are mutually exclusive. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "--verify and --noverify are mutually exclusive. Aborting.\n");
 			}
 			options->filename = get_optional_filename(argv);
 			options->verify_it = true;
 			break;
 		case 'n':
 			if (options->verify_it) {
-				cli_classic_abort_usage("--verify and --noverify are mutually exclusive. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "--verify and --noverify are mutually exclusive. Aborting.\n");
 			}
 			options->dont_verify_it = true;
 			break;
@@ -853,7 +997,8 @@ static void parse_options(int argc, char **argv, const char *optstring,
 			options->dont_verify_all = true;
 			break;
 		case 'x':
-			cli_classic_validate_singleop(&operation_specified);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
 			options->extract_it = true;
 			break;
 		case 'c':
@@ -865,7 +1010,8 @@ static void parse_options(int argc, char **argv, const char *optstring,
 				verbose_logfile = verbose_screen;
 			break;
 		case 'E':
-			cli_classic_validate_singleop(&operation_specified);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
 			options->erase_it = true;
 			break;
 		case 'f':
@@ -873,70 +1019,72 @@ static void parse_options(int argc, char **argv, const char *optstring,
 			break;
 		case 'l':
 			if (options->layoutfile)
-				cli_classic_abort_usage("Error: --layout specified more than once. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --layout specified more than once. Aborting.\n");
 			if (options->ifd)
-				cli_classic_abort_usage("Error: --layout and --ifd both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --layout and --ifd both specified. Aborting.\n");
 			if (options->fmap)
-				cli_classic_abort_usage("Error: --layout and --fmap-file both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --layout and --fmap-file both specified. Aborting.\n");
 			options->layoutfile = strdup(optarg);
 			break;
 		case OPTION_IFD:
 			if (options->layoutfile)
-				cli_classic_abort_usage("Error: --layout and --ifd both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --layout and --ifd both specified. Aborting.\n");
 			if (options->fmap)
-				cli_classic_abort_usage("Error: --fmap-file and --ifd both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap-file and --ifd both specified. Aborting.\n");
 			options->ifd = true;
 			break;
 		case OPTION_FMAP_FILE:
 			if (options->fmap)
-				cli_classic_abort_usage("Error: --fmap, --fmap-file, or --fmap-verify specified "
-					"more than once. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap, --fmap-file, or --fmap-verify specified "
+							       "more than once. Aborting.\n");
 			if (options->ifd)
-				cli_classic_abort_usage("Error: --fmap-file and --ifd both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap-file and --ifd both specified. Aborting.\n");
 			if (options->layoutfile)
-				cli_classic_abort_usage("Error: --fmap-file and --layout both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap-file and --layout both specified. Aborting.\n");
 			options->fmapfile = strdup(optarg);
 			options->fmap = true;
 			break;
 		case OPTION_FMAP:
 			if (options->fmap)
-				cli_classic_abort_usage("Error: --fmap, --fmap-file, or --fmap-verify specified "
-					"more than once. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap, --fmap-file, or --fmap-verify specified "
+							       "more than once. Aborting.\n");
 			if (options->ifd)
-				cli_classic_abort_usage("Error: --fmap and --ifd both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap and --ifd both specified. Aborting.\n");
 			if (options->layoutfile)
-				cli_classic_abort_usage("Error: --layout and --fmap both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --layout and --fmap both specified. Aborting.\n");
 			options->fmap = true;
 			break;
 		case OPTION_FMAP_VERIFY:
 			if (options->fmap)
-				cli_classic_abort_usage("Error: --fmap, --fmap-file, or --fmap-verify specified "
-					"more than once. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap, --fmap-file, or --fmap-verify specified "
+							       "more than once. Aborting.\n");
 			if (options->ifd)
-				cli_classic_abort_usage("Error: --fmap-verify and --ifd both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap-verify and --ifd both specified. Aborting.\n");
 			if (options->layoutfile)
-				cli_classic_abort_usage("Error: --fmap-verify and --layout both specified. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap-verify and --layout both specified. Aborting.\n");
 			if (options->read_it || options->verify_it)
-				cli_classic_abort_usage("Error: --fmap-verify cannot be used with read or verify operations. Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --fmap-verify cannot be used with read or verify operations. Aborting.\n");
 			options->fmap = true;
 			options->fmap_verify = true;
 			break;
 		case 'i':
 			if (register_include_arg(&options->include_args, optarg))
-				cli_classic_abort_usage(NULL);
+				return cli_classic_parse_error(batch_line, NULL);
 			break;
 		case OPTION_FLASH_CONTENTS:
 			if (options->referencefile)
-				cli_classic_abort_usage("Error: --flash-contents specified more than once."
-							"Aborting.\n");
+				return cli_classic_parse_error(batch_line, "Error: --flash-contents specified more than once."
+							       "Aborting.\n");
 			options->referencefile = strdup(optarg);
 			break;
 		case OPTION_FLASH_NAME:
-			cli_classic_validate_singleop(&operation_specified);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
 			options->flash_name = true;
 			break;
 		case OPTION_FLASH_SIZE:
-			cli_classic_validate_singleop(&operation_specified);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
 			options->flash_size = true;
 			break;
 		case OPTION_WP_STATUS:
@@ -947,7 +1095,7 @@ static void parse_options(int argc, char **argv, const char *optstring,
 			break;
 		case OPTION_WP_SET_RANGE:
 			if (parse_wp_range(&options->wp_start, &options->wp_len) < 0)
-				cli_classic_abort_usage("Incorrect wp-range arguments provided.\n");
+				return cli_classic_parse_error(batch_line, "Incorrect wp-range arguments provided.\n");
 
 			options->set_wp_range = true;
 			break;
@@ -962,17 +1110,16 @@ static void parse_options(int argc, char **argv, const char *optstring,
 			options->disable_wp = true;
 			break;
 		case 'L':
-			cli_classic_validate_singleop(&operation_specified);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
 			options->list_supported = true;
 			break;
 		case 'p':
-			if (options->prog != NULL) {
-				cli_classic_abort_usage("Error: --programmer specified "
-					"more than once. You can separate "
-					"multiple\nparameters for a programmer "
-					"with \",\". Please see the man page "
-					"for details.\n");
+			if (options->programmer_count == MAX_CLI_PROGRAMMERS) {
+				return cli_classic_parse_error(batch_line, "Error: --programmer specified "
+							       "too many times.\n");
 			}
+			struct cli_programmer *const cp = &options->programmers[options->programmer_count];
 			size_t p;
 			for (p = 0; p < programmer_table_size; p++) {
 				name = programmer_table[p]->name;
@@ -980,15 +1127,15 @@ static void parse_options(int argc, char **argv, const char *optstring,
 				if (strncmp(optarg, name, namelen) == 0) {
 					switch (optarg[namelen]) {
 					case ':':
-						options->pparam = strdup(optarg + namelen + 1);
-						if (!strlen(options->pparam)) {
-							free(options->pparam);
-							options->pparam = NULL;
+						cp->pparam = strdup(optarg + namelen + 1);
+						if (!strlen(cp->pparam)) {
+							free(cp->pparam);
+							cp->pparam = NULL;
 						}
-						options->prog = programmer_table[p];
+						cp->prog = programmer_table[p];
 						break;
 					case '\0':
-						options->prog = programmer_table[p];
+						cp->prog = programmer_table[p];
 						break;
 					default:
 						/* The continue refers to the
@@ -1001,23 +1148,31 @@ static void parse_options(int argc, char **argv, const char *optstring,
 					break;
 				}
 			}
-			if (options->prog == NULL) {
+			if (cp->prog == NULL) {
 				fprintf(stderr, "Error: Unknown programmer \"%s\". Valid choices are:\n",
 					optarg);
 				list_programmers_linebreak(0, 80, 0);
 				msg_ginfo(".\n");
-				cli_classic_abort_usage(NULL);
+				return cli_classic_parse_error(batch_line, NULL);
 			}
+			options->programmer_count++;
 			break;
 		case 'R':
 			/* print_version() is always called during startup. */
-			cli_classic_validate_singleop(&operation_specified);
-			exit(0);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
+			options->print_version = true;
+			if (!batch_line)
+				exit(0);
 			break;
 		case 'h':
-			cli_classic_validate_singleop(&operation_specified);
-			cli_classic_usage(argv[0]);
-			exit(0);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
+			options->print_help = true;
+			if (!batch_line) {
+				cli_classic_usage(argv[0]);
+				exit(0);
+			}
 			break;
 		case 'o':
 			if (options->logfile) {
@@ -1027,7 +1182,7 @@ static void parse_options(int argc, char **argv, const char *optstring,
 
 			options->logfile = strdup(optarg);
 			if (options->logfile[0] == '\0') {
-				cli_classic_abort_usage("No log filename specified.\n");
+				return cli_classic_parse_error(batch_line, "No log filename specified.\n");
 			}
 			break;
 		case OPTION_PROGRESS:
@@ -1037,14 +1192,38 @@ static void parse_options(int argc, char **argv, const char *optstring,
 			/* It is okay to convert invalid input to 0. */
 			options->sacrifice_ratio = atoi(optarg);
 			break;
+		case OPTION_MINIMAL_PREREAD:
+			options->minimal_preread = true;
+			break;
+		case OPTION_TIME_OPTIMAL_ERASE:
+			options->time_optimal_erase = true;
+			break;
+		case OPTION_SFDP:
+			options->use_sfdp = true;
+			break;
+		case OPTION_VERIFY_CHANGED:
+			options->verify_changed = true;
+			break;
+		case OPTION_BATCH:
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
+			options->batchfile = strdup(optarg);
+			break;
+		case OPTION_SHADOW_CACHE:
+			if (options->shadow_cache_dir)
+				return cli_classic_parse_error(batch_line, "Error: --shadow-cache specified more than once."
+							       "Aborting.\n");
+			options->shadow_cache_dir = strdup(optarg);
+			break;
 		case OPTION_READ_REPEATED:
-			cli_classic_validate_singleop(&operation_specified);
+			if (cli_classic_validate_singleop(&operation_specified, batch_line))
+				return 1;
 			if (optarg) {
 				char *end;
 				long val = strtol(optarg, &end, 10);
 				if (*end != '\0' || val < 3 || val > 100) {
 					msg_gerr("Error: --read-repeated count must be between 3 and 100.\n");
-					cli_classic_abort_usage(NULL);
+					return cli_classic_parse_error(batch_line, NULL);
 				}
 				options->read_repeated = (int)val;
 			} else {
@@ -1080,13 +1259,13 @@ static void parse_options(int argc, char **argv, const char *optstring,
 			break;
 #endif /* CONFIG_RPMC_ENABLED */
 		default:
-			cli_classic_abort_usage(NULL);
-			break;
+			return cli_classic_parse_error(batch_line, NULL);
 		}
 	}
 
 	if (optind < argc)
-		cli_classic_abort_usage("Error: Extra parameter found.\n");
+		return cli_classic_parse_error(batch_line, "Error: Extra parameter found.\n");
+	return 0;
 }
 
 static void free_options(struct cli_options *options)
@@ -1095,324 +1274,169 @@ static void free_options(struct cli_options *options)
 	free(options->filename);
 	free(options->fmapfile);
 	free(options->referencefile);
+	free(options->shadow_cache_dir);
+	free(options->batchfile);
+	for (size_t i = 0; i < options->batch_len; i++) {
+		flashrom_layout_release(options->batch[i].layout);
+		free_options(&options->batch[i]);
+	}
+	free(options->batch);
 	free(options->layoutfile);
-	free(options->pparam);
+	for (size_t i = 0; i < options->programmer_count; i++)
+		free(options->programmers[i].pparam);
 	free(options->wp_region);
 	free(options->logfile);
 	free((char *)options->chip_to_probe);
 }
 
-int main(int argc, char *argv[])
+/* With more than one programmer, all of them would write the same files or read standard input. */
+static void check_multi_programmer_options(const struct cli_options *options)
 {
-	const struct flashchip *chip = NULL;
-	char *tempstr = NULL;
-	int i, j;
-	int ret = 0;
-	int all_matched_count = 0;
-	const char **all_matched_names = NULL;
-	time_t time_start = 0, time_end = 0;
+	if (options->read_it || options->extract_it || options->read_repeated > 0)
+		cli_classic_abort_usage("Error: Reading is not supported with more than one programmer.\n");
+	if (options->filename && !strcmp(options->filename, "-"))
+		cli_classic_abort_usage("Error: Standard input can only be used with a single programmer.\n");
+}
 
-	struct flashctx *context = NULL; /* holds the active detected chip and other info */
-	ret = flashrom_create_context(&context);
-	if (ret) {
-		msg_gerr("Failed to allocate flash context. Aborting");
+static int check_batch_step(const struct cli_options *options, struct cli_options *step, unsigned int line)
+{
+	if (step->programmer_count || step->chip_to_probe || step->logfile || step->list_supported ||
+	    step->print_help || step->print_version || step->batchfile) {
+		msg_gerr("Error: Batch file line %u: --programmer, --chip, --output, --list-supported, --help, "
+			 "--version and --batch can only be used on the command line.\n", line);
 		return 1;
 	}
-
-	struct cli_options options = { 0 };
-	static const char optstring[] = "r::Rw::v::nNVEfc:l:i:p:Lzho:x";
-	static const struct option long_options[] = {
-		{"read",		2, NULL, 'r'},
-		{"write",		2, NULL, 'w'},
-		{"erase",		0, NULL, 'E'},
-		{"verify",		2, NULL, 'v'},
-		{"noverify",		0, NULL, 'n'},
-		{"noverify-all",	0, NULL, 'N'},
-		{"extract",		0, NULL, 'x'},
-		{"chip",		1, NULL, 'c'},
-		{"verbose",		0, NULL, 'V'},
-		{"force",		0, NULL, 'f'},
-		{"layout",		1, NULL, 'l'},
-		{"ifd",			0, NULL, OPTION_IFD},
-		{"fmap",		0, NULL, OPTION_FMAP},
-		{"fmap-file",		1, NULL, OPTION_FMAP_FILE},
-		{"fmap-verify",		0, NULL, OPTION_FMAP_VERIFY},
-		{"image",		1, NULL, 'i'}, // (deprecated): back compatibility.
-		{"include",		1, NULL, 'i'},
-		{"flash-contents",	1, NULL, OPTION_FLASH_CONTENTS},
-		{"flash-name",		0, NULL, OPTION_FLASH_NAME},
-		{"flash-size",		0, NULL, OPTION_FLASH_SIZE},
-		{"get-size",		0, NULL, OPTION_FLASH_SIZE}, // (deprecated): back compatibility.
-		{"wp-status",		0, NULL, OPTION_WP_STATUS},
-		{"wp-list",		0, NULL, OPTION_WP_LIST},
-		{"wp-range",		1, NULL, OPTION_WP_SET_RANGE},
-		{"wp-region",		1, NULL, OPTION_WP_SET_REGION},
-		{"wp-enable",		0, NULL, OPTION_WP_ENABLE},
-		{"wp-disable",		0, NULL, OPTION_WP_DISABLE},
-		{"list-supported",	0, NULL, 'L'},
-		{"programmer",		1, NULL, 'p'},
-		{"help",		0, NULL, 'h'},
-		{"version",		0, NULL, 'R'},
-		{"output",		1, NULL, 'o'},
-		{"progress",		0, NULL, OPTION_PROGRESS},
-		{"sacrifice-ratio",	1, NULL, OPTION_SACRIFICE_RATIO},
-		{"read-repeated",	2, NULL, OPTION_READ_REPEATED},
-#if CONFIG_RPMC_ENABLED == 1
-		{"get-rpmc-status",	0, NULL, OPTION_RPMC_READ_DATA},
-		{"write-root-key",	0, NULL, OPTION_RPMC_WRITE_ROOT_KEY},
-		{"update-hmac-key",	0, NULL, OPTION_RPMC_UPDATE_HMAC_KEY},
-		{"increment-counter",	1, NULL, OPTION_RPMC_INCREMENT_COUNTER},
-		{"get-counter",		0, NULL, OPTION_RPMC_GET_COUNTER},
-		{"counter-address",	1, NULL, OPTION_RPMC_COUNTER_ADDRESS},
-		{"key-data",		1, NULL, OPTION_RPMC_KEY_DATA},
-		{"rpmc-root-key",	1, NULL, OPTION_RPMC_KEY_FILE},
-#endif /* CONFIG_RPMC_ENABLED */
-		{NULL,			0, NULL, 0},
-	};
-
-	/*
-	 * Safety-guard against a user who has (mistakenly) closed
-	 * stdout or stderr before exec'ing flashrom.  We disable
-	 * logging in this case to prevent writing log data to a flash
-	 * chip when a flash device gets opened with fd 1 or 2.
-	 */
-	if (check_file(stdout) && check_file(stderr)) {
-		/* This is maximum log level for callback to be invoked,
-		 * and cli wants callback to be always invoked. */
-		flashrom_set_log_level(FLASHROM_MSG_SPEW);
-		flashrom_set_log_callback(&flashrom_print_cb);
+	if (step->filename && !strcmp(step->filename, "-")) {
+		msg_gerr("Error: Batch file line %u: Standard input can not be used in a batch.\n", line);
+		return 1;
 	}
+	if ((step->filename && check_filename(step->filename, "image")) ||
+	    (step->layoutfile && check_filename(step->layoutfile, "layout")) ||
+	    (step->fmapfile && check_filename(step->fmapfile, "fmap")) ||
+	    (step->referencefile && check_filename(step->referencefile, "reference")) ||
+	    (step->shadow_cache_dir && check_filename(step->shadow_cache_dir, "shadow cache")))
+		return 1;
+	if (options->programmer_count > 1)
+		check_multi_programmer_options(step);
 
-	print_version();
-	print_banner();
+	if (step->layoutfile && layout_from_file(&step->layout, step->layoutfile))
+		return 1;
+	if (!step->ifd && !step->fmap && process_include_args(step->layout, step->include_args))
+		return 1;
 
-	setbuf(stdout, NULL);
+	step->force |= options->force;
+	return 0;
+}
 
-	parse_options(argc, argv, optstring, long_options, &options);
+#define BATCH_LINE_MAX	4096
+#define BATCH_ARGS_MAX	64
 
-	if (options.filename && check_filename(options.filename, "image"))
-		cli_classic_abort_usage(NULL);
-	if (options.layoutfile && check_filename(options.layoutfile, "layout"))
-		cli_classic_abort_usage(NULL);
-	if (options.fmapfile && check_filename(options.fmapfile, "fmap"))
-		cli_classic_abort_usage(NULL);
-	if (options.referencefile && check_filename(options.referencefile, "reference"))
-		cli_classic_abort_usage(NULL);
-	if (options.logfile && check_filename(options.logfile, "log"))
-		cli_classic_abort_usage(NULL);
-	if (options.logfile && open_logfile(options.logfile))
-		cli_classic_abort_usage(NULL);
+/*
+ * Reads the operations for --batch, one per line, with the same syntax as the
+ * command line. Arguments are separated by blanks, quoting is not supported.
+ * Empty lines and lines starting with '#' are ignored.
+ */
+static int parse_batch_file(struct cli_options *options, const char *optstring,
+			    const struct option *long_options)
+{
+	const bool use_stdin = !strcmp(options->batchfile, "-");
+	FILE *const file = use_stdin ? stdin : fopen(options->batchfile, "r");
+	if (!file) {
+		msg_gerr("Error: Opening batch file \"%s\" failed: %s\n", options->batchfile, strerror(errno));
+		return 1;
+	}
 
-	if (options.list_supported) {
-		if (print_supported())
+	char line[BATCH_LINE_MAX];
+	char *argv[BATCH_ARGS_MAX + 2];
+	unsigned int lineno = 0;
+	int ret = 0;
+
+	while (!ret && fgets(line, sizeof(line), file)) {
+		lineno++;
+		if (!strchr(line, '\n') && !feof(file)) {
+			msg_gerr("Error: Batch file line %u is too long.\n", lineno);
 			ret = 1;
-		goto out;
-	}
+			break;
+		}
 
-	start_logging();
+		int argc = 0;
+		argv[argc++] = options->batchfile;
+		for (char *arg = strtok(line, " \t\r\n"); arg; arg = strtok(NULL, " \t\r\n")) {
+			if (argc == BATCH_ARGS_MAX + 1) {
+				msg_gerr("Error: Batch file line %u has too many arguments.\n", lineno);
+				ret = 1;
+				break;
+			}
+			argv[argc++] = arg;
+		}
+		argv[argc] = NULL;
+		if (ret || argc == 1 || argv[1][0] == '#')
+			continue;
 
-	print_buildinfo();
-	msg_gdbg("Command line (%i args):", argc - 1);
-	for (i = 0; i < argc; i++) {
-		msg_gdbg(" %s", argv[i]);
+		struct cli_options *const batch = realloc(options->batch,
+							  (options->batch_len + 1) * sizeof(*batch));
+		if (!batch) {
+			msg_gerr("Out of memory!\n");
+			ret = 1;
+			break;
+		}
+		options->batch = batch;
+		struct cli_options *const step = &batch[options->batch_len++];
+		memset(step, 0, sizeof(*step));
+
+		/* Restart getopt for the new argument vector. */
+		optind = 0;
+		ret = parse_options(argc, argv, optstring, long_options, step, lineno) ||
+		      check_batch_step(options, step, lineno);
 	}
-	msg_gdbg("\n");
 
-	if (options.layoutfile && layout_from_file(&options.layout, options.layoutfile)) {
+	if (!ret && ferror(file)) {
+		msg_gerr("Error: Reading batch file \"%s\" failed.\n", options->batchfile);
 		ret = 1;
-		goto out;
 	}
+	if (!use_stdin)
+		fclose(file);
 
-	if (!options.ifd && !options.fmap && process_include_args(options.layout, options.include_args)) {
+	if (!ret && !options->batch_len) {
+		msg_gerr("Error: Batch file \"%s\" contains no operations.\n", options->batchfile);
 		ret = 1;
-		goto out;
-	}
-	/* Does a chip with the requested name exist in the flashchips array? */
-	if (options.chip_to_probe) {
-		for (chip = flashchips; chip && chip->name; chip++)
-			if (!strcmp(chip->name, options.chip_to_probe))
-				break;
-		if (!chip || !chip->name) {
-			msg_cerr("Error: Unknown chip '%s' specified.\n", options.chip_to_probe);
-			msg_gerr("Run flashrom -L to view the hardware supported in this flashrom version.\n");
-			ret = 1;
-			goto out;
-		}
-		/* Keep chip around for later usage in case a forced read is requested. */
 	}
+	return ret;
+}
 
-	if (options.prog == NULL) {
-		const struct programmer_entry *const default_programmer = CONFIG_DEFAULT_PROGRAMMER_NAME;
+/*
+ * Runs the operation given in `options` on the already probed chip in `context`.
+ * `known` holds the chip contents left by an earlier step of a batch, if they
+ * are known, and is updated with the contents after this operation. It is NULL
+ * outside of batch mode.
+ */
+static int run_operation(struct cli_options *options, struct flashctx *context,
+			 const struct cli_programmer *cp, uint8_t **known)
+{
+	struct flashrom_layout *layout = options->layout;
+	int ret = 0;
 
-		if (default_programmer) {
-			options.prog = default_programmer;
-			/* We need to strdup here because we free(pparam) unconditionally later. */
-			options.pparam = strdup(CONFIG_DEFAULT_PROGRAMMER_ARGS);
-			msg_pinfo("Using default programmer \"%s\" with arguments \"%s\".\n",
-				  default_programmer->name, options.pparam);
-		} else {
-			msg_perr("Please select a programmer with the --programmer parameter.\n"
-#if CONFIG_INTERNAL == 1
-				 "To choose the mainboard of this computer use 'internal'. "
-#endif
-				 "Valid choices are:\n");
-			list_programmers_linebreak(0, 80, 0);
-			msg_ginfo(".\n");
-			ret = 1;
-			goto out;
-		}
+	if (!any_op(options)) {
+		msg_ginfo("No operations were specified.\n");
+		goto out_release;
 	}
 
-	/* FIXME: Delay calibration should happen in programmer code. */
-	if (flashrom_init(1))
-		exit(1);
-
-	time(&time_start);
-
-	if (programmer_init(options.prog, options.pparam)) {
-		msg_perr("Error: Programmer initialization failed.\n");
+	if (options->enable_wp && options->disable_wp) {
+		msg_ginfo("Error: --wp-enable and --wp-disable are mutually exclusive\n");
 		ret = 1;
-		goto out_shutdown;
+		goto out_release;
 	}
-	tempstr = flashbuses_to_text(get_buses_supported());
-	msg_pdbg("The following protocols are supported: %s.\n", tempstr ? tempstr : "?");
-	free(tempstr);
-
-	all_matched_count = flashrom_flash_probe_v2(context, &all_matched_names,
-                                NULL, options.chip_to_probe);
-	if (all_matched_count == -1) {
-		/* -1 is the ret code which means "something went wrong".
-		 * Multiple match and no match are different ret codes.
-		 * More details about the error were printed during actual probing. */
-		msg_cerr("Error: probing failed.\n");
+	if (options->set_wp_range && options->set_wp_region) {
+		msg_gerr("Error: Cannot use both --wp-range and --wp-region simultaneously.\n");
 		ret = 1;
-		goto out_shutdown;
+		goto out_release;
 	}
 
-	if (all_matched_count > 1) {
-		msg_cinfo("Multiple flash chip definitions match the detected chip(s): \"%s\"",
-			  context->chip->name);
-		for (int ind = 1; ind < all_matched_count; ind++)
-			msg_cinfo(", \"%s\"", all_matched_names[ind]);
-		msg_cinfo("\nPlease specify which chip definition to use with the -c <chipname> option.\n");
+	if (options->read_repeated > 0 &&
+	    (options->read_it || options->write_it || options->erase_it || options->verify_it)) {
+		msg_gerr("Error: --read-repeated cannot be combined with read, write, erase, or verify.\n");
 		ret = 1;
-		goto out_shutdown;
-	} else if (!all_matched_count) {
-		msg_cinfo("No EEPROM/flash device found.\n");
-		if (!options.force || !options.chip_to_probe) {
-			msg_cinfo("Note: flashrom can never write if the flash chip isn't found "
-				  "automatically.\n");
-		}
-		if (options.force && options.read_it && options.chip_to_probe) {
-			struct registered_master *mst;
-			int compatible_masters = 0;
-			msg_cinfo("Force read (-f -r -c) requested, pretending the chip is there:\n");
-			/* This loop just counts compatible controllers. */
-			for (j = 0; j < registered_master_count; j++) {
-				mst = &registered_masters[j];
-				/* chip is still set from the chip_to_probe earlier in this function. */
-				if (mst->buses_supported & chip->bustype)
-					compatible_masters++;
-			}
-			if (!compatible_masters) {
-				msg_cinfo("No compatible controller found for the requested flash chip.\n");
-				ret = 1;
-				goto out_shutdown;
-			}
-			if (compatible_masters > 1)
-				msg_cinfo("More than one compatible controller found for the requested flash "
-					  "chip, using the first one.\n");
-
-			int force_probe_ret = ERROR_FLASHROM_PROBE_NO_CHIPS_FOUND;
-			for (j = 0; j < registered_master_count; j++) {
-				mst = &registered_masters[j];
-				force_probe_ret = probe_flash(mst, 0, context, 1, options.chip_to_probe);
-				if (force_probe_ret >= 0)
-					break;
-			}
-			if (force_probe_ret < 0) {
-				// FIXME: This should never happen! Ask for a bug report?
-				msg_cinfo("Probing for flash chip '%s' failed.\n", options.chip_to_probe);
-				ret = 1;
-				goto out_shutdown;
-			}
-			msg_cinfo("Please note that forced reads most likely contain garbage.\n");
-			flashrom_flag_set(context, FLASHROM_FLAG_FORCE, options.force);
-			ret = do_read(context, options.filename);
-			free(context->chip);
-			goto out_shutdown;
-		}
-		ret = 1;
-		goto out_shutdown;
-	} else if (!options.chip_to_probe) {
-		/* repeat for convenience when looking at foreign logs */
-		tempstr = flashbuses_to_text(context->chip->bustype);
-		msg_gdbg("Found %s flash chip \"%s\" (%d kB, %s).\n",
-			 context->chip->vendor, context->chip->name, context->chip->total_size,
-			 tempstr ? tempstr : "?");
-		free(tempstr);
-	}
-
-	struct cli_progress cli_progress = {0};
-	if (options.show_progress)
-		flashrom_set_progress_callback_v2(context, &flashrom_progress_cb, &cli_progress);
-
-	print_chip_support_status(context->chip);
-
-	unsigned int limitexceeded = count_max_decode_exceedings(context, &max_rom_decode);
-	if (limitexceeded > 0 && !options.force) {
-		enum chipbustype commonbuses = context->mst->buses_supported & context->chip->bustype;
-
-		/* Sometimes chip and programmer have more than one bus in common,
-		 * and the limit is not exceeded on all buses. Tell the user. */
-		if ((bitcount(commonbuses) > limitexceeded)) {
-			msg_pdbg("There is at least one interface available which could support the size of\n"
-				 "the selected flash chip.\n");
-		}
-		msg_cerr("This flash chip is too big for this programmer (--verbose/-V gives details).\n"
-			 "Use --force/-f to override at your own risk.\n");
-		ret = 1;
-		goto out_shutdown;
-	}
-
-	const bool any_wp_op =
-		options.set_wp_range || options.set_wp_region || options.enable_wp ||
-		options.disable_wp || options.print_wp_status || options.print_wp_ranges;
-
-	const bool any_rpmc_op =
-#if CONFIG_RPMC_ENABLED == 1
-		options.rpmc_read_data || options.rpmc_write_root_key || options.rpmc_update_hmac_key ||
-		options.rpmc_increment_counter || options.rpmc_get_counter;
-#else
-		false;
-#endif /* CONFIG_RPMC_ENABLED */
-
-	const bool any_op = options.read_it || options.write_it || options.verify_it ||
-		options.erase_it || options.flash_name || options.flash_size ||
-		options.extract_it || any_wp_op || any_rpmc_op ||
-		options.read_repeated > 0;
-
-	if (!any_op) {
-		msg_ginfo("No operations were specified.\n");
-		goto out_shutdown;
-	}
-
-	if (options.enable_wp && options.disable_wp) {
-		msg_ginfo("Error: --wp-enable and --wp-disable are mutually exclusive\n");
-		ret = 1;
-		goto out_shutdown;
-	}
-	if (options.set_wp_range && options.set_wp_region) {
-		msg_gerr("Error: Cannot use both --wp-range and --wp-region simultaneously.\n");
-		ret = 1;
-		goto out_shutdown;
-	}
-
-	if (options.read_repeated > 0 &&
-	    (options.read_it || options.write_it || options.erase_it || options.verify_it)) {
-		msg_gerr("Error: --read-repeated cannot be combined with read, write, erase, or verify.\n");
-		ret = 1;
-		goto out_shutdown;
+		goto out_release;
 	}
 
 	/*
@@ -1426,7 +1450,7 @@ int main(int argc, char *argv[])
 	 *
 	 * - If no filename is specified for -r/-w/-v, but files are specified
 	 *   for -i, then the number of file arguments for -i options must be
-	 *   equal to the total number of -i options.
+	 *   equal to the total number of -i options->
 	 *
 	 * Rules for reading:
 	 *
@@ -1453,20 +1477,20 @@ int main(int argc, char *argv[])
 	 *   considered ambiguous. Note: This is checked later since it requires
 	 *   processing the layout/fmap first.
 	 */
-	if ((options.read_it | options.write_it | options.verify_it) && !options.filename) {
-		if (!options.include_args) {
+	if ((options->read_it | options->write_it | options->verify_it) && !options->filename) {
+		if (!options->include_args) {
 			msg_gerr("Error: No image file specified.\n");
 			ret = 1;
-			goto out_shutdown;
+			goto out_release;
 		}
 
-		if (check_include_args_filename(options.include_args)) {
+		if (check_include_args_filename(options->include_args)) {
 			ret = 1;
-			goto out_shutdown;
+			goto out_release;
 		}
 	}
 
-	if (options.flash_name) {
+	if (options->flash_name) {
 		if (context->chip->vendor && context->chip->name) {
 			printf("vendor=\"%s\" name=\"%s\"\n",
 				context->chip->vendor,
@@ -1474,67 +1498,65 @@ int main(int argc, char *argv[])
 		} else {
 			ret = -1;
 		}
-		goto out_shutdown;
+		goto out_release;
 	}
 
-	if (options.flash_size) {
+	if (options->flash_size) {
 		printf("%zu\n", flashrom_flash_getsize(context));
-		goto out_shutdown;
+		goto out_release;
 	}
 
-	if (options.sacrifice_ratio) {
-		if (options.sacrifice_ratio < 0 || options.sacrifice_ratio > 50) {
-			msg_ginfo("Invalid input of sacrifice ratio, valid 0-50. Fallback to default value 0.\n");
-			options.sacrifice_ratio = 0;
-		}
-		context->sacrifice_ratio = options.sacrifice_ratio;
+	if (options->sacrifice_ratio < 0 || options->sacrifice_ratio > 50) {
+		msg_ginfo("Invalid input of sacrifice ratio, valid 0-50. Fallback to default value 0.\n");
+		options->sacrifice_ratio = 0;
 	}
+	context->sacrifice_ratio = options->sacrifice_ratio;
 
-	if (options.ifd && (flashrom_layout_read_from_ifd(&options.layout, context, NULL, 0) ||
-			   process_include_args(options.layout, options.include_args))) {
+	if (options->ifd && (flashrom_layout_read_from_ifd(&layout, context, NULL, 0) ||
+			   process_include_args(layout, options->include_args))) {
 		ret = 1;
-		goto out_shutdown;
-	} else if (options.fmap && options.fmapfile) {
+		goto out_release;
+	} else if (options->fmap && options->fmapfile) {
 		struct stat s;
-		if (stat(options.fmapfile, &s) != 0) {
-			msg_gerr("Failed to stat fmapfile \"%s\"\n", options.fmapfile);
+		if (stat(options->fmapfile, &s) != 0) {
+			msg_gerr("Failed to stat fmapfile \"%s\"\n", options->fmapfile);
 			ret = 1;
-			goto out_shutdown;
+			goto out_release;
 		}
 
 		size_t fmapfile_size = s.st_size;
 		uint8_t *fmapfile_buffer = malloc(fmapfile_size);
 		if (!fmapfile_buffer) {
 			ret = 1;
-			goto out_shutdown;
+			goto out_release;
 		}
 
-		if (read_buf_from_file(fmapfile_buffer, fmapfile_size, options.fmapfile)) {
+		if (read_buf_from_file(fmapfile_buffer, fmapfile_size, options->fmapfile)) {
 			ret = 1;
 			free(fmapfile_buffer);
-			goto out_shutdown;
+			goto out_release;
 		}
 
-		if (flashrom_layout_read_fmap_from_buffer(&options.layout, context, fmapfile_buffer, fmapfile_size) ||
-		    process_include_args(options.layout, options.include_args)) {
+		if (flashrom_layout_read_fmap_from_buffer(&layout, context, fmapfile_buffer, fmapfile_size) ||
+		    process_include_args(layout, options->include_args)) {
 			ret = 1;
 			free(fmapfile_buffer);
-			goto out_shutdown;
+			goto out_release;
 		}
 		free(fmapfile_buffer);
-	} else if (options.fmap) {
+	} else if (options->fmap) {
 		/* Read layout from ROM fmap */
-		if (flashrom_layout_read_fmap_from_rom(&options.layout, context, 0,
+		if (flashrom_layout_read_fmap_from_rom(&layout, context, 0,
 				flashrom_flash_getsize(context)) ||
-				process_include_args(options.layout, options.include_args)) {
+				process_include_args(layout, options->include_args)) {
 			ret = 1;
-			goto out_shutdown;
+			goto out_release;
 		}
-		if (options.fmap_verify) {
+		if (options->fmap_verify) {
 			struct flashrom_layout *file_layout = NULL;
 			struct stat s;
-			if (stat(options.filename, &s) != 0) {
-				msg_gerr("Failed to stat the file \"%s\"\n", options.filename);
+			if (stat(options->filename, &s) != 0) {
+				msg_gerr("Failed to stat the file \"%s\"\n", options->filename);
 				ret = 1;
 				goto out_release;
 			}
@@ -1546,7 +1568,7 @@ int main(int argc, char *argv[])
 				goto out_release;
 			}
 
-			if (read_buf_from_file(file_buffer, fmapfile_size, options.filename)) {
+			if (read_buf_from_file(file_buffer, fmapfile_size, options->filename)) {
 				ret = 1;
 				free(file_buffer);
 				goto out_release;
@@ -1554,14 +1576,14 @@ int main(int argc, char *argv[])
 			/* Read layout from file fmap */
 			if (flashrom_layout_read_fmap_from_buffer(&file_layout, context, file_buffer,
 					flashrom_flash_getsize(context)) ||
-					process_include_args(file_layout, options.include_args)) {
+					process_include_args(file_layout, options->include_args)) {
 				ret = 1;
 				free(file_buffer);
 				goto out_release;
 			}
 			free(file_buffer);
 			/* compare the two layouts */
-			if (flashrom_layout_compare(options.layout, file_layout)) {
+			if (flashrom_layout_compare(layout, file_layout)) {
 				msg_cerr("FMAP layouts do not match! Aborting.\n");
 				flashrom_layout_release(file_layout);
 				ret = 1;
@@ -1571,85 +1593,452 @@ int main(int argc, char *argv[])
 			msg_cinfo("FMAP layouts match.\n");
 		}
 	}
-	flashrom_layout_set(context, options.layout);
+	flashrom_layout_set(context, layout);
 
-	if (any_wp_op) {
-		if (options.set_wp_region && options.wp_region) {
-			if (!options.layout) {
+	if (any_wp_op(options)) {
+		if (options->set_wp_region && options->wp_region) {
+			if (!layout) {
 				msg_gerr("Error: A flash layout must be specified to use --wp-region.\n");
 				ret = 1;
 				goto out_release;
 			}
 
-			ret = flashrom_layout_get_region_range(options.layout, options.wp_region, &options.wp_start, &options.wp_len);
+			ret = flashrom_layout_get_region_range(layout, options->wp_region, &options->wp_start, &options->wp_len);
 			if (ret) {
-				msg_gerr("Error: Region %s not found in flash layout.\n", options.wp_region);
+				msg_gerr("Error: Region %s not found in flash layout.\n", options->wp_region);
 				goto out_release;
 			}
-			options.set_wp_range = true;
+			options->set_wp_range = true;
 		}
 		ret = wp_cli(
 			context,
-			options.enable_wp,
-			options.disable_wp,
-			options.print_wp_status,
-			options.print_wp_ranges,
-			options.set_wp_range,
-			options.wp_start,
-			options.wp_len
+			options->enable_wp,
+			options->disable_wp,
+			options->print_wp_status,
+			options->print_wp_ranges,
+			options->set_wp_range,
+			options->wp_start,
+			options->wp_len
 		);
 		if (ret)
 			goto out_release;
 	}
 
-	flashrom_flag_set(context, FLASHROM_FLAG_FORCE, options.force);
+	flashrom_flag_set(context, FLASHROM_FLAG_FORCE, options->force);
 #if CONFIG_INTERNAL == 1
 	flashrom_flag_set(context, FLASHROM_FLAG_FORCE_BOARDMISMATCH, force_boardmismatch);
 #endif
-	flashrom_flag_set(context, FLASHROM_FLAG_VERIFY_AFTER_WRITE, !options.dont_verify_it);
-	flashrom_flag_set(context, FLASHROM_FLAG_VERIFY_WHOLE_CHIP, !options.dont_verify_all);
+	flashrom_flag_set(context, FLASHROM_FLAG_VERIFY_AFTER_WRITE, !options->dont_verify_it);
+	/* --verify-changed takes precedence, it implies -N. */
+	flashrom_flag_set(context, FLASHROM_FLAG_VERIFY_WHOLE_CHIP,
+			  !options->dont_verify_all && !options->verify_changed);
+	flashrom_flag_set(context, FLASHROM_FLAG_MINIMAL_PREREAD, options->minimal_preread);
+	flashrom_flag_set(context, FLASHROM_FLAG_VERIFY_CHANGED, options->verify_changed);
+	flashrom_flag_set(context, FLASHROM_FLAG_TIME_OPTIMAL_ERASE, options->time_optimal_erase);
+	flashrom_flag_set(context, FLASHROM_FLAG_USE_SFDP, options->use_sfdp);
 
 	/* FIXME: We should issue an unconditional chip reset here. This can be
 	 * done once we have a .reset function in struct flashchip.
 	 * Give the chip time to settle.
 	 */
 	programmer_delay(context, 100000);
-	if (options.read_repeated > 0)
-		ret = do_read_repeated(context, options.read_repeated, options.filename);
-	else if (options.read_it)
-		ret = do_read(context, options.filename);
-	else if (options.extract_it)
+
+	/* Only complete images are stored, but any write may use the cache as reference. */
+	char *shadow_cache = NULL;
+	if (options->shadow_cache_dir && (options->read_it || options->erase_it || options->write_it || options->verify_it))
+		shadow_cache = shadow_cache_path(context, options->shadow_cache_dir, cp->prog->name);
+	const bool full_image = !layout;
+
+	if (options->read_repeated > 0)
+		ret = do_read_repeated(context, options->read_repeated, options->filename);
+	else if (options->read_it)
+		ret = do_read(context, options->filename, full_image ? shadow_cache : NULL,
+			      full_image ? known : NULL);
+	else if (options->extract_it)
 		ret = do_extract(context);
-	else if (options.erase_it) {
+	else if (options->erase_it) {
+		if (shadow_cache)
+			shadow_cache_drop(shadow_cache);
+		forget_contents(known);
 		ret = flashrom_flash_erase(context);
 	}
-	else if (options.write_it)
-		ret = do_write(context, options.filename, options.referencefile);
-	else if (options.verify_it)
-		ret = do_verify(context, options.filename);
+	else if (options->write_it)
+		ret = do_write(context, options->filename, options->referencefile, shadow_cache, full_image,
+			       known);
+	else if (options->verify_it)
+		ret = do_verify(context, options->filename, full_image ? shadow_cache : NULL,
+				full_image ? known : NULL);
+	free(shadow_cache);
 
 #if CONFIG_RPMC_ENABLED == 1
-	if (any_rpmc_op && ret == 0) {
+	if (any_rpmc_op(options) && ret == 0) {
 		ret = rpmc_cli(context,
-			       options.rpmc_root_key_file,
-			       options.rpmc_key_data,
-			       options.rpmc_counter_address,
-			       options.rpmc_previous_counter_value,
-			       options.rpmc_read_data,
-			       options.rpmc_write_root_key,
-			       options.rpmc_update_hmac_key,
-			       options.rpmc_increment_counter,
-			       options.rpmc_get_counter);
+			       options->rpmc_root_key_file,
+			       options->rpmc_key_data,
+			       options->rpmc_counter_address,
+			       options->rpmc_previous_counter_value,
+			       options->rpmc_read_data,
+			       options->rpmc_write_root_key,
+			       options->rpmc_update_hmac_key,
+			       options->rpmc_increment_counter,
+			       options->rpmc_get_counter);
 	}
 #endif /* CONFIG_RPMC_ENABLED */
 
 out_release:
-	flashrom_layout_release(options.layout);
+	flashrom_layout_set(context, NULL);
+	if (layout != options->layout)
+		flashrom_layout_release(layout);
+	return ret;
+}
+
+/*
+ * Runs the requested operation, or all steps of a batch, with a single
+ * programmer from initialization to shutdown. `chip` is the chip requested
+ * with -c, if any.
+ */
+static int run_programmer(struct cli_options *options, const struct cli_programmer *cp,
+			  const struct flashchip *chip)
+{
+	char *tempstr = NULL;
+	int j;
+	int ret = 0;
+	int all_matched_count = 0;
+	const char **all_matched_names = NULL;
+
+	struct flashctx *context = NULL; /* holds the active detected chip and other info */
+	if (flashrom_create_context(&context)) {
+		msg_gerr("Failed to allocate flash context. Aborting");
+		return 1;
+	}
+
+	if (programmer_init(cp->prog, cp->pparam)) {
+		msg_perr("Error: Programmer initialization failed.\n");
+		ret = 1;
+		goto out_shutdown;
+	}
+	tempstr = flashbuses_to_text(get_buses_supported());
+	msg_pdbg("The following protocols are supported: %s.\n", tempstr ? tempstr : "?");
+	free(tempstr);
+
+	all_matched_count = flashrom_flash_probe_v2(context, &all_matched_names,
+                                NULL, options->chip_to_probe);
+	if (all_matched_count == -1) {
+		/* -1 is the ret code which means "something went wrong".
+		 * Multiple match and no match are different ret codes.
+		 * More details about the error were printed during actual probing. */
+		msg_cerr("Error: probing failed.\n");
+		ret = 1;
+		goto out_shutdown;
+	}
+
+	if (all_matched_count > 1) {
+		msg_cinfo("Multiple flash chip definitions match the detected chip(s): \"%s\"",
+			  context->chip->name);
+		for (int ind = 1; ind < all_matched_count; ind++)
+			msg_cinfo(", \"%s\"", all_matched_names[ind]);
+		msg_cinfo("\nPlease specify which chip definition to use with the -c <chipname> option.\n");
+		ret = 1;
+		goto out_shutdown;
+	} else if (!all_matched_count) {
+		msg_cinfo("No EEPROM/flash device found.\n");
+		if (!options->force || !options->chip_to_probe) {
+			msg_cinfo("Note: flashrom can never write if the flash chip isn't found "
+				  "automatically.\n");
+		}
+		if (options->force && options->read_it && options->chip_to_probe) {
+			struct registered_master *mst;
+			int compatible_masters = 0;
+			msg_cinfo("Force read (-f -r -c) requested, pretending the chip is there:\n");
+			/* This loop just counts compatible controllers. */
+			for (j = 0; j < registered_master_count; j++) {
+				mst = &registered_masters[j];
+				/* chip is still set from the chip_to_probe earlier in this function. */
+				if (mst->buses_supported & chip->bustype)
+					compatible_masters++;
+			}
+			if (!compatible_masters) {
+				msg_cinfo("No compatible controller found for the requested flash chip.\n");
+				ret = 1;
+				goto out_shutdown;
+			}
+			if (compatible_masters > 1)
+				msg_cinfo("More than one compatible controller found for the requested flash "
+					  "chip, using the first one.\n");
+
+			int force_probe_ret = ERROR_FLASHROM_PROBE_NO_CHIPS_FOUND;
+			for (j = 0; j < registered_master_count; j++) {
+				mst = &registered_masters[j];
+				force_probe_ret = probe_flash(mst, 0, context, 1, options->chip_to_probe);
+				if (force_probe_ret >= 0)
+					break;
+			}
+			if (force_probe_ret < 0) {
+				// FIXME: This should never happen! Ask for a bug report?
+				msg_cinfo("Probing for flash chip '%s' failed.\n", options->chip_to_probe);
+				ret = 1;
+				goto out_shutdown;
+			}
+			msg_cinfo("Please note that forced reads most likely contain garbage.\n");
+			flashrom_flag_set(context, FLASHROM_FLAG_FORCE, options->force);
+			ret = do_read(context, options->filename, NULL, NULL);
+			free(context->chip);
+			goto out_shutdown;
+		}
+		ret = 1;
+		goto out_shutdown;
+	} else if (!options->chip_to_probe) {
+		/* repeat for convenience when looking at foreign logs */
+		tempstr = flashbuses_to_text(context->chip->bustype);
+		msg_gdbg("Found %s flash chip \"%s\" (%d kB, %s).\n",
+			 context->chip->vendor, context->chip->name, context->chip->total_size,
+			 tempstr ? tempstr : "?");
+		free(tempstr);
+	}
+
+	struct cli_progress cli_progress = {0};
+	if (options->show_progress)
+		flashrom_set_progress_callback_v2(context, &flashrom_progress_cb, &cli_progress);
+
+	print_chip_support_status(context->chip);
+
+	unsigned int limitexceeded = count_max_decode_exceedings(context, &max_rom_decode);
+	if (limitexceeded > 0 && !options->force) {
+		enum chipbustype commonbuses = context->mst->buses_supported & context->chip->bustype;
+
+		/* Sometimes chip and programmer have more than one bus in common,
+		 * and the limit is not exceeded on all buses. Tell the user. */
+		if ((bitcount(commonbuses) > limitexceeded)) {
+			msg_pdbg("There is at least one interface available which could support the size of\n"
+				 "the selected flash chip.\n");
+		}
+		msg_cerr("This flash chip is too big for this programmer (--verbose/-V gives details).\n"
+			 "Use --force/-f to override at your own risk.\n");
+		ret = 1;
+		goto out_shutdown;
+	}
+
+	if (options->batch_len == 0) {
+		ret = run_operation(options, context, cp, NULL);
+		goto out_shutdown;
+	}
+
+	uint8_t *known = NULL;
+	for (size_t i = 0; i < options->batch_len; i++) {
+		msg_ginfo("Batch step %zu of %zu.\n", i + 1, options->batch_len);
+		ret = run_operation(&options->batch[i], context, cp, &known);
+		if (ret) {
+			msg_gerr("Batch step %zu failed, skipping the remaining steps.\n", i + 1);
+			break;
+		}
+	}
+	free(known);
+
 out_shutdown:
 	flashrom_programmer_shutdown(NULL);
-out:
 	flashrom_data_free(all_matched_names);
 	flashrom_flash_release(context);
+	return ret;
+}
+
+int main(int argc, char *argv[])
+{
+	const struct flashchip *chip = NULL;
+	int i;
+	int ret = 0;
+	int results[MAX_CLI_PROGRAMMERS];
+	time_t time_start = 0, time_end = 0;
+
+	struct cli_options options = { 0 };
+	static const char optstring[] = "r::Rw::v::nNVEfc:l:i:p:Lzho:x";
+	static const struct option long_options[] = {
+		{"read",		2, NULL, 'r'},
+		{"write",		2, NULL, 'w'},
+		{"erase",		0, NULL, 'E'},
+		{"verify",		2, NULL, 'v'},
+		{"noverify",		0, NULL, 'n'},
+		{"noverify-all",	0, NULL, 'N'},
+		{"extract",		0, NULL, 'x'},
+		{"chip",		1, NULL, 'c'},
+		{"verbose",		0, NULL, 'V'},
+		{"force",		0, NULL, 'f'},
+		{"layout",		1, NULL, 'l'},
+		{"ifd",			0, NULL, OPTION_IFD},
+		{"fmap",		0, NULL, OPTION_FMAP},
+		{"fmap-file",		1, NULL, OPTION_FMAP_FILE},
+		{"fmap-verify",		0, NULL, OPTION_FMAP_VERIFY},
+		{"image",		1, NULL, 'i'}, // (deprecated): back compatibility.
+		{"include",		1, NULL, 'i'},
+		{"flash-contents",	1, NULL, OPTION_FLASH_CONTENTS},
+		{"flash-name",		0, NULL, OPTION_FLASH_NAME},
+		{"flash-size",		0, NULL, OPTION_FLASH_SIZE},
+		{"get-size",		0, NULL, OPTION_FLASH_SIZE}, // (deprecated): back compatibility.
+		{"wp-status",		0, NULL, OPTION_WP_STATUS},
+		{"wp-list",		0, NULL, OPTION_WP_LIST},
+		{"wp-range",		1, NULL, OPTION_WP_SET_RANGE},
+		{"wp-region",		1, NULL, OPTION_WP_SET_REGION},
+		{"wp-enable",		0, NULL, OPTION_WP_ENABLE},
+		{"wp-disable",		0, NULL, OPTION_WP_DISABLE},
+		{"list-supported",	0, NULL, 'L'},
+		{"programmer",		1, NULL, 'p'},
+		{"help",		0, NULL, 'h'},
+		{"version",		0, NULL, 'R'},
+		{"output",		1, NULL, 'o'},
+		{"progress",		0, NULL, OPTION_PROGRESS},
+		{"sacrifice-ratio",	1, NULL, OPTION_SACRIFICE_RATIO},
+		{"read-repeated",	2, NULL, OPTION_READ_REPEATED},
+		{"minimal-preread",	0, NULL, OPTION_MINIMAL_PREREAD},
+		{"shadow-cache",	1, NULL, OPTION_SHADOW_CACHE},
+		{"verify-changed",	0, NULL, OPTION_VERIFY_CHANGED},
+		{"time-optimal-erase",	0, NULL, OPTION_TIME_OPTIMAL_ERASE},
+		{"sfdp",		0, NULL, OPTION_SFDP},
+		{"batch",		1, NULL, OPTION_BATCH},
+#if CONFIG_RPMC_ENABLED == 1
+		{"get-rpmc-status",	0, NULL, OPTION_RPMC_READ_DATA},
+		{"write-root-key",	0, NULL, OPTION_RPMC_WRITE_ROOT_KEY},
+		{"update-hmac-key",	0, NULL, OPTION_RPMC_UPDATE_HMAC_KEY},
+		{"increment-counter",	1, NULL, OPTION_RPMC_INCREMENT_COUNTER},
+		{"get-counter",		0, NULL, OPTION_RPMC_GET_COUNTER},
+		{"counter-address",	1, NULL, OPTION_RPMC_COUNTER_ADDRESS},
+		{"key-data",		1, NULL, OPTION_RPMC_KEY_DATA},
+		{"rpmc-root-key",	1, NULL, OPTION_RPMC_KEY_FILE},
+#endif /* CONFIG_RPMC_ENABLED */
+		{NULL,			0, NULL, 0},
+	};
+
+	/*
+	 * Safety-guard against a user who has (mistakenly) closed
+	 * stdout or stderr before exec'ing flashrom.  We disable
+	 * logging in this case to prevent writing log data to a flash
+	 * chip when a flash device gets opened with fd 1 or 2.
+	 */
+	if (check_file(stdout) && check_file(stderr)) {
+		/* This is maximum log level for callback to be invoked,
+		 * and cli wants callback to be always invoked. */
+		flashrom_set_log_level(FLASHROM_MSG_SPEW);
+		flashrom_set_log_callback(&flashrom_print_cb);
+	}
+
+	print_version();
+	print_banner();
+
+	setbuf(stdout, NULL);
+
+	parse_options(argc, argv, optstring, long_options, &options, 0);
+
+	if (options.filename && check_filename(options.filename, "image"))
+		cli_classic_abort_usage(NULL);
+	if (options.layoutfile && check_filename(options.layoutfile, "layout"))
+		cli_classic_abort_usage(NULL);
+	if (options.fmapfile && check_filename(options.fmapfile, "fmap"))
+		cli_classic_abort_usage(NULL);
+	if (options.referencefile && check_filename(options.referencefile, "reference"))
+		cli_classic_abort_usage(NULL);
+	if (options.shadow_cache_dir && check_filename(options.shadow_cache_dir, "shadow cache"))
+		cli_classic_abort_usage(NULL);
+	if (options.programmer_count > 1)
+		check_multi_programmer_options(&options);
+	if (options.batchfile && check_filename(options.batchfile, "batch"))
+		cli_classic_abort_usage(NULL);
+	if (options.batchfile && (any_op(&options) || options.layoutfile || options.ifd || options.fmap ||
+				  options.include_args))
+		cli_classic_abort_usage("Error: Operations and layouts for --batch belong into the batch file.\n");
+	if (options.logfile && check_filename(options.logfile, "log"))
+		cli_classic_abort_usage(NULL);
+	if (options.logfile && open_logfile(options.logfile))
+		cli_classic_abort_usage(NULL);
+
+	if (options.list_supported) {
+		if (print_supported())
+			ret = 1;
+		goto out;
+	}
+
+	start_logging();
+
+	print_buildinfo();
+	msg_gdbg("Command line (%i args):", argc - 1);
+	for (i = 0; i < argc; i++) {
+		msg_gdbg(" %s", argv[i]);
+	}
+	msg_gdbg("\n");
+
+	if (options.layoutfile && layout_from_file(&options.layout, options.layoutfile)) {
+		ret = 1;
+		goto out;
+	}
+
+	if (!options.ifd && !options.fmap && process_include_args(options.layout, options.include_args)) {
+		ret = 1;
+		goto out;
+	}
+
+	if (options.batchfile && parse_batch_file(&options, optstring, long_options)) {
+		ret = 1;
+		goto out;
+	}
+	/* Does a chip with the requested name exist in the flashchips array? */
+	if (options.chip_to_probe) {
+		for (chip = flashchips; chip && chip->name; chip++)
+			if (!strcmp(chip->name, options.chip_to_probe))
+				break;
+		if (!chip || !chip->name) {
+			msg_cerr("Error: Unknown chip '%s' specified.\n", options.chip_to_probe);
+			msg_gerr("Run flashrom -L to view the hardware supported in this flashrom version.\n");
+			ret = 1;
+			goto out;
+		}
+		/* Keep chip around for later usage in case a forced read is requested. */
+	}
+
+	if (options.programmer_count == 0) {
+		const struct programmer_entry *const default_programmer = CONFIG_DEFAULT_PROGRAMMER_NAME;
+
+		if (default_programmer) {
+			options.programmers[0].prog = default_programmer;
+			/* We need to strdup here because we free(pparam) unconditionally later. */
+			options.programmers[0].pparam = strdup(CONFIG_DEFAULT_PROGRAMMER_ARGS);
+			options.programmer_count = 1;
+			msg_pinfo("Using default programmer \"%s\" with arguments \"%s\".\n",
+				  default_programmer->name, options.programmers[0].pparam);
+		} else {
+			msg_perr("Please select a programmer with the --programmer parameter.\n"
+#if CONFIG_INTERNAL == 1
+				 "To choose the mainboard of this computer use 'internal'. "
+#endif
+				 "Valid choices are:\n");
+			list_programmers_linebreak(0, 80, 0);
+			msg_ginfo(".\n");
+			ret = 1;
+			goto out;
+		}
+	}
+
+	/* FIXME: Delay calibration should happen in programmer code. */
+	if (flashrom_init(1))
+		exit(1);
+
+	time(&time_start);
+
+	for (size_t p = 0; p < options.programmer_count; p++) {
+		if (options.programmer_count > 1)
+			msg_ginfo("\nProgrammer %zu of %zu: %s\n", p + 1, options.programmer_count,
+				  options.programmers[p].prog->name);
+		results[p] = run_programmer(&options, &options.programmers[p], chip);
+		ret |= results[p];
+	}
+
+	if (options.programmer_count > 1) {
+		msg_ginfo("\nResults:\n");
+		for (size_t p = 0; p < options.programmer_count; p++) {
+			const struct cli_programmer *const cp = &options.programmers[p];
+			msg_ginfo("%2zu: %s%s%s: %s\n", p + 1, cp->prog->name, cp->pparam ? ":" : "",
+				  cp->pparam ? cp->pparam : "", results[p] ? "FAILED" : "OK");
+		}
+	}
+
+out:
+	flashrom_layout_release(options.layout);
 
 	free_options(&options);
 
@@ -0,0 +1,241 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileCopyrightText: 2026 The flashrom authors
+ */
+
+/*
+ * Shadow cache of chip contents for the classic CLI.
+ *
+ * After a successful full read, verify or verified write the image is stored
+ * in a cache directory under a name derived from the programmer, the chip and
+ * the chip's factory-programmed unique ID. A later write to the same chip can
+ * use the cached image as reference contents instead of reading the whole
+ * chip again. Only chips with FEATURE_UNIQUE_ID that return an ID are
+ * cached, all other chips are read in full as usual.
+ */
+
+#include "platform/string.h"
+#include "flash.h"
+#include "chipdrivers.h"
+#include "contents_diff.h"
+#include "helpers.h"
+#include "programmer.h"
+#include "log.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SHADOW_CACHE_MAGIC	"FRSHADW1"
+#define SHADOW_CACHE_ID_LEN	JEDEC_RDUID_INSIZE
+/* Number and size of blocks compared against the chip before a cache entry is trusted. */
+#define SHADOW_CACHE_SAMPLES	16
+#define SHADOW_CACHE_SAMPLE_LEN	4096
+
+struct shadow_cache_header {
+	char magic[8];
+	uint64_t size;
+	uint64_t digest;
+};
+
+/* 64-bit FNV-1a, good enough to detect a truncated or corrupted cache file. */
+static uint64_t shadow_cache_digest(const uint8_t *buf, size_t len)
+{
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	for (size_t i = 0; i < len; i++) {
+		hash ^= buf[i];
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/* xorshift32, the CLI must not reseed the global rand() state for this. */
+static uint32_t shadow_cache_random(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+/*
+ * Compares `count` blocks of `block_len` bytes, spread over the whole chip
+ * with a random offset, against `buffer`. This is a cheap consistency check
+ * of a cached image before it is trusted as reference for a write.
+ *
+ * Returns 0 if all samples match,
+ *	   1 if reading failed,
+ *	   3 if the contents don't match.
+ */
+static int shadow_cache_verify_samples(struct flashctx *flash, const uint8_t *buffer,
+				       unsigned int count, unsigned int block_len)
+{
+	const unsigned int flash_size = flash->chip->total_size * 1024;
+	const unsigned int len = min(block_len, flash_size);
+	const unsigned int stride = flash_size / (count ? count : 1);
+	/* Sample different blocks on every run. */
+	uint32_t seed = (uint32_t)time(NULL) ^ (uint32_t)getpid();
+	if (!seed)
+		seed = 1;
+
+	uint8_t *const readbuf = malloc(len);
+	if (!readbuf) {
+		msg_gerr("Out of memory!\n");
+		return 1;
+	}
+
+	int ret = 1;
+	if (prepare_flash_access(flash, true, false, false, false))
+		goto _free_ret;
+
+	for (unsigned int i = 0; i < count; i++) {
+		unsigned int start = i * stride;
+		if (stride > len)
+			start += shadow_cache_random(&seed) % (stride - len);
+		start = min(start, flash_size - len);
+
+		if (read_flash(flash, readbuf, start, len))
+			goto _finalize_ret;
+		if (contents_first_diff(buffer + start, readbuf, len) != len) {
+			msg_gdbg("%s: contents differ at %#08x..%#08x.\n", __func__, start, start + len - 1);
+			ret = 3;
+			goto _finalize_ret;
+		}
+	}
+	ret = 0;
+
+_finalize_ret:
+	finalize_flash_access(flash);
+_free_ret:
+	free(readbuf);
+	return ret;
+}
+
+/* Replaces characters that are awkward in file names. */
+static void shadow_cache_sanitize(char *name)
+{
+	for (; *name; name++) {
+		if (!(*name >= '0' && *name <= '9') && !(*name >= 'a' && *name <= 'z') &&
+		    !(*name >= 'A' && *name <= 'Z') && *name != '-' && *name != '.')
+			*name = '_';
+	}
+}
+
+char *shadow_cache_path(struct flashctx *flash, const char *dir, const char *programmer_name)
+{
+	uint8_t id[SHADOW_CACHE_ID_LEN];
+
+	if (!(flash->mst->buses_supported & flash->chip->bustype & BUS_SPI) ||
+	    !(flash->chip->feature_bits & FEATURE_UNIQUE_ID)) {
+		msg_cinfo("The flash chip has no known unique ID, not using the shadow cache.\n");
+		return NULL;
+	}
+	/* The ID is read with the chip in the address mode that the operation will use. */
+	if (prepare_flash_access(flash, true, false, false, false))
+		return NULL;
+	const int id_ret = spi_read_unique_id(flash, id, sizeof(id));
+	finalize_flash_access(flash);
+	if (id_ret) {
+		msg_cinfo("Could not read a unique ID from the flash chip, not using the shadow cache.\n");
+		return NULL;
+	}
+
+	char idhex[2 * sizeof(id) + 1];
+	for (size_t i = 0; i < sizeof(id); i++)
+		snprintf(idhex + 2 * i, 3, "%02x", id[i]);
+
+	const size_t name_len = strlen(programmer_name) + strlen(flash->chip->name) + strlen(idhex) +
+				strlen("--.bin") + 1;
+	char *const name = malloc(name_len);
+	const size_t path_len = strlen(dir) + 1 + name_len;
+	char *const path = malloc(path_len);
+	if (!name || !path) {
+		msg_gerr("Out of memory!\n");
+		free(name);
+		free(path);
+		return NULL;
+	}
+
+	snprintf(name, name_len, "%s-%s-%s.bin", programmer_name, flash->chip->name, idhex);
+	shadow_cache_sanitize(name);
+	snprintf(path, path_len, "%s/%s", dir, name);
+	free(name);
+
+	msg_cdbg("Shadow cache entry for this chip is \"%s\".\n", path);
+	return path;
+}
+
+int shadow_cache_load(struct flashctx *flash, const char *path, uint8_t *buf, size_t size)
+{
+	struct shadow_cache_header header;
+	int ret = 1;
+
+	FILE *const file = fopen(path, "rb");
+	if (!file) {
+		if (errno != ENOENT)
+			msg_cwarn("Warning: opening shadow cache \"%s\" failed: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	if (fread(&header, sizeof(header), 1, file) != 1 ||
+	    memcmp(header.magic, SHADOW_CACHE_MAGIC, sizeof(header.magic)) || header.size != size) {
+		msg_cwarn("Warning: shadow cache \"%s\" is invalid, ignoring it.\n", path);
+		goto _close_ret;
+	}
+	if (fread(buf, 1, size, file) != size || shadow_cache_digest(buf, size) != header.digest) {
+		msg_cwarn("Warning: shadow cache \"%s\" is corrupted, ignoring it.\n", path);
+		goto _close_ret;
+	}
+
+	if (shadow_cache_verify_samples(flash, buf, SHADOW_CACHE_SAMPLES, SHADOW_CACHE_SAMPLE_LEN)) {
+		msg_cinfo("Shadow cache does not match the flash contents, ignoring it.\n");
+		goto _close_ret;
+	}
+
+	msg_cinfo("Using shadow cache \"%s\" as reference contents.\n", path);
+	ret = 0;
+
+_close_ret:
+	fclose(file);
+	return ret;
+}
+
+int shadow_cache_store(const char *path, const uint8_t *buf, size_t size)
+{
+	struct shadow_cache_header header = {
+		.size = size,
+		.digest = shadow_cache_digest(buf, size),
+	};
+	memcpy(header.magic, SHADOW_CACHE_MAGIC, sizeof(header.magic));
+
+	FILE *const file = fopen(path, "wb");
+	if (!file) {
+		msg_cwarn("Warning: creating shadow cache \"%s\" failed: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	int ret = 0;
+	if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(buf, 1, size, file) != size)
+		ret = 1;
+	if (fclose(file))
+		ret = 1;
+
+	if (ret) {
+		msg_cwarn("Warning: writing shadow cache \"%s\" failed.\n", path);
+		unlink(path);
+		return 1;
+	}
+	msg_cdbg("Stored flash contents in shadow cache \"%s\".\n", path);
+	return 0;
+}
+
+void shadow_cache_drop(const char *path)
+{
+	if (unlink(path) && errno != ENOENT)
+		msg_cwarn("Warning: removing shadow cache \"%s\" failed: %s\n", path, strerror(errno));
+}
@@ -0,0 +1,217 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileCopyrightText: 2026 The flashrom authors
+ */
+
+#include "contents_diff.h"
+
+#include <string.h>
+
+/*
+ * All kernels below scan the buffers in chunks of CHUNK_SIZE bytes and only
+ * fall back to a bytewise loop for the chunk that decides the result and for
+ * the tail. The chunk primitives use SSE2 on x86 and NEON on AArch64, both of
+ * which are part of the baseline instruction set there. Everywhere else they
+ * work on two 64-bit words at a time.
+ */
+#define CHUNK_SIZE 16
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+static inline __m128i load_chunk(const uint8_t *p)
+{
+	return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline bool all_set(__m128i v)
+{
+	return _mm_movemask_epi8(v) == 0xffff;
+}
+
+static inline bool chunk_all_eq(const uint8_t *a, const uint8_t *b)
+{
+	return all_set(_mm_cmpeq_epi8(load_chunk(a), load_chunk(b)));
+}
+
+static inline bool chunk_any_eq(const uint8_t *a, const uint8_t *b)
+{
+	return _mm_movemask_epi8(_mm_cmpeq_epi8(load_chunk(a), load_chunk(b))) != 0;
+}
+
+static inline bool chunk_only_clears(const uint8_t *have, const uint8_t *want)
+{
+	const __m128i w = load_chunk(want);
+	return all_set(_mm_cmpeq_epi8(_mm_and_si128(load_chunk(have), w), w));
+}
+
+static inline bool chunk_writable(const uint8_t *have, const uint8_t *want, uint8_t erased_value)
+{
+	const __m128i h = load_chunk(have);
+	const __m128i ok = _mm_or_si128(_mm_cmpeq_epi8(h, load_chunk(want)),
+					_mm_cmpeq_epi8(h, _mm_set1_epi8((char)erased_value)));
+	return all_set(ok);
+}
+
+static inline bool chunk_is_value(const uint8_t *buf, uint8_t value)
+{
+	return all_set(_mm_cmpeq_epi8(load_chunk(buf), _mm_set1_epi8((char)value)));
+}
+
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+static inline bool all_set(uint8x16_t v)
+{
+	return vminvq_u8(v) == 0xff;
+}
+
+static inline bool chunk_all_eq(const uint8_t *a, const uint8_t *b)
+{
+	return all_set(vceqq_u8(vld1q_u8(a), vld1q_u8(b)));
+}
+
+static inline bool chunk_any_eq(const uint8_t *a, const uint8_t *b)
+{
+	return vmaxvq_u8(vceqq_u8(vld1q_u8(a), vld1q_u8(b))) != 0;
+}
+
+static inline bool chunk_only_clears(const uint8_t *have, const uint8_t *want)
+{
+	const uint8x16_t w = vld1q_u8(want);
+	return all_set(vceqq_u8(vandq_u8(vld1q_u8(have), w), w));
+}
+
+static inline bool chunk_writable(const uint8_t *have, const uint8_t *want, uint8_t erased_value)
+{
+	const uint8x16_t h = vld1q_u8(have);
+	return all_set(vorrq_u8(vceqq_u8(h, vld1q_u8(want)), vceqq_u8(h, vdupq_n_u8(erased_value))));
+}
+
+static inline bool chunk_is_value(const uint8_t *buf, uint8_t value)
+{
+	return all_set(vceqq_u8(vld1q_u8(buf), vdupq_n_u8(value)));
+}
+
+#else /* portable 64-bit word implementation */
+
+#define LOW_BITS	0x7f7f7f7f7f7f7f7fULL
+#define HIGH_BITS	0x8080808080808080ULL
+#define REPEAT_BYTE(x)	(0x0101010101010101ULL * (uint8_t)(x))
+
+static inline uint64_t load_word(const uint8_t *p)
+{
+	uint64_t w;
+	memcpy(&w, p, sizeof(w));
+	return w;
+}
+
+/* Sets the high bit of every byte of `x` that is zero, clears all other bits. */
+static inline uint64_t zero_bytes(uint64_t x)
+{
+	return ~(((x & LOW_BITS) + LOW_BITS) | x | LOW_BITS);
+}
+
+static inline bool chunk_all_eq(const uint8_t *a, const uint8_t *b)
+{
+	return load_word(a) == load_word(b) && load_word(a + 8) == load_word(b + 8);
+}
+
+static inline bool chunk_any_eq(const uint8_t *a, const uint8_t *b)
+{
+	return zero_bytes(load_word(a) ^ load_word(b)) ||
+	       zero_bytes(load_word(a + 8) ^ load_word(b + 8));
+}
+
+static inline bool chunk_only_clears(const uint8_t *have, const uint8_t *want)
+{
+	const uint64_t w0 = load_word(want), w1 = load_word(want + 8);
+	return (load_word(have) & w0) == w0 && (load_word(have + 8) & w1) == w1;
+}
+
+static inline bool word_writable(uint64_t h, uint64_t w, uint64_t erased)
+{
+	return (zero_bytes(h ^ w) | zero_bytes(h ^ erased)) == HIGH_BITS;
+}
+
+static inline bool chunk_writable(const uint8_t *have, const uint8_t *want, uint8_t erased_value)
+{
+	const uint64_t erased = REPEAT_BYTE(erased_value);
+	return word_writable(load_word(have), load_word(want), erased) &&
+	       word_writable(load_word(have + 8), load_word(want + 8), erased);
+}
+
+static inline bool chunk_is_value(const uint8_t *buf, uint8_t value)
+{
+	const uint64_t pattern = REPEAT_BYTE(value);
+	return load_word(buf) == pattern && load_word(buf + 8) == pattern;
+}
+
+#endif
+
+size_t contents_first_diff(const uint8_t *a, const uint8_t *b, size_t len)
+{
+	size_t i = 0;
+
+	while (i + CHUNK_SIZE <= len && chunk_all_eq(a + i, b + i))
+		i += CHUNK_SIZE;
+	for (; i < len; i++)
+		if (a[i] != b[i])
+			return i;
+	return len;
+}
+
+size_t contents_first_equal(const uint8_t *a, const uint8_t *b, size_t len)
+{
+	size_t i = 0;
+
+	while (i + CHUNK_SIZE <= len && !chunk_any_eq(a + i, b + i))
+		i += CHUNK_SIZE;
+	for (; i < len; i++)
+		if (a[i] == b[i])
+			return i;
+	return len;
+}
+
+bool contents_only_clears_bits(const uint8_t *have, const uint8_t *want, size_t len)
+{
+	size_t i = 0;
+
+	for (; i + CHUNK_SIZE <= len; i += CHUNK_SIZE)
+		if (!chunk_only_clears(have + i, want + i))
+			return false;
+	for (; i < len; i++)
+		if ((have[i] & want[i]) != want[i])
+			return false;
+	return true;
+}
+
+bool contents_bytes_writable(const uint8_t *have, const uint8_t *want, size_t len, uint8_t erased_value)
+{
+	size_t i = 0;
+
+	for (; i + CHUNK_SIZE <= len; i += CHUNK_SIZE)
+		if (!chunk_writable(have + i, want + i, erased_value))
+			return false;
+	for (; i < len; i++)
+		if (have[i] != want[i] && have[i] != erased_value)
+			return false;
+	return true;
+}
+
+bool contents_is_erased(const uint8_t *buf, size_t len, uint8_t erased_value)
+{
+	size_t i = 0;
+
+	for (; i + CHUNK_SIZE <= len; i += CHUNK_SIZE)
+		if (!chunk_is_value(buf + i, erased_value))
+			return false;
+	for (; i < len; i++)
+		if (buf[i] != erased_value)
+			return false;
+	return true;
+}
@@ -7,6 +7,8 @@
 
 #include "erasure_layout.h"
 
+#include "chipdrivers.h"
+#include "contents_diff.h"
 #include "flash.h"
 #include "layout.h"
 #include "helpers.h"
@@ -39,6 +41,12 @@ static void init_eraseblock(struct erase_layout *layout, size_t idx, size_t bloc
 	edata->start_addr = start_addr;
 	edata->end_addr = end_addr;
 	edata->selected = false;
+	edata->needs_erase = false;
+	edata->needs_program = false;
+	edata->verified = false;
+	edata->covered_by_verify = false;
+	edata->modified = false;
+	edata->reprogram_len = 0;
 	edata->block_num = block_num;
 
 	if (!idx)
@@ -107,6 +115,18 @@ int create_erase_layout(struct flashctx *const flashctx, struct erase_layout **e
 		const size_t block_count = calculate_block_count(flashctx->chip, eraser_idx);
 		size_t sub_block_index = 0;
 
+		/*
+		 * The dirty index and the erased/programmed bookkeeping live in layout[0],
+		 * sub-blocks are resolved against the previous eraser. Both only work if
+		 * the erasers are sorted from the smallest blocks to the largest.
+		 */
+		if (layout_idx && block_count > layout[layout_idx - 1].block_count) {
+			msg_gerr("%s: erase functions of %s %s are not sorted by block size\n",
+				 __func__, chip->vendor, chip->name);
+			free_erase_layout(layout, layout_idx);
+			return -1;
+		}
+
 		layout[layout_idx].block_count = block_count;
 		layout[layout_idx].layout_list = (struct eraseblock_data *)calloc(block_count,
 									sizeof(struct eraseblock_data));
@@ -204,6 +224,192 @@ static void deselect_erase_functions(const struct erase_layout *layout, size_t i
 		return; // index_to_deselect has already reached 0, the smallest size of block. we are done.
 }
 
+/* Returns the index of the smallest eraser's block containing addr. */
+static size_t smallest_block_at(const struct erase_layout *layout, chipoff_t addr)
+{
+	size_t lo = 0, hi = layout[0].block_count - 1;
+
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if (layout[0].layout_list[mid].end_addr < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/*
+ * @brief	Function to build the dirty index of a region
+ *
+ * @param	flashctx	flash context
+ * @param	layout		erase layout
+ * @param	curcontents	buffer containg the current contents of the flash
+ * @param	newcontents	buffer containg the new contents of the flash
+ * @param	rstart		start address of the region
+ * @param	rend		end address of the region
+ *
+ * Compares the current and new contents of the region in a single pass and
+ * records for every block of the smallest eraser whether it needs an erase
+ * and whether it needs programming. The erase selection and the write loop
+ * only consult these flags afterwards instead of rescanning the buffers.
+ */
+static void index_dirty_blocks(struct flashctx *flashctx, const struct erase_layout *layout,
+			       const uint8_t *curcontents, const uint8_t *newcontents,
+			       chipoff_t rstart, chipoff_t rend)
+{
+	const uint8_t erased_value = ERASED_VALUE(flashctx);
+
+	for (size_t i = smallest_block_at(layout, rstart); i < layout[0].block_count; i++) {
+		struct eraseblock_data *ll = &layout[0].layout_list[i];
+		if (ll->start_addr > rend)
+			break;
+
+		const chipoff_t start = max(ll->start_addr, rstart);
+		const chipsize_t len = min(ll->end_addr, rend) - start + 1;
+
+		ll->needs_program = contents_first_diff(curcontents + start, newcontents + start, len) != len;
+		ll->needs_erase = ll->needs_program &&
+				  need_erase(curcontents + start, newcontents + start, len,
+					     flashctx->chip->gran, erased_value);
+
+		/* Only the time-optimal planner weighs the cost of erasing unchanged data. */
+		ll->reprogram_len = 0;
+		if (flashctx->flags.time_optimal_erase && !ll->needs_erase) {
+			for (chipoff_t addr = start; addr < start + len; addr++)
+				if (newcontents[addr] != erased_value && newcontents[addr] == curcontents[addr])
+					ll->reprogram_len++;
+		}
+	}
+}
+
+/* Update the dirty index after the range [start, end] was erased. */
+static void mark_blocks_erased(struct flashctx *flashctx, const struct erase_layout *layout,
+			       const uint8_t *newcontents, chipoff_t start, chipoff_t end)
+{
+	const uint8_t erased_value = ERASED_VALUE(flashctx);
+
+	for (size_t i = smallest_block_at(layout, start); i < layout[0].block_count; i++) {
+		struct eraseblock_data *ll = &layout[0].layout_list[i];
+		if (ll->start_addr > end)
+			break;
+
+		const chipoff_t block_start = max(ll->start_addr, start);
+		const chipsize_t len = min(ll->end_addr, end) - block_start + 1;
+
+		ll->needs_erase = false;
+		ll->needs_program = !contents_is_erased(newcontents + block_start, len, erased_value);
+		ll->verified = false;
+		ll->modified = true;
+	}
+}
+
+/* A block needs to be read back after its erase unless the final verification reads it anyway. */
+static bool needs_erase_check(const struct eraseblock_data *ll)
+{
+	return !(ll->needs_program && ll->covered_by_verify);
+}
+
+/*
+ * @brief	Function to check that an erased range reads back as erased
+ *
+ * @param	flashctx	flash context
+ * @param	layout		erase layout
+ * @param	start		start address of the erased range
+ * @param	end		end address of the erased range
+ * @return	0 on success, -1 if the range is not erased or reading fails
+ *
+ * Blocks that are programmed afterwards and covered by the final verification
+ * are not read back here, the final verification checks both the erase and
+ * the write of them with a single read. Blocks that stay erased in the new
+ * contents are marked as verified, so the final verification skips them.
+ */
+static int check_erased_blocks(struct flashctx *flashctx, const struct erase_layout *layout,
+			       chipoff_t start, chipoff_t end)
+{
+	size_t i = smallest_block_at(layout, start);
+	while (i < layout[0].block_count && layout[0].layout_list[i].start_addr <= end) {
+		if (!needs_erase_check(&layout[0].layout_list[i])) {
+			i++;
+			continue;
+		}
+
+		const chipoff_t run_start = max(layout[0].layout_list[i].start_addr, start);
+		const size_t first = i;
+		while (i < layout[0].block_count && layout[0].layout_list[i].start_addr <= end &&
+		       needs_erase_check(&layout[0].layout_list[i]))
+			i++;
+		const chipoff_t run_end = min(layout[0].layout_list[i - 1].end_addr, end);
+
+		if (check_erased_range(flashctx, run_start, run_end - run_start + 1))
+			return -1;
+		for (size_t j = first; j < i; j++)
+			layout[0].layout_list[j].verified = !layout[0].layout_list[j].needs_program;
+	}
+	return 0;
+}
+
+/*
+ * @brief	Function to record which blocks a later verification will read
+ *
+ * @param	erase_layout	erase layout used for the write
+ * @param	layout		layout the verification after the write uses
+ *
+ * Only blocks completely inside an included region of `layout` are covered.
+ */
+void mark_verify_coverage(const struct erase_layout *erase_layout, const struct flashrom_layout *layout)
+{
+	const struct romentry *entry = NULL;
+
+	while ((entry = layout_next_included(layout, entry))) {
+		for (size_t i = smallest_block_at(erase_layout, entry->region.start);
+		     i < erase_layout[0].block_count; i++) {
+			struct eraseblock_data *ll = &erase_layout[0].layout_list[i];
+			if (ll->end_addr > entry->region.end)
+				break;
+			if (ll->start_addr >= entry->region.start)
+				ll->covered_by_verify = true;
+		}
+	}
+}
+
+static bool needs_verify(const struct eraseblock_data *ll, bool modified_only)
+{
+	return !ll->verified && (!modified_only || ll->modified);
+}
+
+/*
+ * @brief	Function to find the next range that was not verified yet
+ *
+ * @param	erase_layout	erase layout used for the write
+ * @param	start		pointer to the start address to search from, updated to the start of the range
+ * @param	end		end address of the search
+ * @param	len		pointer to store the length of the range
+ * @param	modified_only	only consider blocks that were erased or programmed during the write
+ * @return	true if a range was found, false if everything up to end is verified
+ */
+bool next_unverified_range(const struct erase_layout *erase_layout, chipoff_t *start, chipoff_t end,
+			   chipsize_t *len, bool modified_only)
+{
+	const struct eraseblock_data *list = erase_layout[0].layout_list;
+	const size_t count = erase_layout[0].block_count;
+
+	if (*start > end)
+		return false;
+
+	size_t i = smallest_block_at(erase_layout, *start);
+	while (i < count && list[i].start_addr <= end && !needs_verify(&list[i], modified_only))
+		i++;
+	if (i == count || list[i].start_addr > end)
+		return false;
+
+	*start = max(list[i].start_addr, *start);
+	while (i < count && list[i].start_addr <= end && needs_verify(&list[i], modified_only))
+		i++;
+	*len = min(list[i - 1].end_addr, end) - *start + 1;
+	return true;
+}
+
 /*
  * @brief	Function to select the list of sectors that need erasing
  *
@@ -211,33 +417,25 @@ static void deselect_erase_functions(const struct erase_layout *layout, size_t i
  * @param	layout		erase layout
  * @param	findex		index of the erase function
  * @param	block_num	index of the block to erase according to the erase function index
- * @param	curcontents	buffer containg the current contents of the flash
- * @param	newcontents	buffer containg the new contents of the flash
  * @param	rstart		start address of the region
  * @rend	rend		end address of the region
+ *
+ * The dirty index of the region must have been built with index_dirty_blocks().
  */
 static void select_erase_functions(struct flashctx *flashctx, const struct erase_layout *layout,
-				size_t findex, size_t block_num, uint8_t *curcontents, uint8_t *newcontents,
-				chipoff_t rstart, chipoff_t rend)
+				size_t findex, size_t block_num, chipoff_t rstart, chipoff_t rend)
 {
 	struct eraseblock_data *ll = &layout[findex].layout_list[block_num];
 	if (!findex) {
-		if (ll->start_addr >= rstart && ll->end_addr <= rend) {
-			chipoff_t start_addr = ll->start_addr;
-			chipoff_t end_addr = ll->end_addr;
-			const chipsize_t erase_len = end_addr - start_addr + 1;
-			const uint8_t erased_value = ERASED_VALUE(flashctx);
-			ll->selected = need_erase(curcontents + start_addr, newcontents + start_addr, erase_len,
-						flashctx->chip->gran, erased_value);
-		}
+		if (ll->start_addr >= rstart && ll->end_addr <= rend)
+			ll->selected = ll->needs_erase;
 	} else {
 		int count = 0;
 		const int sub_block_start = ll->first_sub_block_index;
 		const int sub_block_end = ll->last_sub_block_index;
 
 		for (int j = sub_block_start; j <= sub_block_end; j++) {
-			select_erase_functions(flashctx, layout, findex - 1, j, curcontents, newcontents,
-						rstart, rend);
+			select_erase_functions(flashctx, layout, findex - 1, j, rstart, rend);
 			if (layout[findex - 1].layout_list[j].selected)
 				count++;
 		}
@@ -263,20 +461,127 @@ static void select_erase_functions(struct flashctx *flashctx, const struct erase
 	}
 }
 
+/*
+ * Rough cost model of the time-optimal erase planner, in microseconds.
+ *
+ * SPI NOR erase times grow much slower than the block size, typical datasheet
+ * values are around 45ms for 4 KiB, 150ms for 64 KiB and 40s for a 16 MiB chip
+ * erase. Programming takes about 0.7ms per 256 byte page. Every erase also
+ * pays for the command itself and for polling the chip until it is done.
+ * Erase times measured earlier in the same session take precedence, then the
+ * typical erase and page program times of the chip if they are known (SFDP).
+ */
+#define ERASE_BASE_US		40000
+#define ERASE_NS_PER_BYTE	1700
+#define PROGRAM_NS_PER_BYTE	3000
+#define COMMAND_OVERHEAD_US	500
+
+static uint64_t erase_cost_us(const struct flashctx *flashctx, const struct block_eraser *eraser, chipsize_t len)
+{
+	/*
+	 * Busy times are only measured by spi_poll_wip(), keyed by SPI opcode, and
+	 * the opcode of an eraser is found through the SPI25 eraser table. Other
+	 * buses have no measurements, and looking their erasers up there would at
+	 * best find nothing, so they go by the datasheet timing.
+	 */
+	if (flashctx->chip->bustype == BUS_SPI) {
+		const unsigned int measured = spi_erase_busy_time(flashctx, eraser->block_erase);
+		if (measured)
+			return COMMAND_OVERHEAD_US + measured;
+	}
+	if (eraser->timing.typ_us)
+		return COMMAND_OVERHEAD_US + eraser->timing.typ_us;
+	return COMMAND_OVERHEAD_US + ERASE_BASE_US + (uint64_t)len * ERASE_NS_PER_BYTE / 1000;
+}
+
+/* Time to program back the data destroyed by erasing blocks that didn't need it. */
+static uint64_t sacrifice_cost_us(const struct flashctx *flashctx, const struct erase_layout *layout,
+				  chipoff_t start, chipoff_t end)
+{
+	const struct flashchip *chip = flashctx->chip;
+	uint64_t ns_per_byte = PROGRAM_NS_PER_BYTE;
+
+	if (chip->write == SPI_CHIP_WRITE1 && chip->byte_program.typ_us)
+		ns_per_byte = (uint64_t)chip->byte_program.typ_us * 1000;
+	else if (chip->write == SPI_CHIP_WRITE256 && chip->page_program.typ_us && chip->page_size)
+		ns_per_byte = (uint64_t)chip->page_program.typ_us * 1000 / chip->page_size;
+
+	uint64_t bytes = 0;
+
+	for (size_t i = smallest_block_at(layout, start);
+	     i < layout[0].block_count && layout[0].layout_list[i].start_addr <= end; i++) {
+		if (!layout[0].layout_list[i].needs_erase)
+			bytes += layout[0].layout_list[i].reprogram_len;
+	}
+	return bytes * ns_per_byte / 1000;
+}
+
+/*
+ * @brief	Function to select the erase blocks with the lowest estimated total time
+ *
+ * @param	flashctx	flash context
+ * @param	layout		erase layout
+ * @param	findex		index of the erase function
+ * @param	block_num	index of the block to erase according to the erase function index
+ * @param	rstart		start address of the region
+ * @param	rend		end address of the region
+ * @return	estimated time in microseconds to erase everything that needs it inside the block
+ *
+ * Alternative to select_erase_functions() that solves the selection bottom-up
+ * over the erase layout tree. A block is erased in one go if that is expected
+ * to be faster than the best selection of its sub-blocks, including the time
+ * to program back unchanged data it destroys. With a chip erase among the
+ * usable erasers this also covers erasing the whole chip.
+ */
+static uint64_t select_erase_functions_by_cost(struct flashctx *flashctx, const struct erase_layout *layout,
+					       size_t findex, size_t block_num, chipoff_t rstart, chipoff_t rend)
+{
+	struct eraseblock_data *ll = &layout[findex].layout_list[block_num];
+	const bool inside = ll->start_addr >= rstart && ll->end_addr <= rend;
+
+	if (!findex) {
+		ll->selected = inside && ll->needs_erase;
+		return ll->selected ? erase_cost_us(flashctx, layout[findex].eraser, ll->end_addr - ll->start_addr + 1) : 0;
+	}
+
+	uint64_t split_cost = 0;
+	for (size_t j = ll->first_sub_block_index; j <= ll->last_sub_block_index; j++)
+		split_cost += select_erase_functions_by_cost(flashctx, layout, findex - 1, j, rstart, rend);
+
+	if (!inside || !split_cost)
+		return split_cost;
+
+	const uint64_t whole_cost = erase_cost_us(flashctx, layout[findex].eraser, ll->end_addr - ll->start_addr + 1) +
+				    sacrifice_cost_us(flashctx, layout, ll->start_addr, ll->end_addr);
+	if (whole_cost >= split_cost)
+		return split_cost;
+
+	deselect_erase_functions(layout, findex - 1, ll->first_sub_block_index, ll->last_sub_block_index);
+	ll->selected = true;
+	return whole_cost;
+}
+
 static int erase_write_helper(struct flashctx *const flashctx, chipoff_t region_start, chipoff_t region_end,
 		uint8_t *curcontents, uint8_t *newcontents,
 		struct erase_layout *erase_layout, bool *all_skipped)
 {
 	const size_t erasefn_count = count_usable_erasers(flashctx);
 
+	index_dirty_blocks(flashctx, erase_layout, curcontents, newcontents, region_start, region_end);
+
 	// select erase functions
 	for (size_t i = 0; i < erase_layout[erasefn_count - 1].block_count; i++) {
 		if (erase_layout[erasefn_count - 1].layout_list[i].start_addr <= region_end &&
-			region_start <= erase_layout[erasefn_count - 1].layout_list[i].end_addr)
-			select_erase_functions(flashctx, erase_layout,
-						erasefn_count - 1, i,
-						curcontents, newcontents,
-						region_start, region_end);
+			region_start <= erase_layout[erasefn_count - 1].layout_list[i].end_addr) {
+			if (flashctx->flags.time_optimal_erase)
+				select_erase_functions_by_cost(flashctx, erase_layout,
+							       erasefn_count - 1, i,
+							       region_start, region_end);
+			else
+				select_erase_functions(flashctx, erase_layout,
+							erasefn_count - 1, i,
+							region_start, region_end);
+		}
 	}
 
 	// erase
@@ -288,6 +593,12 @@ static int erase_write_helper(struct flashctx *const flashctx, chipoff_t region_
 			chipoff_t start_addr = erase_layout[i].layout_list[j].start_addr;
 			unsigned int block_len = erase_layout[i].layout_list[j].end_addr - start_addr + 1;
 			const uint8_t erased_value = ERASED_VALUE(flashctx);
+
+			if (flashctx->cancel_requested) {
+				msg_cdbg("Cancelled before erasing at %#"PRIx32".\n", start_addr);
+				flashctx->cancelled = true;
+				return -1;
+			}
 			// execute erase
 			erasefunc_t *erasefn = lookup_erase_func_ptr(erase_layout[i].eraser);
 
@@ -295,16 +606,19 @@ static int erase_write_helper(struct flashctx *const flashctx, chipoff_t region_
 			if (erasefn(flashctx, start_addr, block_len)) {
 				return -1;
 			}
-			if (flashctx->flags.verify_after_write
-				&& check_erased_range(flashctx, start_addr, block_len)) {
-				msg_cerr("ERASE FAILED!\n");
-				return -1;
-			}
 
 			update_progress(flashctx, FLASHROM_PROGRESS_ERASE, block_len);
 
 			// adjust curcontents
 			memset(curcontents+start_addr, erased_value, block_len);
+			mark_blocks_erased(flashctx, erase_layout, newcontents,
+					   start_addr, start_addr + block_len - 1);
+
+			if (flashctx->flags.verify_after_write &&
+			    check_erased_blocks(flashctx, erase_layout, start_addr, start_addr + block_len - 1)) {
+				msg_cerr("ERASE FAILED!\n");
+				return -1;
+			}
 			// after erase make it unselected again
 			erase_layout[i].layout_list[j].selected = false;
 			msg_cdbg("E(%"PRIx32":%"PRIx32")", start_addr, start_addr + block_len - 1);
@@ -313,27 +627,47 @@ static int erase_write_helper(struct flashctx *const flashctx, chipoff_t region_
 		}
 	}
 
-	// write
-	unsigned int start_here = 0, len_here = 0, erase_len = region_end - region_start + 1;
-	while ((len_here = get_next_write(curcontents + region_start + start_here,
-					newcontents + region_start + start_here,
-					erase_len - start_here, &start_here,
-					flashctx->chip->gran))) {
-		// execute write
-		int ret = write_flash(flashctx,
-				newcontents + region_start + start_here,
-				region_start + start_here, len_here);
-		if (ret) {
-			msg_cerr("Write failed at %#x, Abort.\n", region_start + start_here);
-			return -1;
+	// write, only the runs of blocks the dirty index marks as needing it
+	size_t i = smallest_block_at(erase_layout, region_start);
+	while (i < erase_layout[0].block_count && erase_layout[0].layout_list[i].start_addr <= region_end) {
+		if (!erase_layout[0].layout_list[i].needs_program) {
+			i++;
+			continue;
 		}
 
-		// adjust curcontents
-		memcpy(curcontents + region_start + start_here,
-			newcontents + region_start + start_here, len_here);
-		msg_cdbg("W(%"PRIx32":%"PRIx32")", region_start + start_here, region_start + start_here + len_here - 1);
+		const chipoff_t run_start = max(erase_layout[0].layout_list[i].start_addr, region_start);
+		while (i < erase_layout[0].block_count &&
+		       erase_layout[0].layout_list[i].start_addr <= region_end &&
+		       erase_layout[0].layout_list[i].needs_program) {
+			erase_layout[0].layout_list[i].needs_program = false;
+			erase_layout[0].layout_list[i].verified = false;
+			erase_layout[0].layout_list[i].modified = true;
+			i++;
+		}
+		const chipoff_t run_end = min(erase_layout[0].layout_list[i - 1].end_addr, region_end);
+
+		unsigned int start_here = run_start, len_here = 0;
+		while ((len_here = get_next_write_burst(flashctx, curcontents, newcontents,
+							run_end + 1, &start_here))) {
+			if (flashctx->cancel_requested) {
+				msg_cdbg("Cancelled before writing at %#x.\n", start_here);
+				flashctx->cancelled = true;
+				return -1;
+			}
 
-		*all_skipped = false;
+			// execute write
+			int ret = write_flash(flashctx, newcontents + start_here, start_here, len_here);
+			if (ret) {
+				msg_cerr("Write failed at %#x, Abort.\n", start_here);
+				return -1;
+			}
+
+			// adjust curcontents
+			memcpy(curcontents + start_here, newcontents + start_here, len_here);
+			msg_cdbg("W(%"PRIx32":%"PRIx32")", start_here, start_here + len_here - 1);
+
+			*all_skipped = false;
+		}
 	}
 
 	return 0;
@@ -394,26 +728,27 @@ int erase_write(struct flashctx *const flashctx, chipoff_t region_start, chipoff
 
 	unsigned int len;
 	for (unsigned int addr = region_start; addr <= region_end; addr += len) {
-		struct flash_region region;
-		get_flash_region(flashctx, addr, &region);
-		len = min(region_end, region.end) - addr + 1;
+		const struct flash_region *region = lookup_flash_region(flashctx, addr);
+		if (!region) {
+			ret = -1;
+			goto _end;
+		}
+		len = min(region_end, region->end) - addr + 1;
 
-		if (region.write_prot) {
+		if (region->write_prot) {
 			msg_gdbg("%s: cannot erase inside %s "
 				"region (%#08"PRIx32"..%#08"PRIx32"), skipping range (%#08x..%#08x).\n",
-				 __func__, region.name,
-				 region.start, region.end,
+				 __func__, region->name,
+				 region->start, region->end,
 				 addr, addr + len - 1);
-			free(region.name);
 			continue;
 		}
 
 		msg_gdbg("%s: %s region (%#08"PRIx32"..%#08"PRIx32") is "
 			"writable, erasing range (%#08x..%#08x).\n",
-			 __func__, region.name,
-			 region.start, region.end,
+			 __func__, region->name,
+			 region->start, region->end,
 			 addr, addr + len - 1);
-		free(region.name);
 
 
 		ret = erase_write_helper(flashctx, addr, addr + len - 1, curcontents, newcontents, erase_layout, all_skipped);
@@ -434,3 +769,248 @@ _end:
 	msg_cinfo("Erase/write done from %"PRIx32" to %"PRIx32"\n", region_start, region_end);
 	return ret;
 }
+
+/*
+ * Returns the index of the erase function whose blocks are used as windows by
+ * write_region_windowed(): the largest one without blocks bigger than
+ * REGION_WINDOW_SIZE, or the smallest one if all of them have bigger blocks.
+ */
+static size_t window_eraser_index(const struct erase_layout *layout, size_t erasefn_count)
+{
+	size_t index = 0;
+
+	for (size_t i = 1; i < erasefn_count; i++) {
+		for (size_t j = 0; j < layout[i].block_count; j++) {
+			const struct eraseblock_data *ll = &layout[i].layout_list[j];
+			if (ll->end_addr - ll->start_addr + 1 > REGION_WINDOW_SIZE)
+				return index;
+		}
+		index = i;
+	}
+	return index;
+}
+
+static bool range_is_write_protected(struct flashctx *flashctx, chipoff_t start, chipsize_t len)
+{
+	const struct flash_region *region;
+
+	for (chipoff_t addr = start; addr < start + len; addr = region->end + 1) {
+		region = lookup_flash_region(flashctx, addr);
+		if (!region || region->write_prot)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Like select_erase_functions(), but for a single window. The contents buffers
+ * only hold the window starting at `window_start`. Larger blocks are never
+ * chosen over a write-protected range, their smaller blocks are used instead.
+ */
+static void select_window_erase(struct flashctx *flashctx, const struct erase_layout *layout,
+				size_t findex, size_t block_num, const uint8_t *curcontents,
+				const uint8_t *newcontents, chipoff_t window_start)
+{
+	struct eraseblock_data *ll = &layout[findex].layout_list[block_num];
+
+	if (!findex) {
+		const chipoff_t offset = ll->start_addr - window_start;
+		ll->selected = need_erase(curcontents + offset, newcontents + offset,
+					  ll->end_addr - ll->start_addr + 1,
+					  flashctx->chip->gran, ERASED_VALUE(flashctx));
+		return;
+	}
+
+	int count = 0;
+	const int sub_block_start = ll->first_sub_block_index;
+	const int sub_block_end = ll->last_sub_block_index;
+
+	for (int j = sub_block_start; j <= sub_block_end; j++) {
+		select_window_erase(flashctx, layout, findex - 1, j, curcontents, newcontents, window_start);
+		if (layout[findex - 1].layout_list[j].selected)
+			count++;
+	}
+
+	const int total_blocks = sub_block_end - sub_block_start + 1;
+	if (count && total_blocks - count <= total_blocks * flashctx->sacrifice_ratio / 100 &&
+	    !range_is_write_protected(flashctx, ll->start_addr, ll->end_addr - ll->start_addr + 1)) {
+		deselect_erase_functions(layout, findex - 1, sub_block_start, sub_block_end);
+		ll->selected = true;
+	}
+}
+
+/*
+ * Copies the new contents of `len` bytes at chip offset `start` into the
+ * window buffer `window`, except for write-protected parts. Returns the number
+ * of bytes copied, or -1 if a part is protected and protected regions aren't
+ * skipped. With a NULL `window`, it only counts and logs.
+ */
+static int overlay_writable(struct flashctx *flashctx, uint8_t *window, chipoff_t window_start,
+			    const uint8_t *buf, chipoff_t buf_start, chipoff_t start, chipsize_t len)
+{
+	const struct flash_region *region;
+	chipsize_t copied = 0, part;
+
+	for (chipoff_t addr = start; addr < start + len; addr += part) {
+		region = lookup_flash_region(flashctx, addr);
+		if (!region)
+			return -1;
+		part = min(start + len - 1, region->end) - addr + 1;
+
+		if (!region->write_prot) {
+			if (window)
+				memcpy(window + addr - window_start, buf + addr - buf_start, part);
+			copied += part;
+		} else if (!flashctx->flags.skip_unwritable_regions) {
+			msg_cerr("%s: cannot write inside %s region (%#08"PRIx32"..%#08"PRIx32").\n",
+				 __func__, region->name, addr, addr + part - 1);
+			return -1;
+		} else if (!window) {
+			msg_gdbg("%s: skipping protected range (%#08"PRIx32"..%#08"PRIx32").\n",
+				 __func__, addr, addr + part - 1);
+		}
+	}
+	return copied;
+}
+
+/*
+ * @brief	Writes a range of the chip, holding only one erase block window of contents at a time
+ *
+ * @param	flashctx	flash context
+ * @param	erase_layout	erase layout
+ * @param	start		chip offset to write to
+ * @param	len		number of bytes to write
+ * @param	buf		new contents of the range
+ * @param	all_skipped	pointer to the flag to check if anything was erased or written
+ * @return	0 on success, -1 on failure
+ *
+ * The range is processed in windows formed by the blocks of the largest erase
+ * function with blocks of at most REGION_WINDOW_SIZE. Every window touched by
+ * the range is read, merged with `buf` and brought to the new contents with
+ * the cheapest combination of erase blocks inside it. Memory use is bounded
+ * by two windows instead of two copies of the whole chip, at the cost of never
+ * choosing erase blocks larger than a window. Write-protected bytes of the
+ * range fail the write, or are left alone with skip_unwritable_regions.
+ */
+int write_region_windowed(struct flashctx *const flashctx, struct erase_layout *const erase_layout,
+			  chipoff_t start, chipsize_t len, const uint8_t *buf, bool *all_skipped)
+{
+	const size_t top = window_eraser_index(erase_layout, count_usable_erasers(flashctx));
+	const struct erase_layout *const windows = &erase_layout[top];
+	const chipoff_t end = start + len - 1;
+	size_t first[NUM_ERASEFUNCTIONS], last[NUM_ERASEFUNCTIONS];
+	chipsize_t window_max = 0, span = 0;
+	uint8_t *curcontents = NULL, *newcontents = NULL;
+	int ret = -1;
+
+	for (size_t w = 0; w < windows->block_count && windows->layout_list[w].start_addr <= end; w++) {
+		const struct eraseblock_data *const window = &windows->layout_list[w];
+		if (window->end_addr < start)
+			continue;
+		window_max = max(window_max, window->end_addr - window->start_addr + 1);
+		span += window->end_addr - window->start_addr + 1;
+	}
+
+	curcontents = malloc(window_max);
+	newcontents = malloc(window_max);
+	if (!curcontents || !newcontents) {
+		msg_gerr("Out of memory!\n");
+		goto _free_ret;
+	}
+
+	init_progress(flashctx, FLASHROM_PROGRESS_READ, span);
+	init_progress(flashctx, FLASHROM_PROGRESS_ERASE, span);
+	init_progress(flashctx, FLASHROM_PROGRESS_WRITE, span);
+
+	for (size_t w = 0; w < windows->block_count && windows->layout_list[w].start_addr <= end; w++) {
+		const struct eraseblock_data *const window = &windows->layout_list[w];
+		if (window->end_addr < start)
+			continue;
+
+		const chipoff_t window_start = window->start_addr;
+		const chipsize_t window_len = window->end_addr - window_start + 1;
+		const chipoff_t copy_start = max(window_start, start);
+		const chipsize_t copy_len = min(window->end_addr, end) - copy_start + 1;
+
+		// only the requested bytes matter, protected data elsewhere in the window is preserved
+		const int writable = overlay_writable(flashctx, NULL, window_start, buf, start, copy_start, copy_len);
+		if (writable < 0)
+			goto _free_ret;
+		if (!writable)
+			continue;
+
+		if (read_flash(flashctx, curcontents, window_start, window_len))
+			goto _free_ret;
+		memcpy(newcontents, curcontents, window_len);
+		overlay_writable(flashctx, newcontents, window_start, buf, start, copy_start, copy_len);
+		if (contents_first_diff(curcontents, newcontents, window_len) == window_len)
+			continue;
+
+		// select and erase the blocks of this window
+		select_window_erase(flashctx, erase_layout, top, w, curcontents, newcontents, window_start);
+		first[top] = last[top] = w;
+		for (size_t i = top; i > 0; i--) {
+			first[i - 1] = erase_layout[i].layout_list[first[i]].first_sub_block_index;
+			last[i - 1] = erase_layout[i].layout_list[last[i]].last_sub_block_index;
+		}
+
+		for (size_t i = 0; i <= top; i++) {
+			for (size_t j = first[i]; j <= last[i]; j++) {
+				struct eraseblock_data *const block = &erase_layout[i].layout_list[j];
+				if (!block->selected)
+					continue;
+				block->selected = false;
+
+				const unsigned int block_len = block->end_addr - block->start_addr + 1;
+				if (range_is_write_protected(flashctx, block->start_addr, block_len)) {
+					msg_cerr("%s: cannot erase block (%#08"PRIx32"..%#08"PRIx32"), "
+						 "it overlaps a protected range.\n",
+						 __func__, block->start_addr, block->end_addr);
+					goto _free_ret;
+				}
+				if (flashctx->cancel_requested) {
+					msg_cdbg("Cancelled before erasing at %#"PRIx32".\n", block->start_addr);
+					flashctx->cancelled = true;
+					goto _free_ret;
+				}
+				erasefunc_t *erasefn = lookup_erase_func_ptr(erase_layout[i].eraser);
+				if (erasefn(flashctx, block->start_addr, block_len))
+					goto _free_ret;
+				update_progress(flashctx, FLASHROM_PROGRESS_ERASE, block_len);
+
+				if (flashctx->flags.verify_after_write &&
+				    check_erased_range(flashctx, block->start_addr, block_len)) {
+					msg_cerr("ERASE FAILED!\n");
+					goto _free_ret;
+				}
+				memset(curcontents + block->start_addr - window_start, ERASED_VALUE(flashctx), block_len);
+				msg_cdbg("E(%"PRIx32":%"PRIx32")", block->start_addr, block->end_addr);
+				*all_skipped = false;
+			}
+		}
+
+		// write what still differs, including data of the window outside the range that was erased
+		unsigned int start_here = 0, len_here;
+		while ((len_here = get_next_write_burst(flashctx, curcontents, newcontents, window_len, &start_here))) {
+			if (flashctx->cancel_requested) {
+				msg_cdbg("Cancelled before writing at %#x.\n", window_start + start_here);
+				flashctx->cancelled = true;
+				goto _free_ret;
+			}
+			if (write_flash(flashctx, newcontents + start_here, window_start + start_here, len_here)) {
+				msg_cerr("Write failed at %#x, Abort.\n", window_start + start_here);
+				goto _free_ret;
+			}
+			memcpy(curcontents + start_here, newcontents + start_here, len_here);
+			msg_cdbg("W(%"PRIx32":%"PRIx32")", window_start + start_here,
+				 window_start + start_here + len_here - 1);
+			*all_skipped = false;
+		}
+	}
+	ret = 0;
+
+_free_ret:
+	free(curcontents);
+	free(newcontents);
+	return ret;
+}
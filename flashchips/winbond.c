@@ -108,7 +108,8 @@
 		/* supports SFDP */
 		/* OTP: 1024B total, 256B reserved; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
 		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP |
-				  FEATURE_WRSR_EXT2 | FEATURE_WRSR2 | FEATURE_WRSR3,
+				  FEATURE_WRSR_EXT2 | FEATURE_WRSR2 | FEATURE_WRSR3 |
+				  FEATURE_DUAL_READ | FEATURE_QUAD_READ | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREWB,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -144,6 +145,7 @@
 			.tb	= {STATUS1, 5, RW},
 			.sec	= {STATUS1, 6, RW},
 			.cmp	= {STATUS2, 6, RW},
+			.qe	= {STATUS2, 1, RW},
 			.wps	= {STATUS3, 2, RW},
 		},
 		.decode_range	= DECODE_RANGE_SPI25,
@@ -357,7 +359,8 @@
 		.page_size	= 256,
 		/* supports SFDP */
 		/* OTP: 1024B total, 256B reserved; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
-		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_WRSR2,
+		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_WRSR2 |
+				  FEATURE_DUAL_READ | FEATURE_QUAD_READ | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREWB,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -393,6 +396,7 @@
 			.tb     = {STATUS1, 5, RW},
 			.sec    = {STATUS1, 6, RW},
 			.cmp    = {STATUS2, 6, RW},
+			.qe     = {STATUS2, 1, RW},
 		},
 		.decode_range	= DECODE_RANGE_SPI25,
 	},
@@ -488,7 +492,7 @@
 		/* OTP: 1024B total, 256B reserved; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
 		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_4BA_ENTER_WREN |
 				  FEATURE_4BA_EAR_C5C8 | FEATURE_4BA_READ | FEATURE_4BA_FAST_READ |
-				  FEATURE_WRSR2,
+				  FEATURE_WRSR2 | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREW,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -913,7 +917,8 @@
 		.page_size	= 256,
 		/* supports SFDP */
 		/* OTP: 1024B total, 256B reserved; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
-		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_WRSR_EXT2,
+		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_WRSR_EXT2 |
+				  FEATURE_DUAL_READ | FEATURE_QUAD_READ | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREW,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -949,6 +954,7 @@
 			.tb     = {STATUS1, 5, RW},
 			.sec    = {STATUS1, 6, RW},
 			.cmp    = {STATUS2, 6, RW},
+			.qe     = {STATUS2, 1, RW},
 		},
 		.decode_range	= DECODE_RANGE_SPI25,
 	},
@@ -964,7 +970,8 @@
 		/* supports SFDP */
 		/* OTP: 1024B total, 256B reserved; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
 		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_QPI |
-				  FEATURE_WRSR_EXT2 | FEATURE_WRSR2 | FEATURE_WRSR3,
+				  FEATURE_WRSR_EXT2 | FEATURE_WRSR2 | FEATURE_WRSR3 |
+				  FEATURE_DUAL_READ | FEATURE_QUAD_READ | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREW,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -1000,6 +1007,7 @@
 			.tb     = {STATUS1, 5, RW},
 			.sec    = {STATUS1, 6, RW},
 			.cmp    = {STATUS2, 6, RW},
+			.qe     = {STATUS2, 1, RW},
 			.wps    = {STATUS3, 2, RW},
 		},
 		.decode_range	= DECODE_RANGE_SPI25,
@@ -1068,7 +1076,8 @@
 		/* supports SFDP */
 		/* OTP: 1024B total, 256B reserved; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
 		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP |
-				  FEATURE_WRSR_EXT2 | FEATURE_WRSR2 | FEATURE_WRSR3,
+				  FEATURE_WRSR_EXT2 | FEATURE_WRSR2 | FEATURE_WRSR3 |
+				  FEATURE_DUAL_READ | FEATURE_QUAD_READ | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREW,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -1104,6 +1113,7 @@
 			.tb     = {STATUS1, 5, RW},
 			.sec    = {STATUS1, 6, RW},
 			.cmp    = {STATUS2, 6, RW},
+			.qe     = {STATUS2, 1, RW},
 			.wps    = {STATUS3, 2, RW},
 		},
 		.decode_range	= DECODE_RANGE_SPI25,
@@ -1325,7 +1335,7 @@
 		.page_size	= 256,
 		/* supports SFDP */
 		/* OTP: 756B total; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
-		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP,
+		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREW,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -1441,7 +1451,7 @@
 		.model_id	= WINBOND_NEX_W25Q512JV,
 		.total_size	= 64 * 1024,
 		.page_size	= 256,
-		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_4BA,
+		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_4BA | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREW,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -1485,7 +1495,7 @@
 		.model_id	= WINBOND_NEX_W25Q01JV,
 		.total_size	= 128 * 1024,
 		.page_size	= 256,
-		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_4BA,
+		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_4BA | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREW,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -1585,7 +1595,8 @@
 		.page_size	= 256,
 		/* supports SFDP */
 		/* OTP: 1024B total, 256B reserved; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
-		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_WRSR2,
+		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_WRSR2 |
+				  FEATURE_DUAL_READ | FEATURE_QUAD_READ | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREWB,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -1621,6 +1632,7 @@
 			.tb	= {STATUS1, 5, RW},
 			.sec	= {STATUS1, 6, RW},
 			.cmp	= {STATUS2, 6, RW},
+			.qe	= {STATUS2, 1, RW},
 		},
 		.decode_range	= DECODE_RANGE_SPI25,
 	},
@@ -1636,7 +1648,8 @@
 		/* supports SFDP */
 		/* OTP: 1024B total, 256B reserved; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
 		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP |
-				  FEATURE_WRSR_EXT2 | FEATURE_WRSR2 | FEATURE_WRSR3,
+				  FEATURE_WRSR_EXT2 | FEATURE_WRSR2 | FEATURE_WRSR3 |
+				  FEATURE_DUAL_READ | FEATURE_QUAD_READ | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREWB,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -1672,6 +1685,7 @@
 			.tb	= {STATUS1, 5, RW},
 			.sec	= {STATUS1, 6, RW},
 			.cmp	= {STATUS2, 6, RW},
+			.qe	= {STATUS2, 1, RW},
 			.wps	= {STATUS3, 2, RW},
 		},
 		.decode_range	= DECODE_RANGE_SPI25,
@@ -1687,7 +1701,7 @@
 		.page_size	= 256,
 		/* supports SFDP */
 		/* QPI enable 0x38 */
-		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_QPI,
+		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_QPI | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREW,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -1828,7 +1842,8 @@
 		.page_size	= 256,
 		/* supports SFDP */
 		/* OTP: 1024B total, 256B reserved; read 0x48; write 0x42, erase 0x44, read ID 0x4B */
-		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_WRSR_EXT2,
+		.feature_bits	= FEATURE_WRSR_WREN | FEATURE_OTP | FEATURE_WRSR_EXT2 |
+				  FEATURE_DUAL_READ | FEATURE_QUAD_READ | FEATURE_UNIQUE_ID,
 		.tested		= TEST_OK_PREWB,
 		.probe		= PROBE_SPI_RDID,
 		.probe_timing	= TIMING_ZERO,
@@ -1864,6 +1879,7 @@
 			.tb     = {STATUS1, 5, RW},
 			.sec    = {STATUS1, 6, RW},
 			.cmp    = {STATUS2, 6, RW},
+			.qe     = {STATUS2, 1, RW},
 		},
 		.decode_range	= DECODE_RANGE_SPI25,
 	},
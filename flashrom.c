@@ -17,6 +17,7 @@
 #include "hwaccess_physmap.h"
 #include "chipdrivers.h"
 #include "erasure_layout.h"
+#include "contents_diff.h"
 #include "platform/udelay.h"
 #include "helpers.h"
 #include "log.h"
@@ -131,6 +132,11 @@ int programmer_init(const struct programmer_entry *prog, const char *param)
 		msg_perr("Invalid programmer specified!\n");
 		return -1;
 	}
+	if (programmer) {
+		msg_perr("Programmer %s is still initialized, shut it down before initializing %s.\n",
+			 programmer->name, prog->name);
+		return ERROR_FLASHROM_LIMIT;
+	}
 	programmer = prog;
 	/* Initialize all programmer specific data. */
 	/* Default to unlimited decode sizes. */
@@ -197,6 +203,7 @@ int programmer_shutdown(void)
 		ret |= shutdown_fn[i].func(shutdown_fn[i].data);
 	}
 	registered_master_count = 0;
+	programmer = NULL;
 
 	return ret;
 }
@@ -392,19 +399,93 @@ void release_protected_ranges(const struct flashctx *flash, struct protected_ran
 	*ranges = (const struct protected_ranges){ 0 };
 }
 
-int check_for_unwritable_regions(const struct flashctx *flash, unsigned int start, unsigned int len)
+void release_flash_region_table(struct flashctx *flash)
+{
+	for (size_t i = 0; i < flash->region_table_len; i++)
+		free(flash->region_table[i].name);
+	free(flash->region_table);
+	flash->region_table = NULL;
+	flash->region_table_len = 0;
+}
+
+/*
+ * Queries the access regions of the whole chip from the programmer once and
+ * stores them in the flash context, in ascending order. Entry i covers the
+ * addresses from the end of entry i - 1 (exclusive) to its own end.
+ */
+int build_flash_region_table(struct flashctx *flash)
+{
+	const unsigned int size = flashrom_flash_getsize(flash);
+	struct flash_region *table = NULL;
+	size_t len = 0, capacity = 0;
+
+	release_flash_region_table(flash);
+
+	for (unsigned int addr = 0; addr < size; addr = table[len - 1].end + 1) {
+		if (len == capacity) {
+			capacity = capacity ? 2 * capacity : 8;
+			struct flash_region *const grown = realloc(table, capacity * sizeof(*table));
+			if (!grown) {
+				msg_gerr("Out of memory!\n");
+				goto _err;
+			}
+			table = grown;
+		}
+
+		get_flash_region(flash, addr, &table[len++]);
+		if (table[len - 1].end < addr) {
+			msg_gerr("%s: programmer reported an invalid region for %#08x.\n", __func__, addr);
+			goto _err;
+		}
+		table[len - 1].end = min(table[len - 1].end, size - 1);
+	}
+
+	flash->region_table = table;
+	flash->region_table_len = len;
+	return 0;
+
+_err:
+	for (size_t i = 0; i < len; i++)
+		free(table[i].name);
+	free(table);
+	return 1;
+}
+
+/*
+ * Returns the access region containing @addr, building the region table
+ * first if necessary. The region is owned by the flash context and stays
+ * valid until finalize_flash_access(). Returns NULL if the table could not
+ * be built.
+ */
+const struct flash_region *lookup_flash_region(struct flashctx *flash, unsigned int addr)
 {
-	struct flash_region region;
-	for (unsigned int addr = start; addr < start + len; addr = region.end + 1) {
-		get_flash_region(flash, addr, &region);
+	if (!flash->region_table && build_flash_region_table(flash))
+		return NULL;
 
-		if (region.write_prot) {
+	size_t lo = 0, hi = flash->region_table_len - 1;
+	while (lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if (flash->region_table[mid].end < addr)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return &flash->region_table[lo];
+}
+
+int check_for_unwritable_regions(struct flashctx *flash, unsigned int start, unsigned int len)
+{
+	const struct flash_region *region;
+	for (unsigned int addr = start; addr < start + len; addr = region->end + 1) {
+		region = lookup_flash_region(flash, addr);
+		if (!region)
+			return -1;
+
+		if (region->write_prot) {
 			msg_gerr("%s: cannot write/erase inside %s region (%#08"PRIx32"..%#08"PRIx32").\n",
-				 __func__, region.name, region.start, region.end);
-			free(region.name);
+				 __func__, region->name, region->start, region->end);
 			return -1;
 		}
-		free(region.name);
 	}
 	return 0;
 }
@@ -539,8 +620,8 @@ unsigned int count_usable_erasers(const struct flashctx *flash)
 static int compare_range(const uint8_t *wantbuf, const uint8_t *havebuf, unsigned int start, unsigned int len)
 {
 	int ret = 0, failcount = 0;
-	unsigned int i;
-	for (i = 0; i < len; i++) {
+	unsigned int i = contents_first_diff(wantbuf, havebuf, len);
+	for (; i < len; i++) {
 		if (wantbuf[i] != havebuf[i]) {
 			/* Only print the first failure. */
 			if (!failcount++)
@@ -618,32 +699,30 @@ int read_flash(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigne
 {
 	unsigned int read_len;
 	for (unsigned int addr = start; addr < start + len; addr += read_len) {
-		struct flash_region region;
-		get_flash_region(flash, addr, &region);
+		const struct flash_region *region = lookup_flash_region(flash, addr);
+		if (!region)
+			return -1;
 
-		read_len = min(start + len, region.end + 1) - addr;
+		read_len = min(start + len, region->end + 1) - addr;
 		uint8_t *rbuf = buf + addr - start;
 
-		if (region.read_prot) {
+		if (region->read_prot) {
 			if (flash->flags.skip_unreadable_regions) {
 				msg_gdbg("%s: cannot read inside %s region (%#08"PRIx32"..%#08"PRIx32"), "
 					 "filling (%#08x..%#08x) with erased value instead.\n",
-					 __func__, region.name, region.start, region.end,
+					 __func__, region->name, region->start, region->end,
 					 addr, addr + read_len - 1);
-				free(region.name);
 
 				memset(rbuf, ERASED_VALUE(flash), read_len);
 				continue;
 			}
 
 			msg_gerr("%s: cannot read inside %s region (%#08"PRIx32"..%#08"PRIx32").\n",
-				 __func__, region.name, region.start, region.end);
-			free(region.name);
+				 __func__, region->name, region->start, region->end);
 			return -1;
 		}
 		msg_gdbg("%s: %s region (%#08"PRIx32"..%#08"PRIx32") is readable, reading range (%#08x..%#08x).\n",
-			 __func__, region.name, region.start, region.end, addr, addr + read_len - 1);
-		free(region.name);
+			 __func__, region->name, region->start, region->end, addr, addr + read_len - 1);
 
 		read_func_t *read_func = lookup_read_func_ptr(flash->chip);
 		int ret = read_func(flash, rbuf, addr, read_len);
@@ -688,28 +767,28 @@ int verify_range(struct flashctx *flash, const uint8_t *cmpbuf, unsigned int sta
 
 	unsigned int read_len;
 	for (size_t addr = start; addr < start + len; addr += read_len) {
-		struct flash_region region;
-		get_flash_region(flash, addr, &region);
-		read_len = min(start + len, region.end + 1) - addr;
+		const struct flash_region *region = lookup_flash_region(flash, addr);
+		if (!region) {
+			ret = -1;
+			goto out_free;
+		}
+		read_len = min(start + len, region->end + 1) - addr;
 
-		if ((region.write_prot && flash->flags.skip_unwritable_regions) ||
-		    (region.read_prot  && flash->flags.skip_unreadable_regions)) {
+		if ((region->write_prot && flash->flags.skip_unwritable_regions) ||
+		    (region->read_prot  && flash->flags.skip_unreadable_regions)) {
 			msg_gdbg("%s: Skipping verification of %s region (%#08"PRIx32"..%#08"PRIx32")\n",
-				 __func__, region.name, region.start, region.end);
-			free(region.name);
+				 __func__, region->name, region->start, region->end);
 			continue;
 		}
 
-		if (region.read_prot) {
+		if (region->read_prot) {
 			msg_gerr("%s: Verification imposible because %s region (%#08"PRIx32"..%#08"PRIx32") is unreadable.\n",
-				 __func__, region.name, region.start, region.end);
-			free(region.name);
+				 __func__, region->name, region->start, region->end);
 			goto out_free;
 		}
 
 		msg_gdbg("%s: Verifying %s region (%#08"PRIx32"..%#08"PRIx32")\n",
-			 __func__, region.name, region.start, region.end);
-		free(region.name);
+			 __func__, region->name, region->start, region->end);
 
 		ret = read_flash(flash, readbuf, addr, read_len);
 		if (ret) {
@@ -734,16 +813,15 @@ out_free:
 static int need_erase_gran_bytes(const uint8_t *have, const uint8_t *want, unsigned int len,
                                  unsigned int gran, const uint8_t erased_value)
 {
-	unsigned int i, j, limit;
+	unsigned int j, limit;
 	for (j = 0; j < len / gran; j++) {
 		limit = min (gran, len - j * gran);
 		/* Are 'have' and 'want' identical? */
-		if (!memcmp(have + j * gran, want + j * gran, limit))
+		if (contents_first_diff(have + j * gran, want + j * gran, limit) == limit)
 			continue;
 		/* have needs to be in erased state. */
-		for (i = 0; i < limit; i++)
-			if (have[j * gran + i] != erased_value)
-				return 1;
+		if (!contents_is_erased(have + j * gran, limit, erased_value))
+			return 1;
 	}
 	return 0;
 }
@@ -766,22 +844,13 @@ int need_erase(const uint8_t *have, const uint8_t *want, unsigned int len,
                enum write_granularity gran, const uint8_t erased_value)
 {
 	int result = 0;
-	unsigned int i;
 
 	switch (gran) {
 	case WRITE_GRAN_1BIT:
-		for (i = 0; i < len; i++)
-			if ((have[i] & want[i]) != want[i]) {
-				result = 1;
-				break;
-			}
+		result = !contents_only_clears_bits(have, want, len);
 		break;
 	case WRITE_GRAN_1BYTE:
-		for (i = 0; i < len; i++)
-			if ((have[i] != want[i]) && (have[i] != erased_value)) {
-				result = 1;
-				break;
-			}
+		result = !contents_bytes_writable(have, want, len, erased_value);
 		break;
 	case WRITE_GRAN_128BYTES:
 		result = need_erase_gran_bytes(have, want, len, 128, erased_value);
@@ -834,9 +903,8 @@ int need_erase(const uint8_t *have, const uint8_t *want, unsigned int len,
  * @return	length of the first contiguous area which needs to be written
  *		0 if no write is needed
  *
- * FIXME: This function needs a parameter which tells it about coalescing
- * in relation to the max write length of the programmer and the max write
- * length of the chip.
+ * This function does not coalesce nearby areas, see get_next_write_burst()
+ * for a variant which does.
  */
 unsigned int get_next_write(const uint8_t *have, const uint8_t *want, unsigned int len,
 			  unsigned int *first_start,
@@ -881,7 +949,19 @@ unsigned int get_next_write(const uint8_t *have, const uint8_t *want, unsigned i
 		 */
 		return 0;
 	}
-	for (i = 0; i < len / stride; i++) {
+	if (stride == 1) {
+		/* Bytewise granularity, find the differing run directly. */
+		rel_start = contents_first_diff(have, want, len);
+		if (rel_start == len)
+			return 0;
+		first_len = contents_first_equal(have + rel_start, want + rel_start, len - rel_start);
+		*first_start += rel_start;
+		return first_len;
+	}
+
+	/* Skip the identical head of the range in one go. */
+	i = contents_first_diff(have, want, len / stride * stride) / stride;
+	for (; i < len / stride; i++) {
 		limit = min(stride, len - i * stride);
 		/* Are 'have' and 'want' identical? */
 		if (memcmp(have + i * stride, want + i * stride, limit)) {
@@ -905,6 +985,83 @@ unsigned int get_next_write(const uint8_t *have, const uint8_t *want, unsigned i
 	return first_len;
 }
 
+/*
+ * Returns the size of the chunks spi_write_chunked() splits a write into, or
+ * 0 if writes to this chip should not be coalesced. Coalescing rewrites bytes
+ * that already hold their desired value, which is only harmless for
+ * granularities that allow writing a location more than once.
+ */
+static unsigned int write_burst_chunk_size(const struct flashctx *flash)
+{
+	if (flash->chip->gran != WRITE_GRAN_1BIT && flash->chip->gran != WRITE_GRAN_1BYTE_IMPLICIT_ERASE)
+		return 0;
+	if (flash->chip->write != SPI_CHIP_WRITE256 || !flash->chip->page_size ||
+	    !(flash->mst->buses_supported & flash->chip->bustype & BUS_SPI))
+		return 0;
+
+	if (flash->mst->spi.max_data_write == MAX_DATA_UNSPECIFIED)
+		return flash->chip->page_size;
+	return min(flash->chip->page_size, flash->mst->spi.max_data_write);
+}
+
+/* Number of program commands spi_write_chunked() issues for the range. */
+static unsigned int write_command_count(unsigned int start, unsigned int len,
+					unsigned int page_size, unsigned int chunk_size)
+{
+	const unsigned int first_page = start / page_size;
+	const unsigned int last_page = (start + len - 1) / page_size;
+	const unsigned int per_page = (page_size + chunk_size - 1) / chunk_size;
+
+	if (first_page == last_page)
+		return (len + chunk_size - 1) / chunk_size;
+
+	const unsigned int head = (first_page + 1) * page_size - start;
+	const unsigned int tail = start + len - last_page * page_size;
+	return (head + chunk_size - 1) / chunk_size + (last_page - first_page - 1) * per_page +
+	       (tail + chunk_size - 1) / chunk_size;
+}
+
+/**
+ * Like get_next_write(), but merges following areas which need to be written
+ * into the returned burst as long as that saves program commands. The gaps
+ * in between are written with their current contents. How many commands a
+ * burst takes is derived from the page size of the chip and the maximum
+ * write length of the programmer.
+ *
+ * @flash	flash context, for the chip and programmer limits
+ * @have	buffer with current content of the whole chip
+ * @want	buffer with desired content of the whole chip
+ * @end		chip offset after the last byte of the checked area
+ * @start	chip offset of the first byte of the checked area, updated
+ *		to the start of the burst if a write is needed
+ * @return	length of the burst, 0 if no write is needed
+ */
+unsigned int get_next_write_burst(const struct flashctx *flash, const uint8_t *have, const uint8_t *want,
+				  unsigned int end, unsigned int *start)
+{
+	const enum write_granularity gran = flash->chip->gran;
+	unsigned int len = get_next_write(have + *start, want + *start, end - *start, start, gran);
+	const unsigned int chunk_size = write_burst_chunk_size(flash);
+
+	if (!len || !chunk_size)
+		return len;
+
+	const unsigned int page_size = flash->chip->page_size;
+	unsigned int commands = write_command_count(*start, len, page_size, chunk_size);
+	unsigned int next = *start + len, next_len;
+	while ((next_len = get_next_write(have + next, want + next, end - next, &next, gran))) {
+		const unsigned int merged_len = next + next_len - *start;
+		const unsigned int merged_commands = write_command_count(*start, merged_len, page_size, chunk_size);
+
+		if (merged_commands >= commands + write_command_count(next, next_len, page_size, chunk_size))
+			break;
+		len = merged_len;
+		commands = merged_commands;
+		next += next_len;
+	}
+	return len;
+}
+
 void unmap_flash(struct flashctx *flash)
 {
 	if (flash->virtual_registers != (chipaddr)ERROR_PTR) {
@@ -1068,31 +1225,28 @@ int write_flash(struct flashctx *flash, const uint8_t *buf,
 
 	unsigned int write_len;
 	for (unsigned int addr = start; addr < start + len; addr += write_len) {
-		struct flash_region region;
-		get_flash_region(flash, addr, &region);
+		const struct flash_region *region = lookup_flash_region(flash, addr);
+		if (!region)
+			return -1;
 
-		write_len = min(start + len, region.end + 1) - addr;
+		write_len = min(start + len, region->end + 1) - addr;
 		const uint8_t *rbuf = buf + addr - start;
 
-		if (region.write_prot) {
+		if (region->write_prot) {
 			msg_gdbg("%s: cannot write inside %s region (%#08"PRIx32"..%#08"PRIx32"), skipping (%#08x..%#08x).\n",
-				 __func__, region.name, region.start, region.end, addr, addr + write_len - 1);
-			free(region.name);
+				 __func__, region->name, region->start, region->end, addr, addr + write_len - 1);
 			continue;
 		}
 
 		msg_gdbg("%s: %s region (%#08"PRIx32"..%#08"PRIx32") is writable, writing range (%#08x..%#08x).\n",
-			 __func__, region.name, region.start, region.end, addr, addr + write_len - 1);
+			 __func__, region->name, region->start, region->end, addr, addr + write_len - 1);
 
 		write_func_t *write_func = lookup_write_func_ptr(flash->chip);
 		int ret = write_func(flash, rbuf, addr, write_len);
 		if (ret) {
 			msg_gerr("%s: failed to write (%#08x..%#08x).\n", __func__, addr, addr + write_len - 1);
-			free(region.name);
 			return -1;
 		}
-
-		free(region.name);
 	}
 
 	return 0;
@@ -1267,6 +1421,9 @@ int probe_flash(struct registered_master *mst, int startchip, struct flashctx *f
 		/* Only probe for SPI25 chips by default. */
 		if (chip->bustype == BUS_SPI && !chip_to_probe && chip->spi_cmd_set != SPI25)
 			continue;
+		/* Skip chips whose ID was already read and does not match, before setting them up. */
+		if (!force && !spi_probe_may_match(mst, chip))
+			continue;
 		msg_gdbg("Probing for %s %s, %d kB: ", chip->vendor, chip->name, chip->total_size);
 		probe_func_t *probe_func = lookup_probe_func_ptr(chip);
 		if (!probe_func && !force) {
@@ -1282,6 +1439,7 @@ int probe_flash(struct registered_master *mst, int startchip, struct flashctx *f
 		}
 		*flash->chip = *chip;
 		flash->mst = mst;
+		flash->sfdp_applied = false;
 
 		if (map_flash(flash) != 0)
 			goto notfound;
@@ -1417,8 +1575,7 @@ static void setup_progress_from_layout_and_diff(struct flashctx *flashctx,
 		if (stage == FLASHROM_PROGRESS_WRITE) {
 			unsigned int start = region->start;
 			unsigned int len;
-			while ((len = get_next_write(have + start, want + start,
-						     region->end + 1 - start, &start, flashctx->chip->gran))) {
+			while ((len = get_next_write_burst(flashctx, have, want, region->end + 1, &start))) {
 				start += len;
 				total += len;
 			}
@@ -1465,13 +1622,116 @@ static int read_by_layout(struct flashctx *const flashctx, uint8_t *const buffer
 	return 0;
 }
 
+/*
+ * Returns true if [start, end] lies inside a single access region that can be
+ * written. erase_write() plans every access region on its own and can't erase
+ * a block that crosses a region boundary, only such blocks are guaranteed to be
+ * erased before the bytes read_block_sampled() invents would be programmed.
+ */
+static bool block_in_writable_region(struct flashctx *const flashctx, const chipoff_t start,
+				     const chipoff_t end)
+{
+	const struct flash_region *const region = lookup_flash_region(flashctx, start);
+
+	return region && region->end >= end && !region->read_prot && !region->write_prot;
+}
+
+/*
+ * Reads [start, start + len) of a block that lies completely inside an included region and
+ * a single writable access region, see block_in_writable_region(). The first page is read
+ * alone first. If it already proves that the block can't be programmed
+ * without an erase, the rest of the block is irrelevant for planning: it will be erased and
+ * programmed from newcontents anyway. It is then filled with the erased value instead of
+ * being read. Returns 0 on success, 1 if any read fails.
+ */
+static int read_block_sampled(struct flashctx *const flashctx, uint8_t *const curcontents,
+			      const uint8_t *const newcontents, const chipoff_t start, const chipsize_t len)
+{
+	const unsigned int page_size = flashctx->chip->page_size;
+	const chipsize_t sample_len = (page_size && page_size < len) ? page_size : len;
+
+	if (read_flash(flashctx, curcontents + start, start, sample_len))
+		return 1;
+	if (sample_len == len)
+		return 0;
+
+	if (need_erase(curcontents + start, newcontents + start, sample_len,
+		       flashctx->chip->gran, ERASED_VALUE(flashctx))) {
+		memset(curcontents + start + sample_len, ERASED_VALUE(flashctx), len - sample_len);
+		update_progress(flashctx, FLASHROM_PROGRESS_READ, len - sample_len);
+		return 0;
+	}
+
+	return read_flash(flashctx, curcontents + start + sample_len,
+			  start + sample_len, len - sample_len) ? 1 : 0;
+}
+
+/**
+ * @brief Reads the parts of the included layout regions needed to plan a write.
+ *
+ * Like read_by_layout(), but erase blocks of the smallest eraser that lie
+ * completely inside an included region and a single writable access region
+ * are sampled first, see read_block_sampled(). All other blocks are read in
+ * full. Only the bytes that can influence the erase/write
+ * decisions end up being read from the chip.
+ *
+ * @param flashctx    Flash context to be used.
+ * @param curcontents Buffer of full chip size to read into.
+ * @param newcontents The new image that is going to be written.
+ * @return 0 on success,
+ *	   1 if any read fails.
+ */
+static int read_by_layout_minimal(struct flashctx *const flashctx, uint8_t *const curcontents,
+				  const uint8_t *const newcontents)
+{
+	const struct flashrom_layout *const layout = get_layout(flashctx);
+	const struct romentry *entry = NULL;
+	struct erase_layout *erase_layout = NULL;
+	const int erasefn_count = create_erase_layout(flashctx, &erase_layout);
+	int ret = 1;
+
+	if (erasefn_count <= 0 || !erase_layout)
+		return read_by_layout(flashctx, curcontents);
+
+	setup_progress_from_layout(flashctx, FLASHROM_PROGRESS_READ);
+
+	const struct erase_layout *const smallest = &erase_layout[0];
+	while ((entry = layout_next_included(layout, entry))) {
+		const chipoff_t region_start = entry->region.start;
+		const chipoff_t region_end = entry->region.end;
+
+		for (size_t i = 0; i < smallest->block_count; i++) {
+			const struct eraseblock_data *const block = &smallest->layout_list[i];
+			if (block->start_addr > region_end)
+				break;
+			if (block->end_addr < region_start)
+				continue;
+
+			const chipoff_t start = max(block->start_addr, region_start);
+			const chipsize_t len = min(block->end_addr, region_end) - start + 1;
+			if (block->start_addr == start && block->end_addr == start + len - 1 &&
+			    block_in_writable_region(flashctx, start, block->end_addr)) {
+				if (read_block_sampled(flashctx, curcontents, newcontents, start, len))
+					goto _free_ret;
+			} else if (read_flash(flashctx, curcontents + start, start, len)) {
+				goto _free_ret;
+			}
+		}
+	}
+	ret = 0;
+
+_free_ret:
+	free_erase_layout(erase_layout, erasefn_count);
+	return ret;
+}
+
 static int erase_by_layout(struct flashctx *const flashctx)
 {
 	bool all_skipped = true;
 	const uint32_t flash_size = flashctx->chip->total_size * 1024;
 	uint8_t* curcontents = malloc(flash_size);
 	uint8_t* newcontents = malloc(flash_size);
-	struct erase_layout *erase_layout;
+	struct erase_layout *erase_layout = NULL;
 	create_erase_layout(flashctx, &erase_layout);
 	int ret = 0;
 
@@ -1495,6 +1755,7 @@ static int erase_by_layout(struct flashctx *const flashctx)
 
 	const struct flashrom_layout *const flash_layout = get_layout(flashctx);
 	const struct romentry *entry = NULL;
+	flashctx->contents_unknown = true;
 	while ((entry = layout_next_included(flash_layout, entry))) {
 		ret = erase_write(flashctx, entry->region.start, entry->region.end, curcontents, newcontents, erase_layout, &all_skipped);
 		if (ret) {
@@ -1505,29 +1766,22 @@ static int erase_by_layout(struct flashctx *const flashctx)
 	}
 
 _ret:
+	flashctx->contents_unknown = false;
 	free(curcontents);
 	free(newcontents);
 	free_erase_layout(erase_layout, count_usable_erasers(flashctx));
 	return ret;
 }
 
-static int write_by_layout(struct flashctx *const flashctx,
+static int write_by_layout(struct flashctx *const flashctx, struct erase_layout *const erase_layout,
 			   void *const curcontents, const void *const newcontents,
 			   bool *all_skipped)
 {
-	const int erasefn_count = count_usable_erasers(flashctx);
 	int ret = 1;
 
 	const struct flashrom_layout *const flash_layout = get_layout(flashctx);
-	struct erase_layout *erase_layout;
-	create_erase_layout(flashctx, &erase_layout);
-
-	if (!flash_layout) {
-		goto _ret;
-	}
-	if (!erase_layout) {
-		goto _ret;
-	}
+	if (!flash_layout || !erase_layout)
+		return ret;
 
 	setup_progress_from_layout(flashctx, FLASHROM_PROGRESS_READ);
 	setup_progress_from_layout_and_diff(flashctx, curcontents, newcontents, FLASHROM_PROGRESS_WRITE);
@@ -1542,24 +1796,87 @@ static int write_by_layout(struct flashctx *const flashctx,
 						erase_layout, all_skipped);
 		if (ret) {
 			msg_cerr("Write Failed!");
-			goto _ret;
+			return ret;
 		}
 	}
-_ret:
-	free_erase_layout(erase_layout, erasefn_count);
 	return ret;
 }
 
+/* Number of untouched blocks that are read back when only changed blocks are verified. */
+#define VERIFY_CHANGED_SPOT_CHECKS 8
+
+static bool block_in_layout(const struct flashrom_layout *const layout, const struct eraseblock_data *const block)
+{
+	const struct romentry *entry = NULL;
+
+	while ((entry = layout_next_included(layout, entry))) {
+		if (block->start_addr >= entry->region.start && block->end_addr <= entry->region.end)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Reads back a few blocks spread over the included regions that were neither
+ * erased nor programmed by the preceding write. This catches writes that
+ * ended up at the wrong address, which verifying only the changed blocks
+ * would miss.
+ */
+static int spot_check_unmodified(struct flashctx *const flashctx,
+				 const struct flashrom_layout *const layout,
+				 const struct erase_layout *const erase_layout,
+				 uint8_t *const curcontents, const uint8_t *const newcontents)
+{
+	const struct eraseblock_data *const list = erase_layout[0].layout_list;
+	size_t candidates = 0;
+
+	for (size_t i = 0; i < erase_layout[0].block_count; i++) {
+		if (!list[i].modified && block_in_layout(layout, &list[i]))
+			candidates++;
+	}
+	if (!candidates)
+		return 0;
+
+	/* Evenly spread and reproducible, the same write always checks the same blocks. */
+	const size_t step = candidates > VERIFY_CHANGED_SPOT_CHECKS ? candidates / VERIFY_CHANGED_SPOT_CHECKS : 1;
+	const size_t phase = step / 2;
+	size_t n = 0, checked = 0;
+
+	for (size_t i = 0; i < erase_layout[0].block_count && checked < VERIFY_CHANGED_SPOT_CHECKS; i++) {
+		if (list[i].modified || !block_in_layout(layout, &list[i]))
+			continue;
+		if (n++ % step != phase)
+			continue;
+
+		const chipoff_t start = list[i].start_addr;
+		const chipsize_t len = list[i].end_addr - start + 1;
+		if (read_flash(flashctx, curcontents + start, start, len))
+			return 1;
+		if (compare_range(newcontents + start, curcontents + start, start, len))
+			return 3;
+		checked++;
+	}
+	msg_gdbg("%s: checked %zu of %zu untouched blocks.\n", __func__, checked, candidates);
+	return 0;
+}
+
 /**
  * @brief Compares the included layout regions with content from a buffer.
  *
  * If there is no layout set in the given flash context, the whole chip's
  * contents will be compared.
  *
- * @param flashctx    Flash context to be used.
- * @param layout      Flash layout information.
- * @param curcontents A buffer of full chip size to read current chip contents into.
- * @param newcontents The new image to compare to.
+ * If an erase layout of a preceding write is given, blocks that were already
+ * read back and confirmed during the write are not read again. With
+ * `changed_only`, only the blocks the write erased or programmed are compared,
+ * plus a few spot checks of the untouched ones.
+ *
+ * @param flashctx     Flash context to be used.
+ * @param layout       Flash layout information.
+ * @param erase_layout Erase layout used for the preceding write, or NULL.
+ * @param changed_only Only verify blocks changed by the write, requires `erase_layout`.
+ * @param curcontents  A buffer of full chip size to read current chip contents into.
+ * @param newcontents  The new image to compare to.
  * @return 0 on success,
  *	   1 if reading failed,
  *	   3 if the contents don't match.
@@ -1567,6 +1884,7 @@ _ret:
 static int verify_by_layout(
 		struct flashctx *const flashctx,
 		const struct flashrom_layout *const layout,
+		const struct erase_layout *const erase_layout, const bool changed_only,
 		void *const curcontents, const uint8_t *const newcontents)
 {
 	const struct romentry *entry = NULL;
@@ -1575,15 +1893,27 @@ static int verify_by_layout(
 
 	while ((entry = layout_next_included(layout, entry))) {
 		const struct flash_region *region = &entry->region;
-		const chipoff_t region_start	= region->start;
-		const chipsize_t region_len	= region->end - region->start + 1;
+		chipoff_t start = region->start;
+		chipsize_t len = region->end - region->start + 1;
 
-		if (read_flash(flashctx, curcontents + region_start, region_start, region_len))
-			return 1;
-		if (compare_range(newcontents + region_start, curcontents + region_start,
-				  region_start, region_len))
-			return 3;
+		if (!erase_layout) {
+			if (read_flash(flashctx, curcontents + start, start, len))
+				return 1;
+			if (compare_range(newcontents + start, curcontents + start, start, len))
+				return 3;
+			continue;
+		}
+
+		for (; next_unverified_range(erase_layout, &start, region->end, &len, changed_only); start += len) {
+			if (read_flash(flashctx, curcontents + start, start, len))
+				return 1;
+			if (compare_range(newcontents + start, curcontents + start, start, len))
+				return 3;
+		}
 	}
+
+	if (erase_layout && changed_only)
+		return spot_check_unmodified(flashctx, layout, erase_layout, curcontents, newcontents);
 	return 0;
 }
 
@@ -1664,7 +1994,7 @@ void list_programmers_linebreak(int startcol, int cols, int paren)
 	}
 }
 
-int selfcheck(void)
+static int selfcheck_tables(void)
 {
 	unsigned int i;
 	int ret = 0;
@@ -1735,6 +2065,22 @@ int selfcheck(void)
 	return ret;
 }
 
+int selfcheck(void)
+{
+	/*
+	 * All checked tables are constant, so the result cannot change during the
+	 * lifetime of the process. Only pay for the checks on the first call, which
+	 * matters for library users that call flashrom_init() for every session.
+	 */
+	static int result = -1;
+
+	if (result < 0)
+		result = selfcheck_tables() ? 1 : 0;
+	else if (result)
+		msg_gerr("Self-check failed earlier, see the messages above.\n");
+	return result;
+}
+
 /* FIXME: This function signature needs to be improved once prepare_flash_access()
  * has a better function signature.
  */
@@ -1977,6 +2323,9 @@ int prepare_flash_access(struct flashctx *const flash,
 	if (map_flash(flash) != 0)
 		return 1;
 
+	if (build_flash_region_table(flash))
+		return 1;
+
 	/* Initialize chip_restore_fn_count before chip unlock calls. */
 	flash->chip_restore_fn_count = 0;
 
@@ -2004,6 +2353,14 @@ int prepare_flash_access(struct flashctx *const flash,
 		}
 	}
 
+	/* Complete the database entry with what the chip reports about itself, once per probe. */
+	if (flash->flags.use_sfdp && !flash->sfdp_applied && flash->mst->buses_supported & BUS_SPI &&
+	    flash->chip->bustype == BUS_SPI && flash->chip->spi_cmd_set == SPI25 &&
+	    flash->chip->probe != PROBE_SPI_SFDP) {
+		flash->sfdp_applied = true;
+		spi_sfdp_apply(flash);
+	}
+
 	flash->address_high_byte = -1;
 	flash->in_4ba_mode = false;
 
@@ -2029,6 +2386,8 @@ int prepare_flash_access(struct flashctx *const flash,
 		}
 	}
 
+	spi_select_read_mode(flash);
+
 	return 0;
 }
 
@@ -2036,6 +2395,18 @@ void finalize_flash_access(struct flashctx *const flash)
 {
 	deregister_chip_restore(flash);
 	unmap_flash(flash);
+	release_flash_region_table(flash);
+}
+
+/*
+ * A flashrom_flash_cancel() request is consumed by the erase or write that it
+ * stopped or that was running when it arrived. Reads and verifications leave
+ * it pending for the next erase or write.
+ */
+static void clear_cancel_request(struct flashctx *const flash)
+{
+	flash->cancel_requested = 0;
+	flash->cancelled = false;
 }
 
 int flashrom_flash_erase(struct flashctx *const flashctx)
@@ -2045,12 +2416,20 @@ int flashrom_flash_erase(struct flashctx *const flashctx)
 			 "Earlier messages should give more details.\n"
 			 "Erase operation has not started.\n");
 		finalize_flash_access(flashctx);
+		clear_cancel_request(flashctx);
 		return ERROR_FLASHROM_PREPARE_FLASH_ACCESS;
 	}
 
 	const int ret = erase_by_layout(flashctx);
+	const bool cancelled = ret && flashctx->cancelled;
 
 	finalize_flash_access(flashctx);
+	clear_cancel_request(flashctx);
+
+	if (cancelled) {
+		msg_cinfo("\nErase cancelled, the flash chip may be partially erased.\n");
+		return ERROR_FLASHROM_CANCELLED;
+	}
 
 	/*
 	 * FIXME: Do we really want the scary warning if erase failed?
@@ -2127,12 +2506,19 @@ int flashrom_image_write(struct flashctx *const flashctx, void *const buffer, co
 	if (buffer_len != flash_size)
 		return 4;
 
+	if (flashctx->flags.verify_changed && verify_all) {
+		msg_gerr("Error: verifying only the changed blocks and verifying the whole chip "
+			 "are mutually exclusive.\n");
+		return 1;
+	}
+
 	int ret = 1;
 
 	uint8_t *const newcontents = buffer;
 	const uint8_t *const refcontents = refbuffer;
 	uint8_t *const curcontents = malloc(flash_size);
 	uint8_t *oldcontents = NULL;
+	struct erase_layout *erase_layout = NULL;
 	if (verify_all)
 		oldcontents = malloc(flash_size);
 	if (!curcontents || (verify_all && !oldcontents)) {
@@ -2173,6 +2559,8 @@ int flashrom_image_write(struct flashctx *const flashctx, void *const buffer, co
 		 * The alternative is to read only the regions which are to be
 		 * preserved, but in that case we might perform unneeded erase which
 		 * takes time as well.
+		 * With minimal_preread, blocks whose first page already proves
+		 * that they need an erase are not read any further.
 		 */
 		msg_cinfo("Reading old flash chip contents... ");
 		if (verify_all) {
@@ -2182,6 +2570,11 @@ int flashrom_image_write(struct flashctx *const flashctx, void *const buffer, co
 				goto _finalize_ret;
 			}
 			memcpy(curcontents, oldcontents, flash_size);
+		} else if (flashctx->flags.minimal_preread) {
+			if (read_by_layout_minimal(flashctx, curcontents, newcontents)) {
+				msg_cinfo("FAILED.\n");
+				goto _finalize_ret;
+			}
 		} else {
 			if (read_by_layout(flashctx, curcontents)) {
 				msg_cinfo("FAILED.\n");
@@ -2193,8 +2586,18 @@ int flashrom_image_write(struct flashctx *const flashctx, void *const buffer, co
 
 	bool all_skipped = true;
 
+	/* Kept until after the verification, which skips blocks confirmed during the write. */
+	create_erase_layout(flashctx, &erase_layout);
+	if (erase_layout && verify)
+		mark_verify_coverage(erase_layout, verify_layout);
+
 	msg_cinfo("Updating flash chip contents... ");
-	if (write_by_layout(flashctx, curcontents, newcontents, &all_skipped)) {
+	if (write_by_layout(flashctx, erase_layout, curcontents, newcontents, &all_skipped)) {
+		if (flashctx->cancelled) {
+			msg_cinfo("\nWrite cancelled, the flash chip may be partially written.\n");
+			ret = ERROR_FLASHROM_CANCELLED;
+			goto _finalize_ret;
+		}
 		msg_cerr("Uh oh. Erase/write failed. ");
 		ret = 2;
 		if (verify_all) {
@@ -2251,7 +2654,8 @@ int flashrom_image_write(struct flashctx *const flashctx, void *const buffer, co
 
 		if (verify_all)
 			combine_image_by_layout(flashctx, newcontents, oldcontents);
-		ret = verify_by_layout(flashctx, verify_layout, curcontents, newcontents);
+		ret = verify_by_layout(flashctx, verify_layout, erase_layout, flashctx->flags.verify_changed,
+				       curcontents, newcontents);
 		/* If we tried to write, and verification now fails, we
 		   might have an emergency situation. */
 		if (ret)
@@ -2265,7 +2669,9 @@ int flashrom_image_write(struct flashctx *const flashctx, void *const buffer, co
 
 _finalize_ret:
 	finalize_flash_access(flashctx);
+	clear_cancel_request(flashctx);
 _free_ret:
+	free_erase_layout(erase_layout, count_usable_erasers(flashctx));
 	free(oldcontents);
 	free(curcontents);
 	return ret;
@@ -2294,7 +2700,7 @@ int flashrom_image_verify(struct flashctx *const flashctx, const void *const buf
 	}
 
 	msg_cinfo("Verifying flash... ");
-	ret = verify_by_layout(flashctx, layout, curcontents, newcontents);
+	ret = verify_by_layout(flashctx, layout, NULL, false, curcontents, newcontents);
 	if (!ret)
 		msg_cinfo("VERIFIED.\n");
 
@@ -2303,3 +2709,181 @@ _free_ret:
 	free(curcontents);
 	return ret;
 }
+
+/* Checks that [start, start + len) is a non-empty range inside the flash chip. */
+static bool region_fits_chip(const struct flashctx *const flashctx, const size_t start, const size_t len)
+{
+	const size_t flash_size = flashctx->chip->total_size * 1024;
+
+	return len && start < flash_size && len <= flash_size - start;
+}
+
+/*
+ * Compares [start, start + len) of the chip with `buffer`, reading at most
+ * REGION_WINDOW_SIZE bytes at a time.
+ *
+ * Returns 0 if the contents match,
+ *	   1 if reading failed,
+ *	   3 if the contents don't match.
+ */
+static int verify_region_windowed(struct flashctx *const flashctx, const uint8_t *const buffer,
+				  const chipoff_t start, const chipsize_t len)
+{
+	uint8_t *const readbuf = malloc(min(len, REGION_WINDOW_SIZE));
+	if (!readbuf) {
+		msg_gerr("Out of memory!\n");
+		return 1;
+	}
+
+	int ret = 0;
+	init_progress(flashctx, FLASHROM_PROGRESS_READ, len);
+
+	chipsize_t chunk;
+	for (chipoff_t offset = 0; offset < len; offset += chunk) {
+		chunk = min(len - offset, REGION_WINDOW_SIZE);
+		if (read_flash(flashctx, readbuf, start + offset, chunk)) {
+			ret = 1;
+			break;
+		}
+		/* Like verify_range(), skip what a write with skip_unwritable_regions leaves alone. */
+		chipsize_t part;
+		for (chipoff_t addr = start + offset; addr < start + offset + chunk && !ret; addr += part) {
+			const struct flash_region *region = lookup_flash_region(flashctx, addr);
+			if (!region) {
+				ret = 1;
+				break;
+			}
+			part = min(start + offset + chunk - 1, region->end) - addr + 1;
+			if (region->write_prot && flashctx->flags.skip_unwritable_regions)
+				continue;
+			if (compare_range(buffer + addr - start, readbuf + addr - start - offset, addr, part))
+				ret = 3;
+		}
+		if (ret)
+			break;
+	}
+
+	free(readbuf);
+	return ret;
+}
+
+int flashrom_region_read(struct flashctx *const flashctx, const size_t start, const size_t len, void *const buffer)
+{
+	if (!region_fits_chip(flashctx, start, len))
+		return 2;
+
+	if (prepare_flash_access(flashctx, true, false, false, false))
+		return ERROR_FLASHROM_PREPARE_FLASH_ACCESS;
+
+	msg_cinfo("Reading flash range %#08zx..%#08zx... ", start, start + len - 1);
+
+	int ret = 1;
+	init_progress(flashctx, FLASHROM_PROGRESS_READ, len);
+	if (read_flash(flashctx, buffer, start, len)) {
+		msg_cerr("Read operation failed!\n");
+		msg_cinfo("FAILED.\n");
+		goto _finalize_ret;
+	}
+	msg_cinfo("done.\n");
+	ret = 0;
+
+_finalize_ret:
+	finalize_flash_access(flashctx);
+	return ret;
+}
+
+int flashrom_region_write(struct flashctx *const flashctx, const size_t start, const size_t len,
+			  const void *const buffer)
+{
+	const bool verify = flashctx->flags.verify_after_write;
+
+	if (!region_fits_chip(flashctx, start, len))
+		return 4;
+
+	/*
+	 * Region writes ignore the layout, so check the write permissions for the
+	 * range itself. write_region_windowed() checks each block it touches.
+	 */
+	struct flashrom_layout *range_layout;
+	if (flashrom_layout_new(&range_layout))
+		return 1;
+	if (flashrom_layout_add_region(range_layout, start, start + len - 1, "range") ||
+	    flashrom_layout_include_region(range_layout, "range")) {
+		flashrom_layout_release(range_layout);
+		return 1;
+	}
+	const struct flashrom_layout *const saved_layout = flashctx->layout;
+	flashctx->layout = range_layout;
+	const int prepare_ret = prepare_flash_access(flashctx, false, true, false, verify);
+	flashctx->layout = saved_layout;
+	flashrom_layout_release(range_layout);
+
+	if (prepare_ret) {
+		msg_gerr("Error: some of the required checks to prepare flash access failed. "
+			 "Earlier messages should give more details.\n"
+			 "Write operation has not started.\n");
+		clear_cancel_request(flashctx);
+		return ERROR_FLASHROM_PREPARE_FLASH_ACCESS;
+	}
+
+	int ret = 1;
+	struct erase_layout *erase_layout = NULL;
+	const int erasefn_count = create_erase_layout(flashctx, &erase_layout);
+	if (erasefn_count <= 0 || !erase_layout)
+		goto _finalize_ret;
+
+	bool all_skipped = true;
+
+	msg_cinfo("Updating flash range %#08zx..%#08zx... ", start, start + len - 1);
+	if (write_region_windowed(flashctx, erase_layout, start, len, buffer, &all_skipped)) {
+		if (flashctx->cancelled) {
+			msg_cinfo("\nWrite cancelled, the flash chip may be partially written.\n");
+			ret = ERROR_FLASHROM_CANCELLED;
+			goto _finalize_ret;
+		}
+		msg_cerr("Uh oh. Erase/write failed.\n");
+		ret = 2;
+		emergency_help_message();
+		goto _finalize_ret;
+	}
+	msg_cinfo("done.\n");
+
+	/* Verify only if we actually changed something. */
+	ret = 0;
+	if (verify && !all_skipped) {
+		msg_cinfo("Verifying flash range... ");
+		/* See flashrom_image_write() for this delay. */
+		if (flashctx->chip->bustype & (BUS_PARALLEL | BUS_LPC | BUS_FWH))
+			programmer_delay(flashctx, 1000*1000);
+
+		ret = verify_region_windowed(flashctx, buffer, start, len);
+		if (ret)
+			emergency_help_message();
+		else
+			msg_cinfo("VERIFIED.\n");
+	}
+
+_finalize_ret:
+	finalize_flash_access(flashctx);
+	clear_cancel_request(flashctx);
+	free_erase_layout(erase_layout, erasefn_count > 0 ? erasefn_count : 0);
+	return ret;
+}
+
+int flashrom_region_verify(struct flashctx *const flashctx, const size_t start, const size_t len,
+			   const void *const buffer)
+{
+	if (!region_fits_chip(flashctx, start, len))
+		return 2;
+
+	if (prepare_flash_access(flashctx, false, false, false, true))
+		return ERROR_FLASHROM_PREPARE_FLASH_ACCESS;
+
+	msg_cinfo("Verifying flash range %#08zx..%#08zx... ", start, start + len - 1);
+	const int ret = verify_region_windowed(flashctx, buffer, start, len);
+	if (!ret)
+		msg_cinfo("VERIFIED.\n");
+
+	finalize_flash_access(flashctx);
+	return ret;
+}
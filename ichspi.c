@@ -1448,7 +1448,7 @@ static void ich_get_region(const struct flashctx *flash, unsigned int addr, stru
 			 * fd_regions[i] starts after addr, constrain
 			 * region->end so that it does not overlap.
 			 */
-			region->end = min(region->end, base);
+			region->end = min(region->end, base - 1);
 		} else if (addr > limit) {
 			/*
 			 * fd_regions[i] ends before addr, constrain
@@ -21,9 +21,11 @@ int probe_spi_rems(struct flashctx *flash);
 int probe_spi_res1(struct flashctx *flash);
 int probe_spi_res2(struct flashctx *flash);
 int probe_spi_res3(struct flashctx *flash);
+bool spi_probe_may_match(const struct registered_master *mst, const struct flashchip *chip);
 int probe_spi_at25f(struct flashctx *flash);
 int spi_write_enable(struct flashctx *flash);
 int spi_write_disable(struct flashctx *flash);
+int spi_read_unique_id(struct flashctx *flash, uint8_t *id, unsigned int len);
 int spi_block_erase_20(struct flashctx *flash, unsigned int addr, unsigned int blocklen);
 int spi_block_erase_21(struct flashctx *flash, unsigned int addr, unsigned int blocklen);
 int spi_block_erase_50(struct flashctx *flash, unsigned int addr, unsigned int blocklen);
@@ -40,10 +42,13 @@ int spi_block_erase_d8(struct flashctx *flash, unsigned int addr, unsigned int b
 int spi_block_erase_db(struct flashctx *flash, unsigned int addr, unsigned int blocklen);
 int spi_block_erase_dc(struct flashctx *flash, unsigned int addr, unsigned int blocklen);
 enum block_erase_func spi25_get_erasefn_from_opcode(uint8_t opcode);
+unsigned int spi_wip_busy_time(const struct flashctx *flash, uint8_t opcode);
+unsigned int spi_erase_busy_time(const struct flashctx *flash, enum block_erase_func func);
 const uint8_t *spi_get_opcode_from_erasefn(enum block_erase_func func);
 int spi_chip_write_1(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len);
 int spi_nbyte_read(struct flashctx *flash, unsigned int addr, uint8_t *bytes, unsigned int len);
 int spi_read_chunked(struct flashctx *flash, uint8_t *buf, unsigned int start, unsigned int len, unsigned int chunksize);
+void spi_select_read_mode(struct flashctx *flash);
 int spi_write_chunked(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len, unsigned int chunksize);
 int spi_enter_4ba(struct flashctx *flash);
 int spi_exit_4ba(struct flashctx *flash);
@@ -57,6 +62,7 @@ void spi_prettyprint_status_register_bit(uint8_t status, int bit);
 
 /* sfdp.c */
 int probe_spi_sfdp(struct flashctx *flash);
+int spi_sfdp_apply(struct flashctx *flash);
 
 /* opaque.c */
 int probe_opaque(struct flashctx *flash);
@@ -0,0 +1,36 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileCopyrightText: 2026 The flashrom authors
+ */
+
+#ifndef __CONTENTS_DIFF_H__
+#define __CONTENTS_DIFF_H__ 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Helpers to compare current (`have`) and desired (`want`) flash contents.
+ * They are used on every byte of an image during erase/write planning, so
+ * they work on machine words or SIMD vectors where the target allows it.
+ */
+
+/* Returns the offset of the first byte where `a` and `b` differ, or `len` if they are identical. */
+size_t contents_first_diff(const uint8_t *a, const uint8_t *b, size_t len);
+
+/* Returns the offset of the first byte where `a` and `b` are equal, or `len` if there is none. */
+size_t contents_first_equal(const uint8_t *a, const uint8_t *b, size_t len);
+
+/* Returns true if `want` can be reached from `have` by only clearing bits (1->0 transitions). */
+bool contents_only_clears_bits(const uint8_t *have, const uint8_t *want, size_t len);
+
+/* Returns true if every byte of `have` either equals `want` or is in the erased state. */
+bool contents_bytes_writable(const uint8_t *have, const uint8_t *want, size_t len, uint8_t erased_value);
+
+/* Returns true if all bytes of `buf` equal `erased_value`. */
+bool contents_is_erased(const uint8_t *buf, size_t len, uint8_t erased_value);
+
+#endif /* !__CONTENTS_DIFF_H__ */
@@ -15,6 +15,13 @@ struct eraseblock_data {
 	chipoff_t start_addr;
 	chipoff_t end_addr;
 	bool selected;
+	/* Dirty index, only maintained for the blocks of the smallest eraser. */
+	bool needs_erase;	/* Block can't be brought to the new contents by programming alone. */
+	bool needs_program;	/* Current contents of the block differ from the new contents. */
+	bool verified;		/* Block was read back after its last erase and matches the new contents. */
+	bool covered_by_verify;	/* Block is read back by a verification after the write anyway. */
+	bool modified;		/* Block was erased or programmed during the write. */
+	chipsize_t reprogram_len; /* Bytes to program again if the block is erased without need. */
 	size_t block_num;
 	size_t first_sub_block_index;
 	size_t last_sub_block_index;
@@ -31,5 +38,14 @@ int create_erase_layout(struct flashctx *const flashctx, struct erase_layout **e
 int erase_write(struct flashctx *const flashctx, chipoff_t region_start, chipoff_t region_end,
 		uint8_t* curcontents, uint8_t* newcontents,
 		struct erase_layout *erase_layout, bool *all_skipped);
+void mark_verify_coverage(const struct erase_layout *erase_layout, const struct flashrom_layout *layout);
+bool next_unverified_range(const struct erase_layout *erase_layout, chipoff_t *start, chipoff_t end,
+			   chipsize_t *len, bool modified_only);
+
+/* Upper bound for the chip contents held in memory at once by the region operations. */
+#define REGION_WINDOW_SIZE (64 * KiB)
+
+int write_region_windowed(struct flashctx *const flashctx, struct erase_layout *const erase_layout,
+			  chipoff_t start, chipsize_t len, const uint8_t *buf, bool *all_skipped);
 
 #endif		/* !__ERASURE_LAYOUT_H__ */
@@ -17,6 +17,7 @@
 #include <stddef.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <signal.h>
 #if IS_WINDOWS
 #include <windows.h>
 #undef min
@@ -98,6 +99,7 @@ enum write_granularity {
  * Macronix MX25L25635F has 8 different functions.
  */
 #define NUM_ERASEFUNCTIONS 8
+#define NUM_WIP_TIMINGS 8
 
 #define MAX_CHIP_RESTORE_FUNCTIONS 4
 
@@ -181,6 +183,18 @@ enum write_granularity {
  * ST M95320 (chips up to 64 KiB in the M95XXX family).
  */
 #define FEATURE_ADDR_2BYTE	(1 << 28)
+/* Dual output (0x3b) and dual I/O (0xbb) fast reads with the usual 8 dummy clocks and 4 mode clocks. */
+#define FEATURE_DUAL_READ	(1 << 29)
+/*
+ * Quad output (0x6b) and quad I/O (0xeb) fast reads with the usual 8 dummy clocks, and 2 mode plus 4 dummy
+ * clocks respectively. They are only used while the QE bit given in reg_bits is set.
+ */
+#define FEATURE_QUAD_READ	(1 << 30)
+/*
+ * Factory programmed unique ID readable with RDUID (0x4b), after 4 dummy bytes (5 in 4BA mode).
+ * Other vendors use 0x4b for OTP or parameter reads, it must only be sent to chips with this bit.
+ */
+#define FEATURE_UNIQUE_ID	(1U << 31)
 
 #define ERASED_VALUE(flash)	(((flash)->chip->feature_bits & FEATURE_ERASED_ZERO) ? 0x00 : 0xff)
 #define UNERASED_VALUE(flash)	(((flash)->chip->feature_bits & FEATURE_ERASED_ZERO) ? 0xff : 0x00)
@@ -221,6 +235,29 @@ enum flash_reg {
 	MAX_REGISTERS
 };
 
+/* SPI read modes, named after the number of lines used for opcode, address and data. */
+enum spi_read_mode {
+	SPI_READ_1_1_1,		/* Plain read (0x03/0x13), always available */
+	SPI_READ_1_1_1_FAST,	/* Fast read (0x0b/0x0c) with wait states, for high clocks */
+	SPI_READ_1_1_2,
+	SPI_READ_1_2_2,
+	SPI_READ_1_1_4,
+	SPI_READ_1_4_4,
+	SPI_NUM_READ_MODES,
+};
+
+struct spi_fast_read {
+	uint8_t opcode;		/* 0 if the mode is not supported */
+	uint8_t mode_clocks;	/* Clocks of mode bits after the address */
+	uint8_t dummy_clocks;	/* Wait states after the mode bits */
+};
+
+/* Typical and maximum busy time of a program or erase operation, 0 if unknown. */
+struct op_timing {
+	unsigned int typ_us;
+	unsigned int max_us;
+};
+
 struct reg_bit_info {
 	/* Register containing the bit */
 	enum flash_reg reg;
@@ -475,7 +512,7 @@ struct flashchip {
 	unsigned int total_size;
 	/* Chip page size in bytes */
 	unsigned int page_size;
-	int feature_bits;
+	uint32_t feature_bits;
 
 	/* Indicate how well flashrom supports different operations of this flash chip. */
 	struct tested {
@@ -518,6 +555,8 @@ struct flashchip {
 		/* a block_erase function should try to erase one block of size
 		 * 'blocklen' at address 'blockaddr' and return 0 on success. */
 		enum block_erase_func block_erase;
+		/* Busy time of erasing one block, e.g. taken from SFDP. */
+		struct op_timing timing;
 	} block_erasers[NUM_ERASEFUNCTIONS];
 
 	enum printlock_func printlock;
@@ -572,8 +611,23 @@ struct flashchip {
 
 		/* Write Protect Selection (per sector protection when set) */
 		struct reg_bit_info wps;
+
+		/* Quad enable bit (QE), IO2/IO3 work as data lines when set */
+		struct reg_bit_info qe;
 	} reg_bits;
 
+	/*
+	 * Fast reads the chip supports, e.g. taken from SFDP. Modes without an
+	 * opcode fall back to the defaults implied by FEATURE_DUAL_READ and
+	 * FEATURE_QUAD_READ. Chips with either feature or FEATURE_4BA_FAST_READ
+	 * also support the single I/O fast read (0x0b).
+	 */
+	struct spi_fast_read fast_read[SPI_NUM_READ_MODES];
+
+	/* Busy times of programming a page and a single byte, e.g. taken from SFDP. */
+	struct op_timing page_program;
+	struct op_timing byte_program;
+
 	/*
 	 * Function that takes a set of WP config bits (e.g. BP, SEC, TB, etc)
 	 * and determines what protection range they select.
@@ -637,6 +691,10 @@ struct flashrom_flashctx {
 		bool verify_whole_chip;
 		bool skip_unreadable_regions;
 		bool skip_unwritable_regions;
+		bool minimal_preread;
+		bool verify_changed;
+		bool time_optimal_erase;
+		bool use_sfdp;
 	} flags;
 	/* We cache the state of the extended address register (highest byte
 	 * of a 4BA for 3BA instructions) and the state of the 4BA mode here.
@@ -645,6 +703,19 @@ struct flashrom_flashctx {
 	 */
 	int address_high_byte;
 	bool in_4ba_mode;
+	/* Fastest read mode both chip and master support, see spi_select_read_mode(). */
+	enum spi_read_mode read_mode;
+	/* SFDP parameters were merged into the chip from the database, see spi_sfdp_apply(). */
+	bool sfdp_applied;
+	/* Busy times observed for write and erase opcodes, used to pace WIP polling (see spi25.c). */
+	struct wip_timing {
+		uint8_t opcode;
+		unsigned int samples;
+		unsigned int busy_us;
+	} wip_timings[NUM_WIP_TIMINGS];
+	/* Access regions of the programmer, see build_flash_region_table(). */
+	struct flash_region *region_table;
+	size_t region_table_len;
 
 	int chip_restore_fn_count;
 	struct chip_restore_func_data {
@@ -661,6 +732,16 @@ struct flashrom_flashctx {
 
 	/* Maximum allowed % of redundant erase */
 	int sacrifice_ratio;
+
+	/*
+	 * Set by flashrom_flash_cancel(), checked between erase blocks and writes.
+	 * Only safe to set from a signal handler, see flashrom_flash_cancel().
+	 */
+	volatile sig_atomic_t cancel_requested;
+	/* Set where an operation stopped for cancel_requested, not because of an error. */
+	bool cancelled;
+	/* Set while erasing without knowing the current contents, see erase_by_layout(). */
+	bool contents_unknown;
 };
 
 /* Timing used in probe routines. ZERO is -2 to differentiate between an unset
@@ -705,6 +786,7 @@ int need_erase(const uint8_t *have, const uint8_t *want, unsigned int len, enum
 erasefunc_t *lookup_erase_func_ptr(const struct block_eraser *const eraser);
 int check_erased_range(struct flashctx *flash, unsigned int start, unsigned int len);
 unsigned int get_next_write(const uint8_t *have, const uint8_t *want, unsigned int len, unsigned int *first_start, enum write_granularity gran);
+unsigned int get_next_write_burst(const struct flashctx *flash, const uint8_t *have, const uint8_t *want, unsigned int end, unsigned int *start);
 int write_flash(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len);
 dieselect_func_t *lookup_dieselect_func_ptr(const struct flashchip *chip);
 
@@ -735,6 +817,12 @@ struct cli_progress {
 /* cli_common.c */
 void print_chip_support_status(const struct flashchip *chip);
 
+/* cli_shadow_cache.c */
+char *shadow_cache_path(struct flashctx *flash, const char *dir, const char *programmer_name);
+int shadow_cache_load(struct flashctx *flash, const char *path, uint8_t *buf, size_t size);
+int shadow_cache_store(const char *path, const uint8_t *buf, size_t size);
+void shadow_cache_drop(const char *path);
+
 /* libflashrom.c */
 void init_progress(struct flashctx *flash, enum flashrom_progress_stage stage, size_t total);
 void update_progress(struct flashctx *flash, enum flashrom_progress_stage stage, size_t increment);
@@ -72,8 +72,11 @@ const struct romentry *layout_next(const struct flashrom_layout *, const struct
 int included_regions_overlap(const struct flashrom_layout *);
 void prepare_layout_for_extraction(struct flashrom_flashctx *);
 int layout_sanity_checks(const struct flashrom_flashctx *);
-int check_for_unwritable_regions(const struct flashrom_flashctx *flash, unsigned int start, unsigned int len);
+int check_for_unwritable_regions(struct flashrom_flashctx *flash, unsigned int start, unsigned int len);
 void get_flash_region(const struct flashrom_flashctx *flash, int addr, struct flash_region *region);
+int build_flash_region_table(struct flashrom_flashctx *flash);
+void release_flash_region_table(struct flashrom_flashctx *flash);
+const struct flash_region *lookup_flash_region(struct flashrom_flashctx *flash, unsigned int addr);
 /*
  * Return chipset-level protections.
  * ranges parameter has to be freed by the caller with release_protected_ranges
@@ -31,7 +31,9 @@
 /**
  * @brief Initialize libflashrom.
  *
- * @param perform_selfcheck If not zero, perform a self check.
+ * @param perform_selfcheck If not zero, perform a self check. The check
+ *                          only runs once per process, later calls return
+ *                          its result.
  * @return 0 on success
  */
 int flashrom_init(int perform_selfcheck);
@@ -238,7 +240,9 @@ struct flashrom_programmer;
 /**
  * @brief Initialize the specified programmer.
  *
- * Currently, only one programmer may be initialized at a time.
+ * Only one programmer may be initialized per process at a time. Further calls
+ * fail until the active programmer is shut down with @ref
+ * flashrom_programmer_shutdown, even if its initialization failed.
  *
  * @param[out] flashprog Points to a pointer of type struct flashrom_programmer
  *                       that will be set if programmer initialization succeeds.
@@ -341,8 +345,34 @@ size_t flashrom_flash_getsize(const struct flashrom_flashctx *flashctx);
  * @param flashctx The context of the flash chip to erase.
  * @return 0 on success.
  *         -3 if prepare_flash_access check failed and operation has not started
+ *         5 if the erase was cancelled with @ref flashrom_flash_cancel
  */
 int flashrom_flash_erase(struct flashrom_flashctx *flashctx);
+/** Returned by erase and write operations stopped by @ref flashrom_flash_cancel. */
+#define ERROR_FLASHROM_CANCELLED 5
+
+/**
+ * @brief Cancel the erase or write running on the given flash context.
+ *
+ * The operation stops before the next erase block is erased or the next
+ * chunk is written, so a single erase or program command is never cut
+ * short. The chip may be left partially erased or written, it is up to the
+ * caller to repeat the operation. Reads and verification are not cancelled.
+ * An operation that fails on its own reports that failure, even if it was
+ * cancelled at the same time.
+ *
+ * This is meant to be called from a signal handler while
+ * @ref flashrom_flash_erase, @ref flashrom_image_write or
+ * @ref flashrom_region_write is running in the same thread. The request is
+ * a plain `volatile sig_atomic_t`, calling this from another thread is not
+ * safe.
+ * A request that arrives while no erase or write is running stays pending and
+ * cancels the next erase or write. It is cleared when that erase or write
+ * returns, reads and verifications neither stop for it nor clear it.
+ *
+ * @param flashctx The context of the flash chip.
+ */
+void flashrom_flash_cancel(struct flashrom_flashctx *flashctx);
 /**
  * @brief Free a flash context.
  *
@@ -357,6 +387,10 @@ enum flashrom_flag {
 	FLASHROM_FLAG_VERIFY_WHOLE_CHIP,
 	FLASHROM_FLAG_SKIP_UNREADABLE_REGIONS,
 	FLASHROM_FLAG_SKIP_UNWRITABLE_REGIONS,
+	FLASHROM_FLAG_MINIMAL_PREREAD,
+	FLASHROM_FLAG_VERIFY_CHANGED,
+	FLASHROM_FLAG_TIME_OPTIMAL_ERASE,
+	FLASHROM_FLAG_USE_SFDP,
 };
 
 /**
@@ -404,6 +438,11 @@ int flashrom_image_read(struct flashrom_flashctx *flashctx, void *buffer, size_t
  * If a layout is set in the specified flash context, only erase blocks
  * containing included regions will be touched.
  *
+ * FLASHROM_FLAG_VERIFY_CHANGED and FLASHROM_FLAG_VERIFY_WHOLE_CHIP are
+ * mutually exclusive, the write is refused if both are set. With
+ * FLASHROM_FLAG_VERIFY_CHANGED, the untouched blocks that are spot checked
+ * are taken from the included regions only.
+ *
  * @param flashctx The context of the flash chip.
  * @param buffer Source buffer to read image from (may be altered for full verification).
  * @param buffer_len Size of source buffer in bytes.
@@ -413,7 +452,8 @@ int flashrom_image_read(struct flashrom_flashctx *flashctx, void *buffer, size_t
  *         4 if buffer_len doesn't match the size of the flash chip,
  *         3 if write was tried but nothing has changed,
  *         2 if write failed and flash contents changed,
- *         or 1 on any other failure.
+ *         5 if the write was cancelled with @ref flashrom_flash_cancel,
+ *         or 1 on any other failure, including conflicting verification flags.
  */
 int flashrom_image_write(struct flashrom_flashctx *flashctx, void *buffer, size_t buffer_len, const void *refbuffer);
 /**
@@ -432,6 +472,61 @@ int flashrom_image_write(struct flashrom_flashctx *flashctx, void *buffer, size_
  *         or 1 on any other failure.
  */
 int flashrom_image_verify(struct flashrom_flashctx *flashctx, const void *buffer, size_t buffer_len);
+/**
+ * @brief Read a range of the ROM chip.
+ *
+ * Unlike @ref flashrom_image_read, the layout is not used and the buffer
+ * only has to hold the range.
+ *
+ * @param flashctx The context of the flash chip.
+ * @param start Offset of the first byte to read.
+ * @param len Number of bytes to read.
+ * @param buffer Target buffer of at least `len` bytes.
+ * @return 0 on success,
+ *         -3 if prepare_flash_access check failed and operation has not started
+ *         2 if the range is empty or exceeds the flash chip,
+ *         or 1 on any other failure.
+ */
+int flashrom_region_read(struct flashrom_flashctx *flashctx, size_t start, size_t len, void *buffer);
+/**
+ * @brief Write a range of the ROM chip.
+ *
+ * Unlike @ref flashrom_image_write, the layout is not used and the buffer
+ * only has to hold the range. The range is written one erase block window
+ * of at most 64 KiB at a time, so memory use does not grow with the size
+ * of the chip. Data that shares erase blocks with the range is read and
+ * preserved. Erase blocks larger than a window are never used.
+ *
+ * @param flashctx The context of the flash chip.
+ * @param start Offset of the first byte to write.
+ * @param len Number of bytes to write.
+ * @param buffer Source buffer of `len` bytes.
+ * @return 0 on success,
+ *         -3 if prepare_flash_access check failed and operation has not started
+ *         4 if the range is empty or exceeds the flash chip,
+ *         3 if the verification after the write failed,
+ *         2 if write failed and flash contents may have changed,
+ *         5 if the write was cancelled with @ref flashrom_flash_cancel,
+ *         or 1 on any other failure.
+ */
+int flashrom_region_write(struct flashrom_flashctx *flashctx, size_t start, size_t len, const void *buffer);
+/**
+ * @brief Verify a range of the ROM chip with the specified data.
+ *
+ * Unlike @ref flashrom_image_verify, the layout is not used and the buffer
+ * only has to hold the range.
+ *
+ * @param flashctx The context of the flash chip.
+ * @param start Offset of the first byte to verify.
+ * @param len Number of bytes to verify.
+ * @param buffer Source buffer of `len` bytes to verify with.
+ * @return 0 on success,
+ *         -3 if prepare_flash_access check failed and operation has not started
+ *         3 if the chip's contents don't match,
+ *         2 if the range is empty or exceeds the flash chip,
+ *         or 1 on any other failure.
+ */
+int flashrom_region_verify(struct flashrom_flashctx *flashctx, size_t start, size_t len, const void *buffer);
 
 /** @} */ /* end flashrom-ops */
 
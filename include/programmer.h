@@ -258,6 +258,14 @@ char *extract_programmer_param_str(const struct programmer_cfg *cfg, const char
 #define SPI_MASTER_4BA			(1U << 0)  /**< Can handle 4-byte addresses */
 #define SPI_MASTER_NO_4BA_MODES		(1U << 1)  /**< Compatibility modes (i.e. extended address
 						        register, 4BA mode switch) don't work */
+#define SPI_MASTER_DUAL_READ		(1U << 2)  /**< Can receive data on two lines (1-1-2) */
+#define SPI_MASTER_DUAL_IO		(1U << 3)  /**< Can also send address on two lines (1-2-2) */
+#define SPI_MASTER_QUAD_READ		(1U << 4)  /**< Can receive data on four lines (1-1-4) */
+#define SPI_MASTER_QUAD_IO		(1U << 5)  /**< Can also send address on four lines (1-4-4) */
+#define SPI_MASTER_MULTI_IO		(SPI_MASTER_DUAL_READ | SPI_MASTER_DUAL_IO | \
+					 SPI_MASTER_QUAD_READ | SPI_MASTER_QUAD_IO)
+#define SPI_MASTER_FAST_READ		(1U << 6)  /**< Runs at clocks that need fast read (0x0b/0x0c),
+						        its wait states are sent through command */
 
 struct spi_master {
 	uint32_t features;
@@ -266,6 +274,14 @@ struct spi_master {
 	int (*command)(const struct flashctx *flash, unsigned int writecnt, unsigned int readcnt,
 		   const unsigned char *writearr, unsigned char *readarr);
 	int (*multicommand)(const struct flashctx *flash, struct spi_command *cmds);
+	/*
+	 * Like command, but only the opcode is sent on a single line. The rest of
+	 * writearr is sent on addr_width lines and readarr is received on
+	 * data_width lines. Required for any of the SPI_MASTER_MULTI_IO features.
+	 */
+	int (*multi_io_command)(const struct flashctx *flash, unsigned int addr_width, unsigned int data_width,
+				unsigned int writecnt, unsigned int readcnt,
+				const unsigned char *writearr, unsigned char *readarr);
 
 	/* Optimized functions for this master */
 	void *(*map_flash_region) (const char *descr, uintptr_t phys_addr, size_t len);
@@ -414,6 +430,33 @@ struct par_master {
 };
 int register_par_master(const struct par_master *mst, const enum chipbustype buses, void *data);
 
+/* IDs read by the probe functions, kept per master so masters never see each other's chips. */
+#define NUM_SPI_ID_TYPES	5	/* see enum id_type in spi25.c */
+#define JEDEC_PROBE_CACHE_SIZE	16
+
+enum jedec_id_sequence {
+	JEDEC_ID_SEQ_JEDEC,
+	JEDEC_ID_SEQ_29GL,
+};
+
+struct probe_cache {
+	struct spi_id_cache {
+		bool is_cached;
+		unsigned char bytes[4];		/* enough to hold largest ID type */
+		uint32_t id1, id2;		/* IDs decoded from bytes */
+	} spi_ids[NUM_SPI_ID_TYPES];
+	struct jedec_probe_memo {
+		bool valid;
+		enum jedec_id_sequence seq;
+		uintptr_t physical_memory;
+		unsigned int mask;
+		uint32_t feature_bits;		/* only the bits that change the sequence */
+		unsigned int timing_enter, timing_exit;
+		uint32_t id1, id2;
+	} jedec[JEDEC_PROBE_CACHE_SIZE];
+	unsigned int jedec_next;
+};
+
 /* programmer.c */
 struct registered_master {
 	enum chipbustype buses_supported;
@@ -422,6 +465,7 @@ struct registered_master {
 		struct spi_master spi;
 		struct opaque_master opaque;
 	};
+	struct probe_cache probe_cache;
 };
 extern struct registered_master registered_masters[];
 extern int registered_master_count;
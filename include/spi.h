@@ -190,6 +190,15 @@
 #define JEDEC_READ_EXT_ADDR_REG		0xC8
 #define ALT_READ_EXT_ADDR_REG_16	0x16
 
+/* Read Unique ID (Winbond, GigaDevice and compatible), four dummy bytes follow the opcode */
+#define JEDEC_RDUID		0x4b
+#define JEDEC_RDUID_OUTSIZE	0x05
+#define JEDEC_RDUID_INSIZE	0x08
+
+/* Read Any Register (Spansion/Cypress and compatible), address and one dummy byte follow the opcode */
+#define JEDEC_RDAR		0x65
+#define JEDEC_RDAR_OUTSIZE	0x05
+
 /* Read the memory */
 #define JEDEC_READ		0x03
 #define JEDEC_READ_OUTSIZE	0x04
@@ -198,6 +207,14 @@
 /* Read the memory (with delay after sending address) */
 #define JEDEC_READ_FAST		0x0b
 
+/* Multi-I/O fast reads, see enum spi_read_mode for the lines used by each phase */
+#define JEDEC_READ_DUAL_OUT	0x3b
+#define JEDEC_READ_DUAL_IO	0xbb
+#define JEDEC_READ_QUAD_OUT	0x6b
+#define JEDEC_READ_QUAD_IO	0xeb
+/* Upper bound of mode and wait state bytes after the address of a multi-I/O read */
+#define JEDEC_READ_MAX_WAIT_BYTES	16
+
 /* Write memory byte */
 #define JEDEC_BYTE_PROGRAM		0x02
 #define JEDEC_BYTE_PROGRAM_OUTSIZE	0x05
@@ -241,8 +258,9 @@ struct spi_command {
 #define NULL_SPI_CMD { 0, 0, NULL, NULL, }
 int spi_send_command(const struct flashctx *flash, unsigned int writecnt, unsigned int readcnt, const unsigned char *writearr, unsigned char *readarr);
 int spi_send_multicommand(const struct flashctx *flash, struct spi_command *cmds);
-
-void clear_spi_id_cache(void);
+int spi_send_multi_io_command(const struct flashctx *flash, unsigned int addr_width, unsigned int data_width,
+			      unsigned int writecnt, unsigned int readcnt,
+			      const unsigned char *writearr, unsigned char *readarr);
 
 int spi_aai_write(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len);
 int spi_chip_write_256(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len);
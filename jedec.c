@@ -10,8 +10,10 @@
  * SPDX-FileCopyrightText: 2014 Stefan Tauner
  */
 
+#include "platform/string.h"
 #include "flash.h"
 #include "parallel.h"
+#include "programmer.h"
 #include "chipdrivers.h"
 #include "helpers.h"
 #include "log.h"
@@ -41,6 +43,40 @@
 #define JEDEC_TOGGLE_DQ6	0x40	/* toggle bit: operation in progress */
 #define JEDEC_DATA_POLLING_DQ7	0x80	/* data# polling: inverted last data bit */
 
+/*
+ * probe_jedec() and probe_jedec_29gl() remember the IDs they read in the
+ * probe cache of the master. Candidate chips that share the mapping, the
+ * command sequence and its timing would only repeat the same bus cycles and
+ * delays, so the IDs are read once per such key and compared against all of
+ * them.
+ */
+static const struct jedec_probe_memo *jedec_probe_cache_lookup(const struct registered_master *mst,
+							       const struct jedec_probe_memo *key)
+{
+	for (unsigned int i = 0; i < JEDEC_PROBE_CACHE_SIZE; i++) {
+		const struct jedec_probe_memo *const memo = &mst->probe_cache.jedec[i];
+		if (memo->valid && memo->seq == key->seq &&
+		    memo->physical_memory == key->physical_memory && memo->mask == key->mask &&
+		    memo->feature_bits == key->feature_bits && memo->timing_enter == key->timing_enter &&
+		    memo->timing_exit == key->timing_exit)
+			return memo;
+	}
+	return NULL;
+}
+
+static void jedec_probe_cache_store(struct registered_master *mst, const struct jedec_probe_memo *key,
+				    uint32_t id1, uint32_t id2)
+{
+	struct probe_cache *const cache = &mst->probe_cache;
+	struct jedec_probe_memo *const memo = &cache->jedec[cache->jedec_next];
+
+	*memo = *key;
+	memo->valid = true;
+	memo->id1 = id1;
+	memo->id2 = id2;
+	cache->jedec_next = (cache->jedec_next + 1) % JEDEC_PROBE_CACHE_SIZE;
+}
+
 /* Check one byte for odd parity */
 uint8_t oddparity(uint8_t val)
 {
@@ -136,6 +172,18 @@ int probe_jedec_29gl(struct flashctx *flash)
 	const unsigned int mask = getaddrmask(flash->chip);
 	const chipaddr bios = flash->virtual_memory;
 	const struct flashchip *chip = flash->chip;
+	const struct jedec_probe_memo key = {
+		.seq = JEDEC_ID_SEQ_29GL,
+		.physical_memory = flash->physical_memory,
+		.mask = mask,
+	};
+
+	const struct jedec_probe_memo *const memo = jedec_probe_cache_lookup(flash->mst, &key);
+	if (memo) {
+		msg_cdbg("%s: man_id 0x%02"PRIx32", dev_id 0x%06"PRIx32" (cached)\n",
+			 __func__, memo->id1, memo->id2);
+		return memo->id1 == chip->manufacture_id && memo->id2 == chip->model_id;
+	}
 
 	/* Reset chip to a clean slate */
 	chip_writeb(flash, JEDEC_CMD_RESET, bios + (JEDEC_UNLOCK_ADDR1 & mask));
@@ -171,6 +219,7 @@ int probe_jedec_29gl(struct flashctx *flash)
 		msg_cdbg(", dev_id seems to be normal flash content");
 
 	msg_cdbg("\n");
+	jedec_probe_cache_store(flash->mst, &key, man_id, dev_id);
 	if (man_id != chip->manufacture_id || dev_id != chip->model_id)
 		return 0;
 
@@ -228,6 +277,21 @@ int probe_jedec(struct flashctx *flash)
 	if (probe_timings(chip, &probe_timing_enter, &probe_timing_exit) < 0)
 		return 0;
 
+	const struct jedec_probe_memo key = {
+		.seq = JEDEC_ID_SEQ_JEDEC,
+		.physical_memory = flash->physical_memory,
+		.mask = mask,
+		.feature_bits = chip->feature_bits & (FEATURE_ADDR_SHIFTED | FEATURE_RESET_MASK),
+		.timing_enter = probe_timing_enter,
+		.timing_exit = probe_timing_exit,
+	};
+
+	const struct jedec_probe_memo *const memo = jedec_probe_cache_lookup(flash->mst, &key);
+	if (memo) {
+		msg_cdbg("%s: id1 0x%02"PRIx32", id2 0x%02"PRIx32" (cached)\n", __func__, memo->id1, memo->id2);
+		return memo->id1 == chip->manufacture_id && memo->id2 == chip->model_id;
+	}
+
 	/* Earlier probes might have been too fast for the chip to enter ID
 	 * mode completely. Allow the chip to finish this before seeing a
 	 * reset command.
@@ -289,6 +353,7 @@ int probe_jedec(struct flashctx *flash)
 		msg_cdbg(", id2 is normal flash content");
 
 	msg_cdbg("\n");
+	jedec_probe_cache_store(flash->mst, &key, largeid1, largeid2);
 	if (largeid1 != chip->manufacture_id || largeid2 != chip->model_id)
 		return 0;
 
@@ -432,11 +432,17 @@ size_t flashrom_flash_getsize(const struct flashrom_flashctx *const flashctx)
 	return flashctx->chip->total_size * 1024;
 }
 
+void flashrom_flash_cancel(struct flashrom_flashctx *const flashctx)
+{
+	flashctx->cancel_requested = 1;
+}
+
 void flashrom_flash_release(struct flashrom_flashctx *const flashctx)
 {
 	if (!flashctx)
 		return;
 
+	release_flash_region_table(flashctx);
 	flashrom_layout_release(flashctx->default_layout);
 	free(flashctx->chip);
 	free(flashctx);
@@ -452,6 +458,10 @@ void flashrom_flag_set(struct flashrom_flashctx *const flashctx,
 		case FLASHROM_FLAG_VERIFY_WHOLE_CHIP:		flashctx->flags.verify_whole_chip = value; break;
 		case FLASHROM_FLAG_SKIP_UNREADABLE_REGIONS:	flashctx->flags.skip_unreadable_regions = value; break;
 		case FLASHROM_FLAG_SKIP_UNWRITABLE_REGIONS:	flashctx->flags.skip_unwritable_regions = value; break;
+		case FLASHROM_FLAG_MINIMAL_PREREAD:		flashctx->flags.minimal_preread = value; break;
+		case FLASHROM_FLAG_VERIFY_CHANGED:		flashctx->flags.verify_changed = value; break;
+		case FLASHROM_FLAG_TIME_OPTIMAL_ERASE:		flashctx->flags.time_optimal_erase = value; break;
+		case FLASHROM_FLAG_USE_SFDP:			flashctx->flags.use_sfdp = value; break;
 	}
 }
 
@@ -464,6 +474,10 @@ bool flashrom_flag_get(const struct flashrom_flashctx *const flashctx, const enu
 		case FLASHROM_FLAG_VERIFY_WHOLE_CHIP:		return flashctx->flags.verify_whole_chip;
 		case FLASHROM_FLAG_SKIP_UNREADABLE_REGIONS:	return flashctx->flags.skip_unreadable_regions;
 		case FLASHROM_FLAG_SKIP_UNWRITABLE_REGIONS:	return flashctx->flags.skip_unwritable_regions;
+		case FLASHROM_FLAG_MINIMAL_PREREAD:		return flashctx->flags.minimal_preread;
+		case FLASHROM_FLAG_VERIFY_CHANGED:		return flashctx->flags.verify_changed;
+		case FLASHROM_FLAG_TIME_OPTIMAL_ERASE:		return flashctx->flags.time_optimal_erase;
+		case FLASHROM_FLAG_USE_SFDP:			return flashctx->flags.use_sfdp;
 		default:					return false;
 	}
 }
@@ -37,6 +37,8 @@ int register_master(const struct registered_master *mst)
 		return ERROR_FLASHROM_LIMIT;
 	}
 	registered_masters[registered_master_count] = *mst;
+	/* Start without any probe results, the slot may have been used by an earlier session. */
+	registered_masters[registered_master_count].probe_cache = (struct probe_cache){ 0 };
 	registered_master_count++;
 
 	return 0;
@@ -264,7 +264,7 @@ static int32_t ch347_spi_config(struct ch347_spi_data *ch347_data, uint8_t divis
 }
 
 static const struct spi_master spi_master_ch347_spi = {
-	.features	= SPI_MASTER_4BA,
+	.features	= SPI_MASTER_4BA | SPI_MASTER_FAST_READ,
 	.max_data_read	= MAX_DATA_READ_UNLIMITED,
 	.max_data_write	= MAX_DATA_WRITE_UNLIMITED,
 	.command	= ch347_spi_send_command,
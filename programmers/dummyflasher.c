@@ -50,6 +50,12 @@ struct emu_data {
 	/* If "freq" parameter is passed in from command line, commands will delay
 	 * for this period before returning. */
 	unsigned long long delay_ns;
+	/* Time a program or erase operation keeps WIP set, counted down by the
+	 * requested delays only (see "busy_us" parameter). */
+	unsigned int emu_busy_us;
+	unsigned int emu_busy_left_us;
+	const uint8_t *sfdp_table;	/* NULL if the emulated chip has no SFDP */
+	size_t sfdp_table_len;
 	unsigned int emu_max_byteprogram_size;
 	unsigned int emu_max_aai_size;
 	unsigned int emu_jedec_se_size;
@@ -68,6 +74,7 @@ struct emu_data {
 	uint32_t wp_end;
 
 	unsigned int spi_write_256_chunksize;
+	uint32_t multi_io_features;	/* SPI_MASTER_* multi-I/O features to advertise */
 	uint8_t *flashchip_contents;
 
 	/* An instance of this structure is shared between multiple masters, so
@@ -101,6 +108,53 @@ static const uint8_t sfdp_table[] = {
 	0xFF, 0xFF, 0xFF, 0xFF, // @0x54: Macronix parameter table end
 };
 
+/*
+ * A JESD216B SFDP table of a made-up 256 Mbit chip without a way to enter
+ * 4-byte addressing. It has a 4-byte address instruction table and a sector
+ * map table that selects one of two maps by bit 3 of the register at 0x800004.
+ * The emulated register reads as 0, so 4 kB and 32 kB erases only work in the
+ * first 128 kB.
+ */
+static const uint8_t sfdp_table_jesd216b[] = {
+	0x53, 0x46, 0x44, 0x50, // @0x00: SFDP signature
+	0x06, 0x01, 0x02, 0xFF, // @0x04: revision 1.6, 3 headers
+	0x00, 0x06, 0x01, 0x10, // @0x08: JEDEC SFDP header rev. 1.6, 16 DW long
+	0x30, 0x00, 0x00, 0xFF, // @0x0C: PTP0 = 0x30
+	0x81, 0x00, 0x01, 0x07, // @0x10: sector map header rev. 1.0, 7 DW long
+	0x70, 0x00, 0x00, 0xFF, // @0x14: PTP1 = 0x70
+	0x84, 0x00, 0x01, 0x02, // @0x18: 4-byte address instruction header rev. 1.0, 2 DW long
+	0x8C, 0x00, 0x00, 0xFF, // @0x1C: PTP2 = 0x8C
+	0xFF, 0xFF, 0xFF, 0xFF, // @0x20: hole.
+	0xFF, 0xFF, 0xFF, 0xFF, // @0x24: hole.
+	0xFF, 0xFF, 0xFF, 0xFF, // @0x28: hole.
+	0xFF, 0xFF, 0xFF, 0xFF, // @0x2C: hole.
+	0x05, 0x20, 0x63, 0xFF, // @0x30: SFDP parameter table start, 4 kB erase 0x20, 3- or 4-byte addresses
+	0xFF, 0xFF, 0xFF, 0x0F, // @0x34: 256 Mbit
+	0x44, 0xEB, 0x08, 0x6B, // @0x38: 1-4-4 and 1-1-4 reads
+	0x08, 0x3B, 0x80, 0xBB, // @0x3C: 1-1-2 read
+	0xEE, 0xFF, 0xFF, 0xFF, // @0x40
+	0xFF, 0xFF, 0x00, 0x00, // @0x44
+	0xFF, 0xFF, 0x00, 0xFF, // @0x48
+	0x0C, 0x20, 0x0F, 0x52, // @0x4C: erase types 1 and 2
+	0x10, 0xD8, 0x00, 0xFF, // @0x50: erase type 3
+	0xC2, 0x3A, 0xBD, 0x00, // @0x54: erase times 45 ms, 128 ms, 256 ms, maxima 6x
+	0x82, 0xE6, 0x03, 0x60, // @0x58: 256 B pages in 448 us, bytes in 16 us, chip erase in 64 s
+	0xFF, 0xFF, 0xFF, 0xFF, // @0x5C
+	0xFF, 0xFF, 0xFF, 0xFF, // @0x60
+	0xFF, 0xFF, 0xFF, 0xFF, // @0x64
+	0x00, 0x00, 0x40, 0x00, // @0x68: QE is bit 1 of SR2, written with SR1
+	0x00, 0x00, 0x00, 0x00, // @0x6C: SFDP parameter table end, no 4-byte address entry
+	0x01, 0x65, 0x48, 0x08, // @0x70: sector map start, read 0x800004 with 0x65 and 8 dummy cycles, mask 0x08
+	0x04, 0x00, 0x80, 0x00, // @0x74
+	0x02, 0x00, 0x01, 0x00, // @0x78: configuration 0, 2 regions
+	0x07, 0xFF, 0x01, 0x00, // @0x7C: 128 kB, erase types 1-3
+	0x04, 0xFF, 0xFD, 0x01, // @0x80: rest of the chip, erase type 3
+	0x03, 0x01, 0x00, 0x00, // @0x84: configuration 1, 1 region
+	0x05, 0xFF, 0xFF, 0x01, // @0x88: sector map end, whole chip, erase types 1 and 3
+	0x43, 0x0E, 0xFF, 0xFF, // @0x8C: 4-byte address instruction table start
+	0x21, 0x5C, 0xDC, 0xFF, // @0x90: 4-byte address instruction table end
+};
+
 static void *dummy_map(const char *descr, uintptr_t phys_addr, size_t len)
 {
 	msg_pspew("%s: Mapping %s, 0x%zx bytes at 0x%0*" PRIxPTR "\n",
@@ -378,6 +432,23 @@ static int erase_flash_data(struct emu_data *data, uint32_t start, uint32_t len)
 	return 0;
 }
 
+static bool is_program_or_erase_op(uint8_t opcode)
+{
+	switch (opcode) {
+	case JEDEC_BYTE_PROGRAM:
+	case JEDEC_BYTE_PROGRAM_4BA:
+	case JEDEC_AAI_WORD_PROGRAM:
+	case JEDEC_SE:
+	case JEDEC_BE_52:
+	case JEDEC_BE_D8:
+	case JEDEC_CE_60:
+	case JEDEC_CE_C7:
+		return true;
+	default:
+		return false;
+	}
+}
+
 static int emulate_spi_chip_response(unsigned int writecnt,
 				     unsigned int readcnt,
 				     const unsigned char *writearr,
@@ -540,7 +611,7 @@ static int emulate_spi_chip_response(unsigned int writecnt,
 		}
 		break;
 	case JEDEC_RDSR:
-		memset(readarr, data->emu_status[0], readcnt);
+		memset(readarr, data->emu_status[0] | (data->emu_busy_left_us ? SPI_SR_WIP : 0), readcnt);
 		break;
 	case JEDEC_RDSR2:
 		if (data->emu_status_len >= 2)
@@ -633,6 +704,28 @@ static int emulate_spi_chip_response(unsigned int writecnt,
 		if (readcnt > 0)
 			memcpy(readarr, data->flashchip_contents + offs, readcnt);
 		break;
+	case JEDEC_READ_FAST:
+		if (writecnt < 5) {
+			msg_perr("FAST READ size too short!\n");
+			return 1;
+		}
+		offs = writearr[1] << 16 | writearr[2] << 8 | writearr[3];
+		/* Truncate to emu_chip_size. */
+		offs %= data->emu_chip_size;
+		if (readcnt > 0)
+			memcpy(readarr, data->flashchip_contents + offs, readcnt);
+		break;
+	case JEDEC_READ_4BA_FAST:
+		if (writecnt < 6) {
+			msg_perr("FAST READ 4BA size too short!\n");
+			return 1;
+		}
+		offs = writearr[1] << 24 | writearr[2] << 16 | writearr[3] << 8 | writearr[4];
+		/* Truncate to emu_chip_size. */
+		offs %= data->emu_chip_size;
+		if (readcnt > 0)
+			memcpy(readarr, data->flashchip_contents + offs, readcnt);
+		break;
 	case JEDEC_BYTE_PROGRAM:
 		offs = writearr[1] << 16 | writearr[2] << 8 | writearr[3];
 		/* Truncate to emu_chip_size. */
@@ -809,8 +902,26 @@ static int emulate_spi_chip_response(unsigned int writecnt,
 			return 1;
 		}
 		break;
+	case JEDEC_RDUID:
+		if (data->emu_chip != EMULATE_WINBOND_W25Q128FV)
+			break;
+		if (writecnt != JEDEC_RDUID_OUTSIZE)
+			break;
+		/* A made up unique ID, the same for every emulated chip. */
+		for (i = 0; i < readcnt; i++)
+			readarr[i] = 0xd1 + i;
+		break;
+	case JEDEC_RDAR:
+		/* Only the configuration register of the JESD216B sector map exists, it reads as 0. */
+		if (data->sfdp_table != sfdp_table_jesd216b)
+			break;
+		if (writecnt != JEDEC_RDAR_OUTSIZE)
+			break;
+		if ((writearr[1] << 16 | writearr[2] << 8 | writearr[3]) == 0x800004)
+			memset(readarr, 0, readcnt);
+		break;
 	case JEDEC_SFDP:
-		if (data->emu_chip != EMULATE_MACRONIX_MX25L6436)
+		if (!data->sfdp_table)
 			break;
 		if (writecnt < 4)
 			break;
@@ -832,13 +943,13 @@ static int emulate_spi_chip_response(unsigned int writecnt,
 		/* The SFDP spec implies that the start address of an SFDP read may be truncated to fit in the
 		 * SFDP table address space, i.e. the start address may be wrapped around at SFDP table size.
 		 * This is a reasonable implementation choice in hardware because it saves a few gates. */
-		if (offs >= sizeof(sfdp_table)) {
+		if (offs >= data->sfdp_table_len) {
 			msg_pdbg("Wrapping the start address around the SFDP table boundary (using 0x%x "
-				 "instead of 0x%x).\n", (unsigned int)(offs % sizeof(sfdp_table)), offs);
-			offs %= sizeof(sfdp_table);
+				 "instead of 0x%x).\n", (unsigned int)(offs % data->sfdp_table_len), offs);
+			offs %= data->sfdp_table_len;
 		}
-		toread = min(sizeof(sfdp_table) - offs, readcnt);
-		memcpy(readarr, sfdp_table + offs, toread);
+		toread = min(data->sfdp_table_len - offs, readcnt);
+		memcpy(readarr, data->sfdp_table + offs, toread);
 		if (toread < readcnt)
 			msg_pdbg("Crossing the SFDP table boundary in a single "
 				 "continuous chunk produces undefined results "
@@ -850,6 +961,8 @@ static int emulate_spi_chip_response(unsigned int writecnt,
 	}
 	if (writearr[0] != JEDEC_WREN && writearr[0] != JEDEC_EWSR)
 		data->emu_status[0] &= ~SPI_SR_WEL;
+	if (is_program_or_erase_op(writearr[0]))
+		data->emu_busy_left_us = data->emu_busy_us;
 	return 0;
 }
 
@@ -899,6 +1012,72 @@ static int dummy_spi_send_command(const struct flashctx *flash, unsigned int wri
 	return 0;
 }
 
+static bool dummy_quad_enabled(const struct emu_data *data)
+{
+	switch (data->emu_chip) {
+	case EMULATE_WINBOND_W25Q128FV:
+		return data->emu_status[1] & (1 << 1);
+	case EMULATE_MACRONIX_MX25L6436:
+		return data->emu_status[0] & (1 << 6);
+	default:
+		return false;
+	}
+}
+
+static int dummy_spi_multi_io_command(const struct flashctx *flash, unsigned int addr_width,
+				      unsigned int data_width, unsigned int writecnt, unsigned int readcnt,
+				      const unsigned char *writearr, unsigned char *readarr)
+{
+	/* Standard mode and wait state bytes of the emulated chips. */
+	static const struct {
+		uint8_t opcode;
+		unsigned int addr_width, data_width, wait_len;
+	} reads[] = {
+		{ JEDEC_READ_DUAL_OUT, 1, 2, 1 },
+		{ JEDEC_READ_DUAL_IO,  2, 2, 1 },
+		{ JEDEC_READ_QUAD_OUT, 1, 4, 1 },
+		{ JEDEC_READ_QUAD_IO,  4, 4, 3 },
+	};
+	struct emu_data *emu_data = flash->mst->spi.data;
+	unsigned int offs = 0, i;
+
+	for (i = 0; i < ARRAY_SIZE(reads); i++) {
+		if (writecnt && reads[i].opcode == writearr[0] &&
+		    reads[i].addr_width == addr_width && reads[i].data_width == data_width)
+			break;
+	}
+	if (i == ARRAY_SIZE(reads)) {
+		msg_perr("Unsupported multi-I/O command 0x%02x (1-%u-%u)!\n",
+			 writecnt ? writearr[0] : 0, addr_width, data_width);
+		return SPI_INVALID_OPCODE;
+	}
+
+	const unsigned int addr_len = writecnt - 1 - reads[i].wait_len;
+	if (writecnt < 1 + reads[i].wait_len || (addr_len != 3 && addr_len != 4)) {
+		msg_perr("Multi-I/O read 0x%02x with invalid length %u!\n", writearr[0], writecnt);
+		return SPI_INVALID_LENGTH;
+	}
+	if (data_width == 4 && !dummy_quad_enabled(emu_data)) {
+		msg_perr("Quad read 0x%02x while the QE bit is not set!\n", writearr[0]);
+		return 1;
+	}
+
+	msg_pspew("%s: 1-%u-%u read 0x%02x of %u bytes\n", __func__, addr_width, data_width,
+		  writearr[0], readcnt);
+	memset(readarr, 0xff, readcnt);
+	if (emu_data->emu_chip != EMULATE_NONE && readcnt) {
+		for (i = 0; i < addr_len; i++)
+			offs = offs << 8 | writearr[1 + i];
+		/* Truncate to emu_chip_size. */
+		offs %= emu_data->emu_chip_size;
+		memcpy(readarr, emu_data->flashchip_contents + offs, readcnt);
+	}
+
+	/* Data arrives on several lines at once. */
+	default_delay(((writecnt + readcnt / data_width) * emu_data->delay_ns) / 1000);
+	return 0;
+}
+
 static int dummy_shutdown(void *data)
 {
 	msg_pspew("%s\n", __func__);
@@ -926,6 +1105,14 @@ static void dummy_nop_delay(const struct flashctx *flash, unsigned int usecs)
 {
 }
 
+/* Emulated busy time passes only when flashrom asks for a delay, nothing sleeps for real. */
+static void dummy_spi_delay(const struct flashctx *flash, unsigned int usecs)
+{
+	struct emu_data *emu_data = flash->mst->spi.data;
+
+	emu_data->emu_busy_left_us -= min(usecs, emu_data->emu_busy_left_us);
+}
+
 static enum flashrom_wp_result dummy_wp_read_cfg(struct flashrom_wp_cfg *cfg, struct flashctx *flash)
 {
 	cfg->mode = FLASHROM_WP_MODE_DISABLED;
@@ -956,15 +1143,16 @@ static enum flashrom_wp_result dummy_wp_get_available_ranges(struct flashrom_wp_
 static const struct spi_master spi_master_dummyflasher = {
 	.map_flash_region	= dummy_map,
 	.unmap_flash_region	= dummy_unmap,
-	.features	= SPI_MASTER_4BA,
+	.features	= SPI_MASTER_4BA | SPI_MASTER_FAST_READ,
 	.max_data_read	= MAX_DATA_READ_UNLIMITED,
 	.max_data_write	= MAX_DATA_UNSPECIFIED,
 	.command	= dummy_spi_send_command,
+	.multi_io_command = dummy_spi_multi_io_command,
 	.read		= default_spi_read,
 	.write_256	= dummy_spi_write_256,
 	.shutdown	= dummy_shutdown,
 	.probe_opcode	= dummy_spi_probe_opcode,
-	.delay		= dummy_nop_delay,
+	.delay		= dummy_spi_delay,
 };
 
 static const struct par_master par_master_dummyflasher = {
@@ -1047,6 +1235,31 @@ static int init_data(const struct programmer_cfg *cfg,
 	}
 	free(tmp);
 
+	tmp = extract_programmer_param_str(cfg, "busy_us");
+	if (tmp) {
+		data->emu_busy_us = strtoul(tmp, &endptr, 0);
+		if (*endptr != '\0') {
+			msg_perr("invalid busy_us\n");
+			free(tmp);
+			return 1;
+		}
+	}
+	free(tmp);
+
+	tmp = extract_programmer_param_str(cfg, "multi_io");
+	if (tmp) {
+		if (!strcmp(tmp, "dual")) {
+			data->multi_io_features = SPI_MASTER_DUAL_READ | SPI_MASTER_DUAL_IO;
+		} else if (!strcmp(tmp, "quad")) {
+			data->multi_io_features = SPI_MASTER_MULTI_IO;
+		} else if (strcmp(tmp, "no")) {
+			msg_perr("multi_io can be \"dual\", \"quad\" or \"no\"\n");
+			free(tmp);
+			return 1;
+		}
+	}
+	free(tmp);
+
 	tmp = extract_programmer_param_str(cfg, "spi_blacklist");
 	if (tmp) {
 		i = strlen(tmp);
@@ -1261,6 +1474,8 @@ static int init_data(const struct programmer_cfg *cfg,
 		data->emu_jedec_be_d8_size = 64 * 1024;
 		data->emu_jedec_ce_60_size = data->emu_chip_size;
 		data->emu_jedec_ce_c7_size = data->emu_chip_size;
+		data->sfdp_table = sfdp_table;
+		data->sfdp_table_len = sizeof(sfdp_table);
 		msg_pdbg("Emulating Macronix MX25L6436 SPI flash chip (RDID, "
 			 "SFDP)\n");
 	}
@@ -1341,6 +1556,26 @@ static int init_data(const struct programmer_cfg *cfg,
 	}
 	free(tmp);
 
+	/* Replaces the SFDP table of the emulated chip. */
+	tmp = extract_programmer_param_str(cfg, "sfdp");
+	if (tmp) {
+		if (!data->sfdp_table) {
+			msg_perr("%s: sfdp parameter is only valid for chips with SFDP.\n", __func__);
+			free(tmp);
+			return 1;
+		}
+		if (!strcmp(tmp, "jesd216b")) {
+			msg_pdbg("Emulated chip will report a JESD216B SFDP table\n");
+			data->sfdp_table = sfdp_table_jesd216b;
+			data->sfdp_table_len = sizeof(sfdp_table_jesd216b);
+		} else {
+			msg_perr("sfdp can only be \"jesd216b\"\n");
+			free(tmp);
+			return 1;
+		}
+	}
+	free(tmp);
+
 	status = extract_programmer_param_str(cfg, "spi_status");
 	if (status) {
 		unsigned int emu_status;
@@ -1456,8 +1691,10 @@ dummy_init_out:
 					   data);
 	}
 	if ((dummy_buses_supported & BUS_SPI) && !ret) {
+		struct spi_master mst = spi_master_dummyflasher;
+		mst.features |= data->multi_io_features;
 		data->refs_cnt++;
-		ret |= register_spi_master(&spi_master_dummyflasher, data);
+		ret |= register_spi_master(&mst, data);
 	}
 
 	return ret;
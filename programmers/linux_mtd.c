@@ -9,6 +9,7 @@
 #include <ctype.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -20,14 +21,17 @@
 
 #include "flash.h"
 #include "programmer.h"
+#include "contents_diff.h"
 #include "helpers.h"
 #include "log.h"
 
 #define LINUX_DEV_ROOT			"/dev"
 #define LINUX_MTD_SYSFS_ROOT		"/sys/class/mtd"
+/* Reads and writes are split into requests of this size, or of one eraseblock if that is larger. */
+#define LINUX_MTD_IO_SIZE		(1024 * 1024)
 
 struct linux_mtd_data {
-	FILE *dev_fp;
+	int dev_fd;
 	bool device_is_writeable;
 	bool no_erase;
 	bool ignore_read_errors;
@@ -175,34 +179,71 @@ static int linux_mtd_probe(struct flashctx *flash)
 	return 1;
 }
 
-static int linux_mtd_read(struct flashctx *flash, uint8_t *buf,
-			  unsigned int start, unsigned int len)
+/* Reads or writes exactly `len` bytes at `offset`, returns 0 on success. */
+static int linux_mtd_pread(int fd, uint8_t *buf, size_t len, off_t offset)
+{
+	while (len) {
+		const ssize_t ret = pread(fd, buf, len, offset);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			if (!ret)
+				errno = EIO;
+			return 1;
+		}
+		buf += ret;
+		len -= ret;
+		offset += ret;
+	}
+	return 0;
+}
+
+static int linux_mtd_pwrite(int fd, const uint8_t *buf, size_t len, off_t offset)
+{
+	while (len) {
+		const ssize_t ret = pwrite(fd, buf, len, offset);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			if (!ret)
+				errno = EIO;
+			return 1;
+		}
+		buf += ret;
+		len -= ret;
+		offset += ret;
+	}
+	return 0;
+}
+
+/*
+ * Size of the next request at `addr`. Requests are large to keep the number
+ * of syscalls low, but end at eraseblock boundaries.
+ * FIXME: Shouldn't actually be necessary, but not all MTD drivers handle
+ * arbitrary large requests well.
+ */
+static unsigned int linux_mtd_io_step(const struct linux_mtd_data *data, unsigned int addr, unsigned int left)
+{
+	const unsigned int io_size = max(LINUX_MTD_IO_SIZE, data->erasesize);
+	return min(io_size - addr % io_size, left);
+}
+
+/*
+ * Reads a range that failed as a whole once more per eraseblock, so that only
+ * the unreadable eraseblocks are substituted. Returns the number of bytes that
+ * were substituted.
+ */
+static unsigned int linux_mtd_read_per_eraseblock(struct flashctx *flash, uint8_t *buf,
+						  unsigned int start, unsigned int len)
 {
 	struct linux_mtd_data *data = flash->mst->opaque.data;
-	unsigned int eb_size = flash->chip->block_erasers[0].eraseblocks[0].size;
 	unsigned int skipped = 0;
 	unsigned int i;
 
-	if (fseek(data->dev_fp, start, SEEK_SET) != 0) {
-		msg_perr("Cannot seek to 0x%06x: %s\n", start, strerror(errno));
-		return 1;
-	}
-
 	for (i = 0; i < len; ) {
-		/*
-		 * Try to align reads to eraseblock size.
-		 * FIXME: Shouldn't actually be necessary, but not all MTD
-		 * drivers handle arbitrary large reads well.
-		 */
-		unsigned int step = eb_size - ((start + i) % eb_size);
-		step = min(step, len - i);
-
-		if (fread(buf + i, step, 1, data->dev_fp) != 1) {
-			if (!data->ignore_read_errors) {
-				msg_perr("Cannot read 0x%06x bytes at 0x%06x: %s\n",
-						step, start + i, strerror(errno));
-				return 1;
-			}
+		const unsigned int step = min(data->erasesize - (start + i) % data->erasesize, len - i);
+
+		if (linux_mtd_pread(data->dev_fd, buf + i, step, start + i)) {
 			/*
 			 * Controllers may refuse reads of protected ranges,
 			 * e.g. intel-spi with firmware-set protected range
@@ -213,12 +254,31 @@ static int linux_mtd_read(struct flashctx *flash, uint8_t *buf,
 					step, start + i, strerror(errno));
 			memset(buf + i, ERASED_VALUE(flash), step);
 			skipped += step;
-			clearerr(data->dev_fp);
-			if (fseek(data->dev_fp, start + i + step, SEEK_SET) != 0) {
-				msg_perr("Cannot seek past unreadable region to 0x%06x: %s\n",
-						start + i + step, strerror(errno));
+		}
+		i += step;
+	}
+
+	return skipped;
+}
+
+/* Reads straight into the caller's buffer. */
+static int linux_mtd_read(struct flashctx *flash, uint8_t *buf,
+			  unsigned int start, unsigned int len)
+{
+	struct linux_mtd_data *data = flash->mst->opaque.data;
+	unsigned int skipped = 0;
+	unsigned int i;
+
+	for (i = 0; i < len; ) {
+		const unsigned int step = linux_mtd_io_step(data, start + i, len - i);
+
+		if (linux_mtd_pread(data->dev_fd, buf + i, step, start + i)) {
+			if (!data->ignore_read_errors) {
+				msg_perr("Cannot read 0x%06x bytes at 0x%06x: %s\n",
+						step, start + i, strerror(errno));
 				return 1;
 			}
+			skipped += linux_mtd_read_per_eraseblock(flash, buf + i, start + i, step);
 		}
 
 		i += step;
@@ -232,39 +292,20 @@ static int linux_mtd_read(struct flashctx *flash, uint8_t *buf,
 	return 0;
 }
 
-/* this version assumes we must divide the write request into chunks ourselves */
 static int linux_mtd_write(struct flashctx *flash, const uint8_t *buf,
 				unsigned int start, unsigned int len)
 {
 	struct linux_mtd_data *data = flash->mst->opaque.data;
-	unsigned int chunksize = flash->chip->block_erasers[0].eraseblocks[0].size;
 	unsigned int i;
 
 	if (!data->device_is_writeable)
 		return 1;
 
-	if (fseek(data->dev_fp, start, SEEK_SET) != 0) {
-		msg_perr("Cannot seek to 0x%06x: %s\n", start, strerror(errno));
-		return 1;
-	}
-
-	/*
-	 * Try to align writes to eraseblock size. We want these large enough
-	 * to give MTD room for optimizing performance.
-	 * FIXME: Shouldn't need to divide this up at all, but not all MTD
-	 * drivers handle arbitrary large writes well.
-	 */
 	for (i = 0; i < len; ) {
-		unsigned int step = chunksize - ((start + i) % chunksize);
-		step = min(step, len - i);
-
-		if (fwrite(buf + i, step, 1, data->dev_fp) != 1) {
-			msg_perr("Cannot write 0x%06x bytes at 0x%06x\n", step, start + i);
-			return 1;
-		}
+		const unsigned int step = linux_mtd_io_step(data, start + i, len - i);
 
-		if (fflush(data->dev_fp) == EOF) {
-			msg_perr("Failed to flush buffer: %s\n", strerror(errno));
+		if (linux_mtd_pwrite(data->dev_fd, buf + i, step, start + i)) {
+			msg_perr("Cannot write 0x%06x bytes at 0x%06x: %s\n", step, start + i, strerror(errno));
 			return 1;
 		}
 
@@ -275,11 +316,37 @@ static int linux_mtd_write(struct flashctx *flash, const uint8_t *buf,
 	return 0;
 }
 
+static int linux_mtd_erase_range(const struct linux_mtd_data *data, uint64_t start, uint64_t len)
+{
+	struct erase_info_user64 erase_info = {
+		.start = start,
+		.length = len,
+	};
+
+	int ret = ioctl(data->dev_fd, MEMERASE64, &erase_info);
+	if (ret < 0) {
+		msg_perr("%s: MEMERASE64 ioctl call for 0x%06"PRIx64" bytes at 0x%06"PRIx64" returned %d, "
+			 "error: %s\n", __func__, len, start, ret, strerror(errno));
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * When the caller doesn't know the current contents, i.e. for a plain erase,
+ * eraseblocks that already read back as erased are skipped. Reading a 64 KiB
+ * block of SPI NOR takes about 10ms against 150ms or more for erasing it, so
+ * this pays off as soon as a few percent of the blocks are erased already.
+ * When writing, the caller only erases blocks that it read as not erased, and
+ * the read-back would be pure overhead.
+ */
 static int linux_mtd_erase(struct flashctx *flash,
 			unsigned int start, unsigned int len)
 {
 	struct linux_mtd_data *data = flash->mst->opaque.data;
+	uint8_t *buf = NULL;
 	uint32_t u;
+	int ret = 0;
 
 	if (data->no_erase) {
 		msg_perr("%s: device does not support erasing. Please file a "
@@ -287,29 +354,36 @@ static int linux_mtd_erase(struct flashctx *flash,
 		return 1;
 	}
 
-	for (u = 0; u < len; u += data->erasesize) {
-		struct erase_info_user erase_info = {
-			.start = start + u,
-			.length = data->erasesize,
-		};
+	if (flash->contents_unknown) {
+		buf = malloc(data->erasesize);
+		if (!buf) {
+			msg_perr("Out of memory!\n");
+			return 1;
+		}
+	}
 
-		int ret = ioctl(fileno(data->dev_fp), MEMERASE, &erase_info);
-		if (ret < 0) {
-		        msg_perr("%s: MEMERASE ioctl call returned %d, error: %s\n",
-		                 __func__, ret, strerror(errno));
-		        return 1;
+	for (u = 0; u < len; u += data->erasesize) {
+		/* A block that can't be read is erased anyway. */
+		if (buf && !linux_mtd_pread(data->dev_fd, buf, data->erasesize, start + u) &&
+		    contents_is_erased(buf, data->erasesize, ERASED_VALUE(flash))) {
+			msg_pspew("%s: skipping erased block at 0x%06x\n", __func__, start + u);
+			continue;
 		}
+
+		ret = linux_mtd_erase_range(data, start + u, data->erasesize);
+		if (ret)
+			break;
 	}
 
-	return 0;
+	free(buf);
+	return ret;
 }
 
 static int linux_mtd_shutdown(void *data)
 {
 	struct linux_mtd_data *mtd_data = data;
-	if (mtd_data->dev_fp != NULL) {
-		fclose(mtd_data->dev_fp);
-	}
+	if (mtd_data->dev_fd >= 0)
+		close(mtd_data->dev_fd);
 	free(data);
 
 	return 0;
@@ -332,7 +406,7 @@ static enum flashrom_wp_result linux_mtd_wp_read_cfg(struct flashrom_wp_cfg *cfg
 			.length = data->erasesize,
 		};
 
-		int ret = ioctl(fileno(data->dev_fp), MEMISLOCKED, &erase_info);
+		int ret = ioctl(data->dev_fd, MEMISLOCKED, &erase_info);
 		if (ret == 0) {
 			/* Block is unprotected. */
 
@@ -394,7 +468,7 @@ static enum flashrom_wp_result linux_mtd_wp_write_cfg(struct flashctx *flash, co
 	 * just protect the requsted range, we need to disable the current
 	 * write protection and then enable it for the desired range.
 	 */
-	int ret = ioctl(fileno(data->dev_fp), MEMUNLOCK, &entire_chip);
+	int ret = ioctl(data->dev_fd, MEMUNLOCK, &entire_chip);
 	if (ret < 0) {
 		msg_perr("%s: Failed to disable write-protection, MEMUNLOCK ioctl "
 			 "retuned %d, error: %s\n", __func__, ret, strerror(errno));
@@ -402,7 +476,7 @@ static enum flashrom_wp_result linux_mtd_wp_write_cfg(struct flashctx *flash, co
 	}
 
 	if (cfg->range.len > 0) {
-		ret = ioctl(fileno(data->dev_fp), MEMLOCK, &desired_range);
+		ret = ioctl(data->dev_fd, MEMLOCK, &desired_range);
 		if (ret < 0) {
 			msg_perr("%s: Failed to enable write-protection, "
 				 "MEMLOCK ioctl retuned %d, error: %s\n",
@@ -487,13 +561,11 @@ static int linux_mtd_setup(int dev_num, struct linux_mtd_data *data)
 	if (get_mtd_info(sysfs_path, data))
 		return 1;
 
-	/* open file stream and go! */
-	if ((data->dev_fp = fopen(dev_path, "r+")) == NULL) {
-		msg_perr("Cannot open file stream for %s\n", dev_path);
+	/* open device and go! */
+	if ((data->dev_fd = open(dev_path, O_RDWR)) < 0) {
+		msg_perr("Cannot open %s: %s\n", dev_path, strerror(errno));
 		return 1;
 	}
-	if (setvbuf(data->dev_fp, NULL, _IONBF, 0))
-		msg_pwarn("Failed to set MTD device to unbuffered\n");
 
 	msg_pinfo("Opened %s successfully\n", dev_path);
 
@@ -544,6 +616,7 @@ static int linux_mtd_init(const struct programmer_cfg *cfg)
 		msg_perr("Unable to allocate memory for linux_mtd_data\n");
 		return 1;
 	}
+	data->dev_fd = -1;
 
 	param_str = extract_programmer_param_str(cfg, "ignore_read_errors");
 	if (param_str) {
@@ -35,6 +35,8 @@
  */
 
 #define BUF_SIZE_FROM_SYSFS	"/sys/module/spidev/parameters/bufsiz"
+/* Transfers batched into one SPI_IOC_MESSAGE, each command takes up to two. */
+#define MAX_BATCHED_TRANSFERS	16
 
 struct linux_spi_data {
 	int fd;
@@ -46,14 +48,18 @@ static int linux_spi_read(struct flashctx *flash, uint8_t *buf, unsigned int sta
 	struct linux_spi_data *spi_data = flash->mst->spi.data;
 	/* Older kernels use a single buffer for combined input and output
 	   data. So account for longest possible command + address, too. */
-	return spi_read_chunked(flash, buf, start, len, spi_data->max_kernel_buf_size - 5);
+	unsigned int overhead = 5;
+	if (flash->read_mode != SPI_READ_1_1_1)
+		overhead += JEDEC_READ_MAX_WAIT_BYTES;
+	return spi_read_chunked(flash, buf, start, len, spi_data->max_kernel_buf_size - overhead);
 }
 
 static int linux_spi_write_256(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
 {
 	struct linux_spi_data *spi_data = flash->mst->spi.data;
-	/* 5 bytes must be reserved for longest possible command + address. */
-	return spi_write_chunked(flash, buf, start, len, spi_data->max_kernel_buf_size - 5);
+	/* 5 bytes must be reserved for longest possible command + address,
+	   1 byte for the WREN that is sent in the same message. */
+	return spi_write_chunked(flash, buf, start, len, spi_data->max_kernel_buf_size - 6);
 }
 
 static int linux_spi_shutdown(void *data)
@@ -103,11 +109,107 @@ static int linux_spi_send_command(const struct flashctx *flash, unsigned int wri
 	return 0;
 }
 
+static int linux_spi_transfer(int fd, struct spi_ioc_transfer *msg, unsigned int count)
+{
+	if (ioctl(fd, SPI_IOC_MESSAGE(count), msg) == -1) {
+		msg_cerr("%s: ioctl: %s\n", __func__, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Sends as many commands as fit into the kernel buffer with one ioctl. Chip
+ * select is released between the commands by setting cs_change on the last
+ * transfer of each command but the final one.
+ */
+static int linux_spi_send_multicommand(const struct flashctx *flash, struct spi_command *cmds)
+{
+	struct linux_spi_data *spi_data = flash->mst->spi.data;
+	struct spi_ioc_transfer msg[MAX_BATCHED_TRANSFERS];
+	unsigned int count = 0;
+	size_t total = 0;
+
+	if (spi_data->fd == -1)
+		return -1;
+
+	for (; cmds->writecnt || cmds->readcnt; cmds++) {
+		/* Like linux_spi_send_command(), every command has to start with sending. */
+		if (cmds->writecnt == 0)
+			return SPI_INVALID_LENGTH;
+
+		/* Older kernels use a single buffer for combined input and
+		   output data of all transfers in a message. */
+		const size_t len = cmds->writecnt + cmds->readcnt;
+		if (count && (count + 2 > MAX_BATCHED_TRANSFERS || total + len > spi_data->max_kernel_buf_size)) {
+			if (linux_spi_transfer(spi_data->fd, msg, count))
+				return -1;
+			count = 0;
+			total = 0;
+		}
+
+		if (count)
+			msg[count - 1].cs_change = 1;
+		msg[count++] = (struct spi_ioc_transfer){
+			.tx_buf = (uint64_t)(uintptr_t)cmds->writearr,
+			.len = cmds->writecnt,
+		};
+		if (cmds->readcnt) {
+			msg[count++] = (struct spi_ioc_transfer){
+				.rx_buf = (uint64_t)(uintptr_t)cmds->readarr,
+				.len = cmds->readcnt,
+			};
+		}
+		total += len;
+	}
+
+	return count ? linux_spi_transfer(spi_data->fd, msg, count) : 0;
+}
+
+static int linux_spi_send_multi_io_command(const struct flashctx *flash, unsigned int addr_width,
+					   unsigned int data_width, unsigned int writecnt, unsigned int readcnt,
+					   const unsigned char *txbuf, unsigned char *rxbuf)
+{
+	struct linux_spi_data *spi_data = flash->mst->spi.data;
+	/* Opcode on a single line, address and wait states on addr_width
+	   lines, data on data_width lines. */
+	struct spi_ioc_transfer msg[3] = {
+		{
+			.tx_buf = (uint64_t)(uintptr_t)txbuf,
+			.len = 1,
+			.tx_nbits = 1,
+		},
+		{
+			.tx_buf = (uint64_t)(uintptr_t)(txbuf + 1),
+			.len = writecnt - 1,
+			.tx_nbits = addr_width,
+		},
+		{
+			.rx_buf = (uint64_t)(uintptr_t)rxbuf,
+			.len = readcnt,
+			.rx_nbits = data_width,
+		},
+	};
+
+	if (spi_data->fd == -1)
+		return -1;
+	if (writecnt < 2 || readcnt == 0)
+		return SPI_INVALID_LENGTH;
+
+	if (ioctl(spi_data->fd, SPI_IOC_MESSAGE(3), msg) == -1) {
+		msg_cerr("%s: ioctl: %s\n", __func__, strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
 static const struct spi_master spi_master_linux = {
-	.features	= SPI_MASTER_4BA,
+	.features	= SPI_MASTER_4BA | SPI_MASTER_FAST_READ,
 	.max_data_read	= MAX_DATA_UNSPECIFIED, /* TODO? */
 	.max_data_write	= MAX_DATA_UNSPECIFIED, /* TODO? */
 	.command	= linux_spi_send_command,
+	.multicommand	= linux_spi_send_multicommand,
+	.multi_io_command = linux_spi_send_multi_io_command,
 	.read		= linux_spi_read,
 	.write_256	= linux_spi_write_256,
 	.shutdown	= linux_spi_shutdown,
@@ -154,6 +256,31 @@ out:
 	return result;
 }
 
+/* Multi-I/O transfers the controller driver and device tree allow for this device. */
+static uint32_t get_multi_io_features(int fd)
+{
+	uint32_t features = 0;
+#if defined(SPI_IOC_RD_MODE32) && defined(SPI_RX_QUAD)
+	uint32_t mode;
+
+	if (ioctl(fd, SPI_IOC_RD_MODE32, &mode) == -1) {
+		msg_pdbg("%s: failed to read SPI mode: %s\n", __func__, strerror(errno));
+		return 0;
+	}
+	if (mode & SPI_RX_DUAL)
+		features |= SPI_MASTER_DUAL_READ;
+	if ((mode & SPI_RX_DUAL) && (mode & SPI_TX_DUAL))
+		features |= SPI_MASTER_DUAL_IO;
+	if (mode & SPI_RX_QUAD)
+		features |= SPI_MASTER_QUAD_READ;
+	if ((mode & SPI_RX_QUAD) && (mode & SPI_TX_QUAD))
+		features |= SPI_MASTER_QUAD_IO;
+	msg_pdbg("%s: SPI mode 0x%08"PRIx32", multi-I/O features 0x%02"PRIx32"\n",
+		 __func__, mode, features);
+#endif
+	return features;
+}
+
 static int linux_spi_init(const struct programmer_cfg *cfg)
 {
 	char *param_str, *endp;
@@ -165,6 +292,7 @@ static int linux_spi_init(const struct programmer_cfg *cfg)
 	int fd;
 	size_t max_kernel_buf_size;
 	struct linux_spi_data *spi_data;
+	struct spi_master mst = spi_master_linux;
 
 	param_str = extract_programmer_param_str(cfg, "spispeed");
 	if (param_str && strlen(param_str)) {
@@ -217,6 +345,9 @@ static int linux_spi_init(const struct programmer_cfg *cfg)
 		goto init_err;
 	}
 
+	/* Writing the 8-bit mode above keeps the bus widths set up by the kernel. */
+	mst.features |= get_multi_io_features(fd);
+
 	max_kernel_buf_size = get_max_kernel_buf_size();
 	msg_pdbg("%s: max_kernel_buf_size: %zu\n", __func__, max_kernel_buf_size);
 
@@ -228,7 +359,7 @@ static int linux_spi_init(const struct programmer_cfg *cfg)
 	spi_data->fd = fd;
 	spi_data->max_kernel_buf_size = max_kernel_buf_size;
 
-	return register_spi_master(&spi_master_linux, spi_data);
+	return register_spi_master(&mst, spi_data);
 
 init_err:
 	close(fd);
@@ -5,6 +5,7 @@
  * SPDX-FileCopyrightText: 2011-2012 Stefan Tauner
  */
 
+#include <limits.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include "platform/string.h"
@@ -70,6 +71,21 @@ struct sfdp_tbl_hdr {
 	uint32_t ptp; /* 24b pointer */
 };
 
+/* Erase types of the JEDEC flash parameter table, the other tables refer to them by index. */
+#define SFDP_ERASE_TYPES 4
+
+struct sfdp_erase_type {
+	uint8_t opcode;
+	uint32_t size; /* 0 if the type is unused */
+};
+
+/* Returns double word `index` (counted from 0) of a parameter table. */
+static uint32_t sfdp_dword(const uint8_t *buf, unsigned int index)
+{
+	buf += 4 * index;
+	return buf[0] | (uint32_t)buf[1] << 8 | (uint32_t)buf[2] << 16 | (uint32_t)buf[3] << 24;
+}
+
 static int sfdp_add_uniform_eraser(struct flashchip *chip, uint8_t opcode, uint32_t block_size)
 {
 	int i;
@@ -114,6 +130,137 @@ static int sfdp_add_uniform_eraser(struct flashchip *chip, uint8_t opcode, uint3
 	return 1;
 }
 
+/*
+ * Fills a multi-I/O fast read from its 16-bit field in the JEDEC flash parameter table:
+ * wait states in bits 4:0, mode clocks in bits 7:5 and the opcode in bits 15:8.
+ */
+static void sfdp_add_fast_read(struct flashchip *chip, enum spi_read_mode mode, bool supported,
+			       const uint8_t *field)
+{
+	if (!supported)
+		return;
+
+	chip->fast_read[mode].dummy_clocks = field[0] & 0x1f;
+	chip->fast_read[mode].mode_clocks = field[0] >> 5;
+	chip->fast_read[mode].opcode = field[1];
+	msg_cdbg2("  Fast read mode %d: opcode 0x%02x, %d mode clocks, %d wait states.\n", mode,
+		  field[1], field[0] >> 5, field[0] & 0x1f);
+}
+
+static struct block_eraser *sfdp_find_eraser(struct flashchip *chip, const struct sfdp_erase_type *type)
+{
+	const enum block_erase_func erasefn = spi25_get_erasefn_from_opcode(type->opcode);
+
+	for (int i = 0; i < NUM_ERASEFUNCTIONS; i++) {
+		struct block_eraser *eraser = &chip->block_erasers[i];
+		if (erasefn != NO_BLOCK_ERASE_FUNC && eraser->block_erase == erasefn &&
+		    eraser->eraseblocks[0].size == type->size)
+			return eraser;
+	}
+	return NULL;
+}
+
+/*
+ * Typical times in double words 10 and 11 are a count (minus one) of units,
+ * the unit is selected by the bits above the count. The maximum time is the
+ * typical one times 2 * (multiplier + 1).
+ */
+static struct op_timing sfdp_timing(uint32_t field, unsigned int count_bits, const unsigned int *units_us,
+				    unsigned int multiplier)
+{
+	const uint64_t typ_us = (uint64_t)((field & ((1 << count_bits) - 1)) + 1) * units_us[field >> count_bits];
+	const uint64_t max_us = typ_us * 2 * (multiplier + 1);
+
+	/* Chip erase maxima can exceed an hour, keep them within range for doubling. */
+	return (struct op_timing){
+		.typ_us = typ_us < UINT_MAX / 2 ? typ_us : UINT_MAX / 2,
+		.max_us = max_us < UINT_MAX / 2 ? max_us : UINT_MAX / 2,
+	};
+}
+
+/* 10. double word: typical erase times of the erase types, one multiplier for their maxima. */
+static void sfdp_fill_erase_timings(struct flashchip *chip, uint32_t dw10, const struct sfdp_erase_type *types)
+{
+	static const unsigned int units_us[] = { 1000, 16 * 1000, 128 * 1000, 1000 * 1000 };
+
+	for (int j = 0; j < SFDP_ERASE_TYPES; j++) {
+		struct block_eraser *eraser = types[j].size ? sfdp_find_eraser(chip, &types[j]) : NULL;
+		if (!eraser)
+			continue;
+		eraser->timing = sfdp_timing((dw10 >> (4 + 7 * j)) & 0x7f, 5, units_us, dw10 & 0xf);
+		msg_cdbg2("  Erase Type %d takes %u us, at most %u us.\n", j + 1,
+			  eraser->timing.typ_us, eraser->timing.max_us);
+	}
+}
+
+/* 11. double word: page size, program times and chip erase time. */
+static void sfdp_fill_program_timings(struct flashchip *chip, uint32_t dw11, unsigned int erase_multiplier)
+{
+	static const unsigned int page_units_us[] = { 8, 64 };
+	static const unsigned int byte_units_us[] = { 1, 8 };
+	static const unsigned int chip_units_us[] = { 16 * 1000, 256 * 1000, 4 * 1000 * 1000, 64 * 1000 * 1000 };
+	const unsigned int multiplier = dw11 & 0xf;
+
+	if (chip->write == SPI_CHIP_WRITE256) {
+		chip->page_size = 1 << ((dw11 >> 4) & 0xf);
+		msg_cdbg2("  Page size is %u B.\n", chip->page_size);
+	}
+	chip->page_program = sfdp_timing((dw11 >> 8) & 0x3f, 5, page_units_us, multiplier);
+	chip->byte_program = sfdp_timing((dw11 >> 14) & 0x1f, 4, byte_units_us, multiplier);
+	msg_cdbg2("  Page program takes %u us, at most %u us.\n",
+		  chip->page_program.typ_us, chip->page_program.max_us);
+
+	/* Chip erase is not among the erase types, but JESD216B chips support it. */
+	const struct sfdp_erase_type chip_erase = { JEDEC_CE_C7, chip->total_size * 1024 };
+	sfdp_add_uniform_eraser(chip, chip_erase.opcode, chip_erase.size);
+	struct block_eraser *eraser = sfdp_find_eraser(chip, &chip_erase);
+	if (eraser) {
+		eraser->timing = sfdp_timing((dw11 >> 24) & 0x7f, 5, chip_units_us, erase_multiplier);
+		msg_cdbg2("  Chip erase takes %u us, at most %u us.\n", eraser->timing.typ_us, eraser->timing.max_us);
+	}
+}
+
+/* 15. double word: where the Quad Enable bit is (QER, bits 22:20). */
+static void sfdp_fill_quad_enable(struct flashchip *chip, uint32_t dw15)
+{
+	switch ((dw15 >> 20) & 0x7) {
+	case 0x2:
+		chip->reg_bits.qe = (struct reg_bit_info){ STATUS1, 6, RW };
+		break;
+	case 0x4:
+	case 0x5:
+		/* Read with 0x35, written together with SR1 by 0x01. */
+		chip->reg_bits.qe = (struct reg_bit_info){ STATUS2, 1, RW };
+		chip->feature_bits |= FEATURE_WRSR_EXT2;
+		break;
+	case 0x6:
+		/* Read with 0x35, written on its own by 0x31. */
+		chip->reg_bits.qe = (struct reg_bit_info){ STATUS2, 1, RW };
+		chip->feature_bits |= FEATURE_WRSR2;
+		break;
+	default:
+		/* No QE bit, or one that can't be read back with standard opcodes. */
+		msg_cdbg2("  Quad enable requirements 0x%"PRIx32" not supported.\n", (dw15 >> 20) & 0x7);
+		return;
+	}
+	msg_cdbg2("  Quad enable bit is bit %u of SR%d.\n", chip->reg_bits.qe.bit_index,
+		  chip->reg_bits.qe.reg == STATUS1 ? 1 : 2);
+}
+
+/* 16. double word: how to enter 4-byte addressing (bits 31:24). */
+static void sfdp_fill_4ba_entry(struct flashchip *chip, uint32_t dw16)
+{
+	const uint8_t enter = dw16 >> 24;
+
+	if (enter & (1 << 0))
+		chip->feature_bits |= FEATURE_4BA_ENTER;
+	if (enter & (1 << 1))
+		chip->feature_bits |= FEATURE_4BA_ENTER_WREN;
+	if (enter & (1 << 2))
+		chip->feature_bits |= FEATURE_4BA_EAR_C5C8;
+	msg_cdbg2("  4-byte address entry methods 0x%02x.\n", enter);
+}
+
 static int compare_erasers(const void *aptr, const void *bptr)
 {
 	const struct block_eraser *a = aptr;
@@ -128,7 +275,7 @@ static int compare_erasers(const void *aptr, const void *bptr)
 	return ((int) a->eraseblocks[0].size) - ((int) b->eraseblocks[0].size);
 }
 
-static int sfdp_fill_flash(struct flashchip *chip, uint8_t *buf, uint16_t len)
+static int sfdp_fill_flash(struct flashchip *chip, uint8_t *buf, uint16_t len, struct sfdp_erase_type *types)
 {
 	uint8_t opcode_4k_erase = 0xFF;
 	uint32_t tmp32;
@@ -213,7 +360,7 @@ static int sfdp_fill_flash(struct flashchip *chip, uint8_t *buf, uint16_t len)
 	total_size = ((tmp32 & 0x7FFFFFFF) + 1) / 8;
 	chip->total_size = total_size / 1024;
 	msg_cdbg2("  Flash chip size is %d kB.\n", chip->total_size);
-	if (total_size > (1 << 24)) {
+	if (total_size > (1 << 24) && len < 16 * 4) {
 		msg_cdbg("Flash chip size is bigger than what 3-Byte addressing "
 			 "can access.\n");
 		return 1;
@@ -222,7 +369,8 @@ static int sfdp_fill_flash(struct flashchip *chip, uint8_t *buf, uint16_t len)
 	if (opcode_4k_erase != 0xFF)
 		sfdp_add_uniform_eraser(chip, opcode_4k_erase, 4 * 1024);
 
-	/* FIXME: double words 3-7 contain unused fast read information */
+	/* JESD216 devices support fast read (0x0b) with 8 wait states. */
+	chip->fast_read[SPI_READ_1_1_1_FAST] = (struct spi_fast_read){ JEDEC_READ_FAST, 0, 8 };
 
 	if (len == 4 * 4) {
 		msg_cdbg("  It seems like this chip supports the preliminary "
@@ -231,8 +379,18 @@ static int sfdp_fill_flash(struct flashchip *chip, uint8_t *buf, uint16_t len)
 		goto done;
 	}
 
+	/* 1. double word flags which multi-I/O fast reads are supported, 3. and 4. describe them. */
+	tmp32 =  ((unsigned int)buf[(4 * 0) + 0]);
+	tmp32 |= ((unsigned int)buf[(4 * 0) + 1]) << 8;
+	tmp32 |= ((unsigned int)buf[(4 * 0) + 2]) << 16;
+	tmp32 |= ((unsigned int)buf[(4 * 0) + 3]) << 24;
+	sfdp_add_fast_read(chip, SPI_READ_1_4_4, tmp32 & (1 << 21), &buf[(4 * 2) + 0]);
+	sfdp_add_fast_read(chip, SPI_READ_1_1_4, tmp32 & (1 << 22), &buf[(4 * 2) + 2]);
+	sfdp_add_fast_read(chip, SPI_READ_1_1_2, tmp32 & (1 << 16), &buf[(4 * 3) + 0]);
+	sfdp_add_fast_read(chip, SPI_READ_1_2_2, tmp32 & (1 << 20), &buf[(4 * 3) + 2]);
+
 	/* 8. double word */
-	for (j = 0; j < 4; j++) {
+	for (j = 0; j < SFDP_ERASE_TYPES; j++) {
 		/* 7 double words from the start + 2 bytes for every eraser */
 		tmp8 = buf[(4 * 7) + (j * 2)];
 		msg_cspew("   Erase Sector Type %d Size: 0x%02x\n", j + 1,
@@ -251,20 +409,21 @@ static int sfdp_fill_flash(struct flashchip *chip, uint8_t *buf, uint16_t len)
 		tmp8 = buf[(4 * 7) + (j * 2) + 1];
 		msg_cspew("   Erase Sector Type %d Opcode: 0x%02x\n", j + 1,
 			  tmp8);
-		sfdp_add_uniform_eraser(chip, tmp8, block_size);
+		/* The 4kB eraser of the 1. double word is usually one of the types. */
+		if (!sfdp_add_uniform_eraser(chip, tmp8, block_size) ||
+		    (tmp8 == opcode_4k_erase && block_size == 4 * 1024))
+			types[j] = (struct sfdp_erase_type){ tmp8, block_size };
 	}
 
-	/* Sort block erasers in ascending order by size; this is required
-	 * for erase logic, see erasure_layout.c */
-	qsort(chip->block_erasers, NUM_ERASEFUNCTIONS,
-		sizeof(chip->block_erasers[0]), compare_erasers);
-	for (j = 0; j < NUM_ERASEFUNCTIONS; j++) {
-		const struct block_eraser *eraser = &chip->block_erasers[j];
-		msg_cdbg2("  Sorted eraser #%u: %"PRId32" x %"PRId32" B\n",
-			j,
-			eraser->eraseblocks[0].count,
-			eraser->eraseblocks[0].size);
+	/* Double words 10-16 were added in JESD216A and JESD216B. */
+	if (len >= 11 * 4) {
+		sfdp_fill_erase_timings(chip, sfdp_dword(buf, 9), types);
+		sfdp_fill_program_timings(chip, sfdp_dword(buf, 10), sfdp_dword(buf, 9) & 0xf);
 	}
+	if (len >= 15 * 4)
+		sfdp_fill_quad_enable(chip, sfdp_dword(buf, 14));
+	if (len >= 16 * 4)
+		sfdp_fill_4ba_entry(chip, sfdp_dword(buf, 15));
 
 done:
 	msg_cdbg("done.\n");
@@ -353,8 +512,150 @@ done:
 	return 0;
 }
 
-int probe_spi_sfdp(struct flashctx *flash)
+/*
+ * Parses the 4-byte address instruction table (JESD216B). Chips that can't
+ * switch to 4-byte addresses need the 4-byte variants of their erasers.
+ */
+static int parse_4bait_parameter_table(struct flashchip *const chip, const uint8_t *const buf,
+				       const uint16_t len, struct sfdp_erase_type *types)
+{
+	if (len < 2 * 4) {
+		msg_cdbg("Length of 4-byte address instruction table is wrong, skipping it\n");
+		return 1;
+	}
+
+	msg_cdbg("Parsing 4-byte address instruction table... ");
+	const uint32_t first_dword = sfdp_dword(buf, 0);
+	if (first_dword & (1 << 0))
+		chip->feature_bits |= FEATURE_4BA_READ;
+	if (first_dword & (1 << 1))
+		chip->feature_bits |= FEATURE_4BA_FAST_READ;
+	if (first_dword & (1 << 6))
+		chip->feature_bits |= FEATURE_4BA_WRITE;
+
+	if (chip->total_size <= 16 * 1024 ||
+	    chip->feature_bits & (FEATURE_4BA_ENTER | FEATURE_4BA_ENTER_WREN | FEATURE_4BA_EAR_ANY))
+		goto done;
+
+	/* Bits 12:9 flag the erase types with a 4-byte variant, the second double word has their opcodes. */
+	for (int j = 0; j < SFDP_ERASE_TYPES; j++) {
+		struct block_eraser *eraser = types[j].size ? sfdp_find_eraser(chip, &types[j]) : NULL;
+		if (!eraser)
+			continue;
+		const uint8_t opcode = buf[4 + j];
+		if (!(first_dword & (1 << (9 + j))) ||
+		    spi25_get_erasefn_from_opcode(opcode) == NO_BLOCK_ERASE_FUNC) {
+			msg_cdbg2("\n  Erase Type %d has no usable 4-byte variant, dropping it.", j + 1);
+			*eraser = (struct block_eraser){ .block_erase = NO_BLOCK_ERASE_FUNC };
+			types[j].size = 0;
+			continue;
+		}
+		eraser->block_erase = spi25_get_erasefn_from_opcode(opcode);
+		types[j].opcode = opcode;
+	}
+
+done:
+	msg_cdbg("done.\n");
+	return 0;
+}
+
+/*
+ * Runs one configuration detection command of the sector map table.
+ * Returns the resulting bit of the configuration ID, or -1 on failure.
+ */
+static int sfdp_detect_configuration(struct flashctx *flash, uint32_t descriptor, uint32_t address)
 {
+	const unsigned int latency = (descriptor >> 16) & 0xf;
+	const unsigned int addr_len = (descriptor >> 22) & 0x3;
+	uint8_t cmd[1 + 4 + 1] = { (descriptor >> 8) & 0xff, };
+	unsigned int cmd_len = 1;
+	uint8_t data;
+
+	/* Variable address lengths and latencies depend on the current chip configuration. */
+	if (addr_len == 0x3 || latency % 8)
+		return -1;
+	/* 0: no address, 1: 3 bytes, 2: 4 bytes */
+	for (int i = addr_len ? addr_len + 2 : 0; i > 0; i--)
+		cmd[cmd_len++] = address >> (8 * (i - 1));
+	cmd_len += latency / 8;
+
+	if (spi_send_command(flash, cmd_len, 1, cmd, &data))
+		return -1;
+	return (data & (descriptor >> 24)) != 0;
+}
+
+/*
+ * Parses the sector map parameter table (JESD216B) of chips with non-uniform
+ * sectors. Erase types that don't work in all sectors are dropped, as every
+ * eraser has to cover the whole chip.
+ */
+static int parse_sector_map_parameter_table(struct flashctx *flash, struct flashchip *const chip,
+					    const uint8_t *const buf, const uint16_t len,
+					    struct sfdp_erase_type *types)
+{
+	const unsigned int dwords = len / 4;
+	unsigned int i = 0, config_id = 0;
+
+	msg_cdbg("Parsing sector map parameter table... ");
+
+	/* Command descriptors (bit 1 cleared) come first, each one adds a bit to the configuration ID. */
+	for (; i + 1 < dwords && !(sfdp_dword(buf, i) & (1 << 1)); i += 2) {
+		const int bit = sfdp_detect_configuration(flash, sfdp_dword(buf, i), sfdp_dword(buf, i + 1));
+		if (bit < 0) {
+			msg_cdbg("configuration detection failed, skipping it.\n");
+			return 1;
+		}
+		config_id = config_id << 1 | bit;
+	}
+
+	while (i < dwords) {
+		const uint32_t descriptor = sfdp_dword(buf, i);
+		const unsigned int regions = ((descriptor >> 16) & 0xff) + 1;
+
+		if (!(descriptor & (1 << 1)) || i + 1 + regions > dwords)
+			break;
+		if (((descriptor >> 8) & 0xff) != config_id) {
+			if (descriptor & (1 << 0))
+				break;
+			i += 1 + regions;
+			continue;
+		}
+
+		uint8_t everywhere = 0xf;
+		uint64_t map_size = 0;
+		for (unsigned int r = 0; r < regions; r++) {
+			const uint32_t region = sfdp_dword(buf, i + 1 + r);
+			everywhere &= region & 0xf;
+			map_size += ((uint64_t)(region >> 8) + 1) * 256;
+		}
+		if (map_size != chip->total_size * 1024ULL) {
+			msg_cdbg("map does not cover the chip, skipping it.\n");
+			return 1;
+		}
+
+		for (int j = 0; j < SFDP_ERASE_TYPES; j++) {
+			struct block_eraser *eraser = types[j].size ? sfdp_find_eraser(chip, &types[j]) : NULL;
+			if (!eraser || everywhere & (1 << j))
+				continue;
+			msg_cdbg2("\n  Erase Type %d only works in some sectors, dropping it.", j + 1);
+			*eraser = (struct block_eraser){ .block_erase = NO_BLOCK_ERASE_FUNC };
+			types[j].size = 0;
+		}
+		msg_cdbg("done.\n");
+		return 0;
+	}
+
+	msg_cdbg("no map for configuration %u, skipping it.\n", config_id);
+	return 1;
+}
+
+/*
+ * Reads all SFDP parameter tables into `chip`. Returns 1 if the mandatory
+ * JEDEC flash parameter table was parsed, 0 otherwise.
+ */
+static int sfdp_parse(struct flashctx *flash, struct flashchip *chip)
+{
+	struct sfdp_erase_type types[SFDP_ERASE_TYPES] = { 0 };
 	int ret = 0;
 	uint8_t buf[8];
 	uint32_t tmp32;
@@ -474,7 +775,7 @@ int probe_spi_sfdp(struct flashctx *flash)
 				msg_cdbg("Length of the mandatory JEDEC SFDP "
 					 "parameter table is wrong (%d B), "
 					 "skipping it.\n", len);
-			} else if (sfdp_fill_flash(flash->chip, tbuf, len) == 0) {
+			} else if (sfdp_fill_flash(chip, tbuf, len, types) == 0) {
 				ret = 1;
 			}
 		} else {
@@ -487,9 +788,15 @@ int probe_spi_sfdp(struct flashctx *flash)
 							 "parameters table (Version: %u.%u), skipping it.\n",
 							 hdrs[i].v_major, hdrs[i].v_minor);
 					} else {
-						parse_rpmc_parameter_table(flash->chip, tbuf, len);
+						parse_rpmc_parameter_table(chip, tbuf, len);
 					}
 					break;
+				case 0x81: /* Sector map parameter table as specified in JESD216B */
+					parse_sector_map_parameter_table(flash, chip, tbuf, len, types);
+					break;
+				case 0x84: /* 4-byte address instruction table as specified in JESD216B */
+					parse_4bait_parameter_table(chip, tbuf, len, types);
+					break;
 				default:
 					msg_cdbg("Support for SFDP Page with ID 0x%02x not implemented"
 						 ", skipping it.\n",
@@ -506,3 +813,94 @@ cleanup_hdrs:
 	free(hbuf);
 	return ret;
 }
+
+int probe_spi_sfdp(struct flashctx *flash)
+{
+	struct flashchip *chip = flash->chip;
+
+	if (!sfdp_parse(flash, chip))
+		return 0;
+
+	if (chip->total_size > 16 * 1024 &&
+	    !(chip->feature_bits & (FEATURE_4BA_ENTER | FEATURE_4BA_ENTER_WREN | FEATURE_4BA_EAR_ANY)) &&
+	    (chip->feature_bits & (FEATURE_4BA_READ | FEATURE_4BA_WRITE)) != (FEATURE_4BA_READ | FEATURE_4BA_WRITE)) {
+		msg_cdbg("Flash chip size is bigger than what 3-Byte addressing "
+			 "can access and there is no usable 4-Byte addressing mode.\n");
+		return 0;
+	}
+
+	/* Sort block erasers in ascending order by size; this is required
+	 * for erase logic, see erasure_layout.c */
+	qsort(chip->block_erasers, NUM_ERASEFUNCTIONS,
+		sizeof(chip->block_erasers[0]), compare_erasers);
+	for (int j = 0; j < NUM_ERASEFUNCTIONS; j++) {
+		const struct block_eraser *eraser = &chip->block_erasers[j];
+		msg_cdbg2("  Sorted eraser #%u: %"PRId32" x %"PRId32" B\n",
+			j,
+			eraser->eraseblocks[0].count,
+			eraser->eraseblocks[0].size);
+	}
+	return 1;
+}
+
+static bool sfdp_same_eraser(const struct block_eraser *a, const struct block_eraser *b)
+{
+	/* Both chip erase opcodes do the same. */
+	const bool a_chip = a->block_erase == SPI_BLOCK_ERASE_60 || a->block_erase == SPI_BLOCK_ERASE_C7;
+	const bool b_chip = b->block_erase == SPI_BLOCK_ERASE_60 || b->block_erase == SPI_BLOCK_ERASE_C7;
+
+	if (a->eraseblocks[0].size != b->eraseblocks[0].size || a->eraseblocks[1].count)
+		return false;
+	return a->block_erase == b->block_erase || (a_chip && b_chip);
+}
+
+int spi_sfdp_apply(struct flashctx *flash)
+{
+	struct flashchip *const chip = flash->chip;
+	struct flashchip *const sfdp = calloc(1, sizeof(*sfdp));
+	int ret = 1;
+
+	if (!sfdp) {
+		msg_gerr("Out of memory!\n");
+		return 1;
+	}
+
+	msg_cdbg("Reading SFDP parameters of %s %s.\n", chip->vendor, chip->name);
+	if (!sfdp_parse(flash, sfdp)) {
+		msg_cdbg("No usable SFDP parameters found.\n");
+		goto out;
+	}
+	if (sfdp->total_size != chip->total_size) {
+		msg_cwarn("SFDP claims a chip size of %u kB instead of %u kB, not using it.\n",
+			  sfdp->total_size, chip->total_size);
+		goto out;
+	}
+
+	for (int i = 0; i < NUM_ERASEFUNCTIONS; i++) {
+		struct block_eraser *eraser = &chip->block_erasers[i];
+		for (int j = 0; j < NUM_ERASEFUNCTIONS && !eraser->timing.typ_us; j++) {
+			if (sfdp_same_eraser(eraser, &sfdp->block_erasers[j]))
+				eraser->timing = sfdp->block_erasers[j].timing;
+		}
+	}
+	if (!chip->page_program.typ_us)
+		chip->page_program = sfdp->page_program;
+	if (!chip->byte_program.typ_us)
+		chip->byte_program = sfdp->byte_program;
+
+	for (int mode = 0; mode < SPI_NUM_READ_MODES; mode++) {
+		if (!chip->fast_read[mode].opcode)
+			chip->fast_read[mode] = sfdp->fast_read[mode];
+	}
+
+	/* Only take a QE bit the database entry can read back. */
+	const struct reg_bit_info *qe = &sfdp->reg_bits.qe;
+	if (chip->reg_bits.qe.reg == INVALID_REG &&
+	    (qe->reg == STATUS1 || (qe->reg == STATUS2 && chip->feature_bits & (FEATURE_WRSR_EXT2 | FEATURE_WRSR2))))
+		chip->reg_bits.qe = *qe;
+
+	ret = 0;
+out:
+	free(sfdp);
+	return ret;
+}
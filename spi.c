@@ -68,6 +68,16 @@ int spi_send_multicommand(const struct flashctx *flash, struct spi_command *cmds
 	return default_spi_send_multicommand(flash, cmds);
 }
 
+int spi_send_multi_io_command(const struct flashctx *flash, unsigned int addr_width, unsigned int data_width,
+			      unsigned int writecnt, unsigned int readcnt,
+			      const unsigned char *writearr, unsigned char *readarr)
+{
+	if (!flash->mst->spi.multi_io_command)
+		return SPI_FLASHROM_BUG;
+	return flash->mst->spi.multi_io_command(flash, addr_width, data_width,
+						writecnt, readcnt, writearr, readarr);
+}
+
 int default_spi_read(struct flashctx *flash, uint8_t *buf, unsigned int start,
 		     unsigned int len)
 {
@@ -151,6 +161,12 @@ int register_spi_master(const struct spi_master *mst, void *data)
 		return ERROR_FLASHROM_BUG;
 	}
 
+	if ((mst->features & SPI_MASTER_MULTI_IO) && !mst->multi_io_command) {
+		msg_perr("%s called with multi-I/O features but no multi_io_command. "
+			 "Please report a bug at flashrom@flashrom.org\n",
+			 __func__);
+		return ERROR_FLASHROM_BUG;
+	}
 
 	rmst.buses_supported = BUS_SPI;
 	rmst.spi = *mst;
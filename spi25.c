@@ -20,26 +20,15 @@
 #include "helpers.h"
 #include "log.h"
 
+/* Indices into probe_cache.spi_ids of the master, keep NUM_SPI_ID_TYPES in sync. */
 enum id_type {
 	RDID,
 	RDID4,
 	REMS,
 	RES2,
 	RES3,
-	NUM_ID_TYPES,
 };
 
-static struct {
-	bool is_cached;
-	unsigned char bytes[4];		/* enough to hold largest ID type */
-} id_cache[NUM_ID_TYPES];
-
-void clear_spi_id_cache(void)
-{
-	memset(id_cache, 0, sizeof(id_cache));
-	return;
-}
-
 static int spi_rdid(struct flashctx *flash, unsigned char *readarr, int bytes)
 {
 	static const unsigned char cmd[JEDEC_RDID_OUTSIZE] = { JEDEC_RDID };
@@ -84,6 +73,40 @@ static int spi_res(struct flashctx *flash, unsigned char *readarr, int bytes)
 	return 0;
 }
 
+/*
+ * Reads the factory programmed unique ID of the chip with JEDEC_RDUID. Only
+ * chips with FEATURE_UNIQUE_ID are asked, other chips may use the opcode for
+ * something else. Has to be called between prepare_flash_access() and
+ * finalize_flash_access(), the number of dummy bytes depends on the address
+ * mode. An all-0x00 or all-0xff answer is treated as "no unique ID available".
+ * Returns 0 on success, 1 if the chip didn't provide an ID.
+ */
+int spi_read_unique_id(struct flashctx *flash, uint8_t *id, unsigned int len)
+{
+	/* Opcode and four dummy bytes, one more dummy byte in 4BA mode. */
+	static const unsigned char cmd[JEDEC_RDUID_OUTSIZE + 1] = { JEDEC_RDUID };
+	const unsigned int writecnt = flash->in_4ba_mode ? JEDEC_RDUID_OUTSIZE + 1 : JEDEC_RDUID_OUTSIZE;
+
+	if (!(flash->chip->feature_bits & FEATURE_UNIQUE_ID)) {
+		msg_cdbg("%s: chip has no unique ID.\n", __func__);
+		return 1;
+	}
+
+	if (spi_send_command(flash, writecnt, len, cmd, id))
+		return 1;
+
+	bool all_zero = true, all_ones = true;
+	for (unsigned int i = 0; i < len; i++) {
+		all_zero &= id[i] == 0x00;
+		all_ones &= id[i] == 0xff;
+	}
+	if (all_zero || all_ones) {
+		msg_cdbg("%s: chip did not return a unique ID.\n", __func__);
+		return 1;
+	}
+	return 0;
+}
+
 int spi_write_enable(struct flashctx *flash)
 {
 	static const unsigned char cmd[JEDEC_WREN_OUTSIZE] = { JEDEC_WREN };
@@ -130,28 +153,60 @@ static void rdid_get_ids(unsigned char *readarr, int bytes,
 	}
 }
 
-static int compare_id(const struct flashctx *flash, uint32_t id1, uint32_t id2)
+static bool ids_match(const struct flashchip *chip, uint32_t id1, uint32_t id2)
 {
-	const struct flashchip *chip = flash->chip;
-
-	msg_cdbg("%s: id1 0x%02"PRIx32", id2 0x%02"PRIx32"\n", __func__, id1, id2);
 	if (id1 == chip->manufacture_id && id2 == chip->model_id)
-		return 1;
+		return true;
 
 	/* Test if this is a pure vendor match. */
 	if (id1 == chip->manufacture_id && GENERIC_DEVICE_ID == chip->model_id)
-		return 1;
+		return true;
 
 	/* Test if there is any vendor ID. */
 	if (GENERIC_MANUF_ID == chip->manufacture_id && id1 != 0xff && id1 != 0x00)
-		return 1;
+		return true;
 
-	return 0;
+	return false;
+}
+
+static int compare_id(const struct flashctx *flash, uint32_t id1, uint32_t id2)
+{
+	msg_cdbg("%s: id1 0x%02"PRIx32", id2 0x%02"PRIx32"\n", __func__, id1, id2);
+	return ids_match(flash->chip, id1, id2);
+}
+
+/*
+ * Checks a chip against the IDs cached by earlier probes on @mst without
+ * sending any command. Returns false only if the chip's probe function would
+ * certainly not match it, which lets probe_flash() skip setting up such
+ * candidates.
+ */
+bool spi_probe_may_match(const struct registered_master *mst, const struct flashchip *chip)
+{
+	const struct spi_id_cache *const id_cache = mst->probe_cache.spi_ids;
+	enum id_type idty;
+
+	switch (chip->probe) {
+	case PROBE_SPI_RDID:	idty = RDID; break;
+	case PROBE_SPI_RDID4:	idty = RDID4; break;
+	case PROBE_SPI_REMS:	idty = REMS; break;
+	case PROBE_SPI_RES2:	idty = RES2; break;
+	default:
+		return true;
+	}
+
+	if (!id_cache[idty].is_cached)
+		return true;
+
+	const uint32_t id1 = id_cache[idty].id1, id2 = id_cache[idty].id2;
+	if (idty == RES2)
+		return id1 == chip->manufacture_id && id2 == chip->model_id;
+	return ids_match(chip, id1, id2);
 }
 
 static int probe_spi_rdid_generic(struct flashctx *flash, int bytes)
 {
-	uint32_t id1, id2;
+	struct spi_id_cache *const id_cache = flash->mst->probe_cache.spi_ids;
 	enum id_type idty = bytes == 3 ? RDID : RDID4;
 
 	if (!id_cache[idty].is_cached) {
@@ -160,11 +215,11 @@ static int probe_spi_rdid_generic(struct flashctx *flash, int bytes)
 			msg_cinfo("%d byte RDID not supported on this SPI controller\n", bytes);
 		if (ret)
 			return 0;
+		rdid_get_ids(id_cache[idty].bytes, bytes, &id_cache[idty].id1, &id_cache[idty].id2);
 		id_cache[idty].is_cached = true;
 	}
 
-	rdid_get_ids(id_cache[idty].bytes, bytes, &id1, &id2);
-	return compare_id(flash, id1, id2);
+	return compare_id(flash, id_cache[idty].id1, id_cache[idty].id2);
 }
 
 int probe_spi_rdid(struct flashctx *flash)
@@ -179,17 +234,17 @@ int probe_spi_rdid4(struct flashctx *flash)
 
 int probe_spi_rems(struct flashctx *flash)
 {
-	uint32_t id1, id2;
+	struct spi_id_cache *const id_cache = flash->mst->probe_cache.spi_ids;
 
 	if (!id_cache[REMS].is_cached) {
 		if (spi_rems(flash, id_cache[REMS].bytes))
 			return 0;
+		id_cache[REMS].id1 = id_cache[REMS].bytes[0];
+		id_cache[REMS].id2 = id_cache[REMS].bytes[1];
 		id_cache[REMS].is_cached = true;
 	}
 
-	id1 = id_cache[REMS].bytes[0];
-	id2 = id_cache[REMS].bytes[1];
-	return compare_id(flash, id1, id2);
+	return compare_id(flash, id_cache[REMS].id1, id_cache[REMS].id2);
 }
 
 int probe_spi_res1(struct flashctx *flash)
@@ -235,16 +290,19 @@ int probe_spi_res1(struct flashctx *flash)
 
 int probe_spi_res2(struct flashctx *flash)
 {
+	struct spi_id_cache *const id_cache = flash->mst->probe_cache.spi_ids;
 	uint32_t id1, id2;
 
 	if (!id_cache[RES2].is_cached) {
 		if (spi_res(flash, id_cache[RES2].bytes, 2))
 			return 0;
+		id_cache[RES2].id1 = id_cache[RES2].bytes[0];
+		id_cache[RES2].id2 = id_cache[RES2].bytes[1];
 		id_cache[RES2].is_cached = true;
 	}
 
-	id1 = id_cache[RES2].bytes[0];
-	id2 = id_cache[RES2].bytes[1];
+	id1 = id_cache[RES2].id1;
+	id2 = id_cache[RES2].id2;
 	msg_cdbg("%s: id1 0x%"PRIx32", id2 0x%"PRIx32"\n", __func__, id1, id2);
 
 	if (id1 != flash->chip->manufacture_id || id2 != flash->chip->model_id)
@@ -255,16 +313,19 @@ int probe_spi_res2(struct flashctx *flash)
 
 int probe_spi_res3(struct flashctx *flash)
 {
+	struct spi_id_cache *const id_cache = flash->mst->probe_cache.spi_ids;
 	uint32_t id1, id2;
 
 	if (!id_cache[RES3].is_cached) {
 		if (spi_res(flash, id_cache[RES3].bytes, 3))
 			return 0;
+		id_cache[RES3].id1 = (id_cache[RES3].bytes[0] << 8) | id_cache[RES3].bytes[1];
+		id_cache[RES3].id2 = id_cache[RES3].bytes[3];
 		id_cache[RES3].is_cached = true;
 	}
 
-	id1 = (id_cache[RES3].bytes[0] << 8) | id_cache[RES3].bytes[1];
-	id2 = id_cache[RES3].bytes[3];
+	id1 = id_cache[RES3].id1;
+	id2 = id_cache[RES3].id2;
 	msg_cdbg("%s: id1 0x%"PRIx32", id2 0x%"PRIx32"\n", __func__, id1, id2);
 
 	if (id1 != flash->chip->manufacture_id || id2 != flash->chip->model_id)
@@ -295,18 +356,93 @@ int probe_spi_at25f(struct flashctx *flash)
 	return 0;
 }
 
-static int spi_poll_wip(struct flashctx *const flash, const unsigned int poll_delay)
+/*
+ * WIP polling is paced by the busy times observed earlier for the same opcode.
+ * The first status read happens shortly before the operation is expected to
+ * complete, further reads follow with exponential backoff up to the caller's
+ * `poll_delay`. Until an opcode was seen once, WIP is polled every `poll_delay`.
+ *
+ * Busy times are accounted as the sum of the requested delays. That is a lower
+ * bound of the wall time, so neither the learned times nor the timeout depend
+ * on how long a status read takes on the programmer.
+ *
+ * Typical and maximum times from SFDP stand in for an opcode that wasn't seen
+ * yet, and the maximum time extends the timeout for very slow operations.
+ */
+#define WIP_TIMEOUT_FACTOR	1000
+#define WIP_TIMEOUT_MIN_US	(1000 * 1000)
+
+unsigned int spi_wip_busy_time(const struct flashctx *flash, uint8_t opcode)
+{
+	for (size_t i = 0; i < NUM_WIP_TIMINGS; i++) {
+		if (flash->wip_timings[i].samples && flash->wip_timings[i].opcode == opcode)
+			return flash->wip_timings[i].busy_us;
+	}
+	return 0;
+}
+
+static void spi_wip_record(struct flashctx *flash, uint8_t opcode, unsigned int busy_us)
 {
-	/* FIXME: We don't time out. */
+	struct wip_timing *free_slot = NULL;
+
+	for (size_t i = 0; i < NUM_WIP_TIMINGS; i++) {
+		struct wip_timing *timing = &flash->wip_timings[i];
+		if (!timing->samples) {
+			if (!free_slot)
+				free_slot = timing;
+			continue;
+		}
+		if (timing->opcode != opcode)
+			continue;
+		/* Moving average, recent operations weigh more. */
+		timing->busy_us = (timing->busy_us * 3 + busy_us) / 4;
+		timing->samples++;
+		return;
+	}
+
+	if (free_slot)
+		*free_slot = (struct wip_timing){ .opcode = opcode, .samples = 1, .busy_us = busy_us };
+}
+
+static struct op_timing spi_op_timing(const struct flashctx *flash, uint8_t opcode);
+
+static int spi_poll_wip(struct flashctx *const flash, const uint8_t opcode, const unsigned int poll_delay)
+{
+	const struct op_timing timing = spi_op_timing(flash, opcode);
+	const unsigned int observed = spi_wip_busy_time(flash, opcode);
+	const unsigned int expected = observed ? observed : timing.typ_us;
+	unsigned int timeout = poll_delay < WIP_TIMEOUT_MIN_US / WIP_TIMEOUT_FACTOR ?
+			       WIP_TIMEOUT_MIN_US : poll_delay * WIP_TIMEOUT_FACTOR;
+	unsigned int waited = 0, delay = poll_delay;
+
+	if (timeout < 2 * timing.max_us)
+		timeout = 2 * timing.max_us;
+
+	if (expected) {
+		waited = expected - expected / 8;
+		programmer_delay(flash, waited);
+		delay = min(max(expected / 16, 1), poll_delay);
+	}
+
 	while (true) {
 		uint8_t status;
 		int ret = spi_read_register(flash, STATUS1, &status);
 		if (ret)
 			return ret;
-		if (!(status & SPI_SR_WIP))
+		if (!(status & SPI_SR_WIP)) {
+			spi_wip_record(flash, opcode, waited);
 			return 0;
+		}
+		if (waited >= timeout) {
+			msg_cerr("%s: opcode 0x%02x still busy after %u us, giving up.\n",
+				 __func__, opcode, waited);
+			return SPI_GENERIC_ERROR;
+		}
 
-		programmer_delay(flash, poll_delay);
+		programmer_delay(flash, delay);
+		waited += delay;
+		if (expected)
+			delay = min(delay * 2, poll_delay);
 	}
 }
 
@@ -337,7 +473,7 @@ static int spi_simple_write_cmd(struct flashctx *const flash, const uint8_t op,
 	if (result)
 		msg_cerr("%s failed during command execution\n", __func__);
 
-	const int status = poll_delay ? spi_poll_wip(flash, poll_delay) : 0;
+	const int status = poll_delay ? spi_poll_wip(flash, op, poll_delay) : 0;
 
 	return result ? result : status;
 }
@@ -468,7 +604,7 @@ static int spi_write_cmd(struct flashctx *const flash, const uint8_t op,
 	if (result)
 		msg_cerr("%s failed during command execution at address 0x%x\n", __func__, addr);
 
-	const int status = spi_poll_wip(flash, poll_delay);
+	const int status = spi_poll_wip(flash, op, poll_delay);
 
 	return result ? result : status;
 }
@@ -653,6 +789,35 @@ enum block_erase_func spi25_get_erasefn_from_opcode(uint8_t opcode)
 	return NO_BLOCK_ERASE_FUNC;
 }
 
+/* Returns the busy time observed for an erase function, or 0 if it wasn't used yet. */
+unsigned int spi_erase_busy_time(const struct flashctx *flash, enum block_erase_func func)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(spi25_function_opcode_list); i++) {
+		if (spi25_function_opcode_list[i].func == func)
+			return spi_wip_busy_time(flash, spi25_function_opcode_list[i].opcode);
+	}
+	return 0;
+}
+
+/* Returns the typical and maximum busy times known for an opcode, zero if there are none. */
+static struct op_timing spi_op_timing(const struct flashctx *flash, uint8_t opcode)
+{
+	const struct flashchip *chip = flash->chip;
+
+	if (opcode == JEDEC_BYTE_PROGRAM || opcode == JEDEC_BYTE_PROGRAM_4BA)
+		return chip->write == SPI_CHIP_WRITE1 ? chip->byte_program : chip->page_program;
+
+	for (size_t i = 0; i < ARRAY_SIZE(spi25_function_opcode_list); i++) {
+		if (spi25_function_opcode_list[i].opcode != opcode)
+			continue;
+		for (size_t j = 0; j < NUM_ERASEFUNCTIONS; j++) {
+			if (chip->block_erasers[j].block_erase == spi25_function_opcode_list[i].func)
+				return chip->block_erasers[j].timing;
+		}
+	}
+	return (struct op_timing){ 0 };
+}
+
 static int spi_nbyte_program(struct flashctx *flash, unsigned int addr, const uint8_t *bytes, unsigned int len)
 {
 	const bool native_4ba = flash->chip->feature_bits & FEATURE_4BA_WRITE && spi_master_4ba(flash);
@@ -660,9 +825,125 @@ static int spi_nbyte_program(struct flashctx *flash, unsigned int addr, const ui
 	return spi_write_cmd(flash, op, native_4ba, addr, bytes, len, 10);
 }
 
+static const struct {
+	const char *name;
+	unsigned int addr_width;	/* lines for address, mode bits and wait states */
+	unsigned int data_width;
+	int chip_feature;
+	uint32_t master_feature;
+	struct spi_fast_read defaults;
+} spi_read_modes[SPI_NUM_READ_MODES] = {
+	[SPI_READ_1_1_1_FAST] = { "fast", 1, 1, FEATURE_DUAL_READ | FEATURE_QUAD_READ | FEATURE_4BA_FAST_READ,
+				  SPI_MASTER_FAST_READ, { JEDEC_READ_FAST, 0, 8 } },
+	[SPI_READ_1_1_2] = { "dual output", 1, 2, FEATURE_DUAL_READ, SPI_MASTER_DUAL_READ,
+			     { JEDEC_READ_DUAL_OUT, 0, 8 } },
+	[SPI_READ_1_2_2] = { "dual I/O", 2, 2, FEATURE_DUAL_READ, SPI_MASTER_DUAL_IO,
+			     { JEDEC_READ_DUAL_IO, 4, 0 } },
+	[SPI_READ_1_1_4] = { "quad output", 1, 4, FEATURE_QUAD_READ, SPI_MASTER_QUAD_READ,
+			     { JEDEC_READ_QUAD_OUT, 0, 8 } },
+	[SPI_READ_1_4_4] = { "quad I/O", 4, 4, FEATURE_QUAD_READ, SPI_MASTER_QUAD_IO,
+			     { JEDEC_READ_QUAD_IO, 2, 4 } },
+};
+
+static const struct spi_fast_read *spi_fast_read_op(const struct flashchip *chip, enum spi_read_mode mode)
+{
+	if (chip->fast_read[mode].opcode)
+		return &chip->fast_read[mode];
+	if (chip->feature_bits & spi_read_modes[mode].chip_feature)
+		return &spi_read_modes[mode].defaults;
+	return NULL;
+}
+
+static bool spi_quad_enabled(const struct flashctx *flash)
+{
+	const struct reg_bit_info *qe = &flash->chip->reg_bits.qe;
+	uint8_t value;
+
+	if (qe->reg == INVALID_REG || spi_read_register(flash, qe->reg, &value))
+		return false;
+	return value & (1 << qe->bit_index);
+}
+
+/* Only the single I/O fast read has a native 4BA variant (0x0c). */
+static bool spi_fast_read_native_4ba(const struct flashctx *flash, enum spi_read_mode mode)
+{
+	return mode == SPI_READ_1_1_1_FAST && flash->chip->feature_bits & FEATURE_4BA_FAST_READ &&
+	       spi_master_4ba(flash);
+}
+
+/*
+ * Selects the fastest read mode that both the chip and the master support.
+ * Quad modes are only used if the QE bit is already set: setting it turns
+ * the WP# and HOLD# pins into data lines, which is not up to flashrom.
+ * Must be called after the 4BA mode was set up.
+ */
+void spi_select_read_mode(struct flashctx *flash)
+{
+	const struct flashchip *chip = flash->chip;
+
+	flash->read_mode = SPI_READ_1_1_1;
+
+	if (chip->read != SPI_CHIP_READ || !(flash->mst->buses_supported & BUS_SPI) ||
+	    !(flash->mst->spi.features & (SPI_MASTER_MULTI_IO | SPI_MASTER_FAST_READ)) ||
+	    chip->feature_bits & FEATURE_ADDR_2BYTE)
+		return;
+
+	for (int mode = SPI_NUM_READ_MODES - 1; mode > SPI_READ_1_1_1; mode--) {
+		const struct spi_fast_read *op = spi_fast_read_op(chip, mode);
+		if (!op || !(flash->mst->spi.features & spi_read_modes[mode].master_feature))
+			continue;
+
+		/* Other than 0x0c, these opcodes take 3-byte addresses unless the chip is in 4BA mode. */
+		if (chip->total_size > 16 * 1024 && !flash->in_4ba_mode &&
+		    !(chip->feature_bits & FEATURE_4BA_EAR_ANY) && !spi_fast_read_native_4ba(flash, mode))
+			continue;
+
+		/* Mode bits and wait states are sent as whole bytes. */
+		const unsigned int wait_bits = (op->mode_clocks + op->dummy_clocks) * spi_read_modes[mode].addr_width;
+		if (wait_bits % 8 || wait_bits / 8 > JEDEC_READ_MAX_WAIT_BYTES)
+			continue;
+		if (spi_read_modes[mode].data_width == 4 && !spi_quad_enabled(flash)) {
+			msg_cdbg("Not using %s reads, the QE bit is not set.\n", spi_read_modes[mode].name);
+			continue;
+		}
+
+		msg_cdbg("Using %s reads (opcode 0x%02x).\n", spi_read_modes[mode].name,
+			 spi_fast_read_native_4ba(flash, mode) ? JEDEC_READ_4BA_FAST : op->opcode);
+		flash->read_mode = mode;
+		return;
+	}
+}
+
+static int spi_fast_read(struct flashctx *flash, unsigned int address, uint8_t *bytes, unsigned int len)
+{
+	const enum spi_read_mode mode = flash->read_mode;
+	const struct spi_fast_read *op = spi_fast_read_op(flash->chip, mode);
+	const unsigned int addr_width = spi_read_modes[mode].addr_width;
+	const bool native_4ba = spi_fast_read_native_4ba(flash, mode);
+	uint8_t cmd[1 + JEDEC_MAX_ADDR_LEN + JEDEC_READ_MAX_WAIT_BYTES] = {
+		native_4ba ? JEDEC_READ_4BA_FAST : op->opcode,
+	};
+
+	const int addr_len = spi_prepare_address(flash, cmd, native_4ba, address);
+	if (addr_len < 0)
+		return 1;
+
+	/* All ones in the mode bits never enter a continuous read (XIP) mode. */
+	const unsigned int wait_len = (op->mode_clocks + op->dummy_clocks) * addr_width / 8;
+	memset(cmd + 1 + addr_len, 0xff, wait_len);
+
+	if (mode == SPI_READ_1_1_1_FAST)
+		return spi_send_command(flash, 1 + addr_len + wait_len, len, cmd, bytes);
+	return spi_send_multi_io_command(flash, addr_width, spi_read_modes[mode].data_width,
+					 1 + addr_len + wait_len, len, cmd, bytes);
+}
+
 int spi_nbyte_read(struct flashctx *flash, unsigned int address, uint8_t *bytes,
 		   unsigned int len)
 {
+	if (flash->read_mode != SPI_READ_1_1_1)
+		return spi_fast_read(flash, address, bytes, len);
+
 	const bool native_4ba = flash->chip->feature_bits & FEATURE_4BA_READ && spi_master_4ba(flash);
 	uint8_t cmd[1 + JEDEC_MAX_ADDR_LEN] = { native_4ba ? JEDEC_READ_4BA : JEDEC_READ, };
 
@@ -805,7 +1086,7 @@ int default_spi_write_aai(struct flashctx *flash, const uint8_t *buf, unsigned i
 			msg_cerr("%s failed during followup AAI command execution: %d\n", __func__, result);
 			goto bailout;
 		}
-		if (spi_poll_wip(flash, 10))
+		if (spi_poll_wip(flash, JEDEC_AAI_WORD_PROGRAM, 10))
 			goto bailout;
 	}
 
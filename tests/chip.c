@@ -78,6 +78,21 @@ static int block_erase_chip(struct flashctx *flash, unsigned int blockaddr, unsi
 	return 0;
 }
 
+/* A cancel request that arrives while the operation fails on its own. */
+static int block_erase_chip_cancel_and_fail(struct flashctx *flash, unsigned int blockaddr, unsigned int blocklen)
+{
+	printf("Block erase called with blockaddr=0x%x, blocklen=0x%x, failing\n", blockaddr, blocklen);
+	flashrom_flash_cancel(flash);
+	return 1;
+}
+
+static int write_chip_cancel_and_fail(struct flashctx *flash, const uint8_t *buf, unsigned int start, unsigned int len)
+{
+	printf("Write chip called with start=0x%x, len=0x%x, failing\n", start, len);
+	flashrom_flash_cancel(flash);
+	return 1;
+}
+
 static int select_die(struct flashctx* flash, unsigned int die_num)
 {
 	printf("Die select called for die #%d.\n", die_num);
@@ -317,6 +332,82 @@ void erase_chip_with_dummyflasher_test_success(void **state)
 	teardown(&flashctx);
 }
 
+void erase_chip_cancelled_with_dummyflasher(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_W25Q128_V;
+	const char *param_dup = "bus=spi,emulate=W25Q128FV";
+
+	setup_chip(&flashctx, &mock_chip, param_dup, NULL);
+
+	/* A read in between neither stops for the request nor clears it. */
+	flashrom_flash_cancel(&flashctx);
+	const size_t size = flashrom_flash_getsize(&flashctx);
+	uint8_t *const buf = malloc(size);
+	assert_non_null(buf);
+	assert_int_equal(0, flashrom_image_read(&flashctx, buf, size));
+	free(buf);
+
+	printf("Erase chip operation with pending cancel request started.\n");
+	assert_int_equal(ERROR_FLASHROM_CANCELLED, flashrom_flash_erase(&flashctx));
+	printf("Erase chip operation cancelled.\n");
+
+	/* The request is cleared once the operation finished, next erase runs through. */
+	assert_int_equal(0, flashrom_flash_erase(&flashctx));
+
+	teardown(&flashctx);
+}
+
+void erase_chip_failed_while_cancelled(void **state)
+{
+	(void) state; /* unused */
+
+	g_test_write_injector = write_chip;
+	g_test_read_injector = read_chip;
+	g_test_erase_injector[0] = block_erase_chip_cancel_and_fail;
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_8MiB;
+	const char *param = ""; /* Default values for all params. */
+
+	setup_chip(&flashctx, &mock_chip, param, NULL);
+
+	/* The erase failed before the request was seen, that is what gets reported. */
+	const int ret = flashrom_flash_erase(&flashctx);
+	assert_int_not_equal(0, ret);
+	assert_int_not_equal(ERROR_FLASHROM_CANCELLED, ret);
+
+	teardown(&flashctx);
+}
+
+void write_chip_failed_while_cancelled(void **state)
+{
+	(void) state; /* unused */
+
+	g_test_write_injector = write_chip_cancel_and_fail;
+	g_test_read_injector = read_chip;
+	g_test_erase_injector[0] = block_erase_chip;
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_8MiB;
+	const char *param = ""; /* Default values for all params. */
+
+	setup_chip(&flashctx, &mock_chip, param, NULL);
+
+	const unsigned long size = mock_chip.total_size * 1024;
+	uint8_t *const newcontents = malloc(size);
+	assert_non_null(newcontents);
+	memset(newcontents, 0x5a, size);
+
+	const int ret = flashrom_image_write(&flashctx, newcontents, size, NULL);
+	assert_int_not_equal(0, ret);
+	assert_int_not_equal(ERROR_FLASHROM_CANCELLED, ret);
+
+	teardown(&flashctx);
+
+	free(newcontents);
+}
+
 void erase_chip_dual_die_c2(void **state)
 {
 	(void) state; /* unused */
@@ -437,6 +528,249 @@ void read_chip_with_dummyflasher_test_success(void **state)
 	free(buf);
 }
 
+void read_chip_multi_io_with_dummyflasher_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	/*
+	 * The emulated programmer refuses plain reads (0x03), so everything has
+	 * to go through the fast or multi-I/O reads. Quad reads need the QE bit
+	 * in SR2.
+	 */
+	const struct {
+		const char *param;
+		enum spi_read_mode read_mode;
+	} cases[] = {
+		{ "bus=spi,emulate=W25Q128FV,spi_blacklist=03", SPI_READ_1_1_1_FAST },
+		{ "bus=spi,emulate=W25Q128FV,multi_io=dual,spi_blacklist=03", SPI_READ_1_2_2 },
+		{ "bus=spi,emulate=W25Q128FV,multi_io=quad,spi_blacklist=03", SPI_READ_1_2_2 },
+		{ "bus=spi,emulate=W25Q128FV,multi_io=quad,spi_status=0x0200,spi_blacklist=03", SPI_READ_1_4_4 },
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		struct flashrom_flashctx flashctx = { 0 };
+		struct flashchip mock_chip = chip_W25Q128_V;
+		mock_chip.feature_bits |= FEATURE_WRSR2 | FEATURE_DUAL_READ | FEATURE_QUAD_READ;
+		mock_chip.reg_bits.qe = (struct reg_bit_info){ STATUS2, 1, RW };
+
+		setup_chip(&flashctx, &mock_chip, cases[i].param, NULL);
+
+		const unsigned long size = mock_chip.total_size * 1024;
+		uint8_t *const newcontents = malloc(size);
+		uint8_t *const buf = malloc(size);
+		assert_non_null(newcontents);
+		assert_non_null(buf);
+		for (unsigned long j = 0; j < size; j++)
+			newcontents[j] = j * 7 + (j >> 16);
+
+		printf("Write and read back with \"%s\" started.\n", cases[i].param);
+		assert_int_equal(0, flashrom_image_write(&flashctx, newcontents, size, NULL));
+		assert_int_equal(0, flashrom_image_read(&flashctx, buf, size));
+		assert_int_equal(cases[i].read_mode, flashctx.read_mode);
+		assert_memory_equal(newcontents, buf, size);
+		printf("Write and read back done.\n");
+
+		teardown(&flashctx);
+
+		free(buf);
+		free(newcontents);
+	}
+}
+
+void read_chip_sfdp_with_dummyflasher_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	/*
+	 * The database entry knows no fast reads. The emulated chip reports
+	 * fast, dual output and quad output reads in its SFDP table.
+	 */
+	const struct {
+		const char *param;
+		bool use_sfdp;
+		enum spi_read_mode read_mode;
+	} cases[] = {
+		{ "bus=spi,emulate=MX25L6436,multi_io=dual", false, SPI_READ_1_1_1 },
+		{ "bus=spi,emulate=MX25L6436", true, SPI_READ_1_1_1_FAST },
+		{ "bus=spi,emulate=MX25L6436,multi_io=dual", true, SPI_READ_1_1_2 },
+	};
+
+	for (size_t i = 0; i < ARRAY_SIZE(cases); i++) {
+		struct flashrom_flashctx flashctx = { 0 };
+		struct flashchip mock_chip = chip_W25Q128_V;
+		mock_chip.bustype = BUS_SPI;
+		mock_chip.total_size = 8 * 1024;
+		mock_chip.block_erasers[0].eraseblocks[0].count = 2048;
+		mock_chip.block_erasers[1].eraseblocks[0].count = 256;
+		mock_chip.block_erasers[2].eraseblocks[0].count = 128;
+		mock_chip.block_erasers[3].eraseblocks[0].size = 8 * 1024 * 1024;
+		mock_chip.block_erasers[4].eraseblocks[0].size = 8 * 1024 * 1024;
+
+		setup_chip(&flashctx, &mock_chip, cases[i].param, NULL);
+		flashrom_flag_set(&flashctx, FLASHROM_FLAG_USE_SFDP, cases[i].use_sfdp);
+
+		const unsigned long size = mock_chip.total_size * 1024;
+		uint8_t *const buf = malloc(size);
+		assert_non_null(buf);
+
+		printf("Read with \"%s\"%s started.\n", cases[i].param, cases[i].use_sfdp ? " and SFDP" : "");
+		assert_int_equal(0, flashrom_image_read(&flashctx, buf, size));
+		assert_int_equal(cases[i].read_mode, flashctx.read_mode);
+		if (cases[i].use_sfdp) {
+			assert_int_equal(0x3b, mock_chip.fast_read[SPI_READ_1_1_2].opcode);
+			assert_int_equal(0x6b, mock_chip.fast_read[SPI_READ_1_1_4].opcode);
+		}
+		printf("Read done.\n");
+
+		teardown(&flashctx);
+
+		free(buf);
+	}
+}
+
+void probe_sfdp_jesd216b_with_dummyflasher_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_W25Q128_V;
+	struct flashchip sfdp_chip = { 0 };
+	const char *param_dup = "bus=spi,emulate=MX25L6436,sfdp=jesd216b";
+
+	setup_chip(&flashctx, &mock_chip, param_dup, NULL);
+
+	/* Probing fills a blank chip from the table, like "SFDP-capable chip". */
+	flashctx.chip = &sfdp_chip;
+	assert_int_equal(1, probe_spi_sfdp(&flashctx));
+	assert_int_equal(32 * 1024, sfdp_chip.total_size);
+
+	/* Double words 10 and 11 */
+	assert_int_equal(256, sfdp_chip.page_size);
+	assert_int_equal(448, sfdp_chip.page_program.typ_us);
+	assert_int_equal(6 * 448, sfdp_chip.page_program.max_us);
+	assert_int_equal(16, sfdp_chip.byte_program.typ_us);
+	assert_int_equal(6 * 16, sfdp_chip.byte_program.max_us);
+
+	/* Double word 15 */
+	assert_int_equal(STATUS2, sfdp_chip.reg_bits.qe.reg);
+	assert_int_equal(1, sfdp_chip.reg_bits.qe.bit_index);
+	assert_true(sfdp_chip.feature_bits & FEATURE_WRSR_EXT2);
+
+	/* Double word 16 has no way to enter 4-byte mode, so the 4-byte instructions are used. */
+	assert_int_equal(0, sfdp_chip.feature_bits & (FEATURE_4BA_ENTER | FEATURE_4BA_ENTER_WREN |
+						      FEATURE_4BA_EAR_ANY));
+	assert_int_equal(FEATURE_4BA_READ | FEATURE_4BA_FAST_READ | FEATURE_4BA_WRITE,
+			 sfdp_chip.feature_bits & (FEATURE_4BA_READ | FEATURE_4BA_FAST_READ | FEATURE_4BA_WRITE));
+
+	/*
+	 * The sector map configuration register reads as 0, which only allows
+	 * the 4 kB and 32 kB erases in the first 128 kB. They are dropped, the
+	 * 64 kB erase becomes its 4-byte variant.
+	 */
+	assert_int_equal(SPI_BLOCK_ERASE_DC, sfdp_chip.block_erasers[0].block_erase);
+	assert_int_equal(64 * KiB, sfdp_chip.block_erasers[0].eraseblocks[0].size);
+	assert_int_equal(512, sfdp_chip.block_erasers[0].eraseblocks[0].count);
+	assert_int_equal(256 * 1000, sfdp_chip.block_erasers[0].timing.typ_us);
+	assert_int_equal(6 * 256 * 1000, sfdp_chip.block_erasers[0].timing.max_us);
+	assert_int_equal(SPI_BLOCK_ERASE_C7, sfdp_chip.block_erasers[1].block_erase);
+	assert_int_equal(32 * MiB, sfdp_chip.block_erasers[1].eraseblocks[0].size);
+	assert_int_equal(64 * 1000 * 1000, sfdp_chip.block_erasers[1].timing.typ_us);
+	assert_int_equal(6 * 64 * 1000 * 1000, sfdp_chip.block_erasers[1].timing.max_us);
+	for (int i = 2; i < NUM_ERASEFUNCTIONS; i++)
+		assert_int_equal(NO_BLOCK_ERASE_FUNC, sfdp_chip.block_erasers[i].block_erase);
+
+	flashctx.chip = &mock_chip;
+	teardown(&flashctx);
+}
+
+void read_unique_id_with_dummyflasher_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_W25Q128_V;
+	const char *param_dup = "bus=spi,emulate=W25Q128FV";
+	uint8_t id[JEDEC_RDUID_INSIZE];
+
+	setup_chip(&flashctx, &mock_chip, param_dup, NULL);
+
+	/* Chips without the feature bit are never asked, 0x4b means something else on other chips. */
+	assert_int_equal(1, spi_read_unique_id(&flashctx, id, sizeof(id)));
+
+	/* Dummyflasher answers RDUID with a made up ID for the emulated W25Q128FV. */
+	mock_chip.feature_bits |= FEATURE_UNIQUE_ID;
+	assert_int_equal(0, spi_read_unique_id(&flashctx, id, sizeof(id)));
+	for (unsigned int i = 0; i < sizeof(id); i++)
+		assert_int_equal(0xd1 + i, id[i]);
+
+	teardown(&flashctx);
+}
+
+void spi_poll_wip_timeout_test(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_W25Q128_V;
+	/* Sector erase polls every 10ms and gives up after 10s. */
+	const char *param_dup = "bus=spi,emulate=W25Q128FV,busy_us=20000000";
+
+	setup_chip(&flashctx, &mock_chip, param_dup, NULL);
+
+	assert_int_not_equal(0, spi_block_erase_20(&flashctx, 0, 4 * KiB));
+	/* A timed out operation must not teach anything. */
+	assert_int_equal(0, spi_wip_busy_time(&flashctx, JEDEC_SE));
+
+	teardown(&flashctx);
+}
+
+void spi_poll_wip_slow_chip_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_W25Q128_V;
+	/* Byte program polls every 10us, far slower chips still have WIP_TIMEOUT_MIN_US. */
+	const char *param_dup = "bus=spi,emulate=W25Q128FV,busy_us=500000";
+	const uint8_t byte = 0x5a;
+
+	setup_chip(&flashctx, &mock_chip, param_dup, NULL);
+
+	assert_int_equal(0, spi_chip_write_1(&flashctx, &byte, 0, 1));
+	assert_int_equal(500000, spi_wip_busy_time(&flashctx, JEDEC_BYTE_PROGRAM));
+
+	teardown(&flashctx);
+}
+
+void spi_poll_wip_busy_time_converges_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_W25Q128_V;
+	const char *param_dup = "bus=spi,emulate=W25Q128FV,busy_us=50000";
+
+	setup_chip(&flashctx, &mock_chip, param_dup, NULL);
+
+	/* Unknown opcodes are polled every poll_delay, which hits the busy time exactly here. */
+	assert_int_equal(0, spi_block_erase_20(&flashctx, 0, 4 * KiB));
+	assert_int_equal(50000, spi_wip_busy_time(&flashctx, JEDEC_SE));
+
+	/* Start over from a much slower and a much faster chip, both settle close to the real time. */
+	const unsigned int stale_busy_us[] = { 400000, 5000 };
+	for (size_t i = 0; i < ARRAY_SIZE(stale_busy_us); i++) {
+		flashctx.wip_timings[0].busy_us = stale_busy_us[i];
+		for (unsigned int j = 0; j < 100; j++)
+			assert_int_equal(0, spi_block_erase_20(&flashctx, 0, 4 * KiB));
+		const unsigned int learned = spi_wip_busy_time(&flashctx, JEDEC_SE);
+		printf("Learned busy time %u us starting from %u us\n", learned, stale_busy_us[i]);
+		assert_true(learned >= 50000 - 50000 / 8);
+		assert_true(learned <= 50000 + 50000 / 8);
+	}
+
+	teardown(&flashctx);
+}
+
 void write_chip_test_success(void **state)
 {
 	(void) state; /* unused */
@@ -683,6 +1017,120 @@ void write_nonaligned_region_with_dummyflasher_test_success(void **state)
 	free(newcontents);
 }
 
+void region_ops_with_dummyflasher_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_W25Q128_V;
+	const char *param_dup = "bus=spi,emulate=W25Q128FV";
+	/* Not aligned to erase blocks and spanning several windows. */
+	const size_t start = 0x1234, len = 0x30000;
+	const size_t check_len = start + len + 0x2000;
+
+	uint8_t *const newcontents = malloc(len);
+	uint8_t *const readback = malloc(check_len);
+	assert_non_null(newcontents);
+	assert_non_null(readback);
+
+	setup_chip(&flashctx, &mock_chip, param_dup, NULL);
+	flashrom_flag_set(&flashctx, FLASHROM_FLAG_VERIFY_AFTER_WRITE, true);
+
+	printf("Region ops with invalid ranges... ");
+	assert_int_equal(2, flashrom_region_read(&flashctx, 0, 0, readback));
+	assert_int_equal(4, flashrom_region_write(&flashctx, mock_chip.total_size * KiB - 1, 2, newcontents));
+	assert_int_equal(2, flashrom_region_verify(&flashctx, mock_chip.total_size * KiB, 1, newcontents));
+	printf("rejected.\n");
+
+	printf("Region write op..\n");
+	memset(newcontents, 0x5a, len);
+	assert_int_equal(0, flashrom_region_write(&flashctx, start, len, newcontents));
+	assert_int_equal(0, flashrom_region_verify(&flashctx, start, len, newcontents));
+
+	/* Overwrite a part that needs an erase, the rest of its block must be preserved. */
+	memset(newcontents, 0xa5, 0x100);
+	assert_int_equal(0, flashrom_region_write(&flashctx, start + 0x2000, 0x100, newcontents));
+	printf("Region write op done.\n");
+
+	assert_int_equal(0, flashrom_region_read(&flashctx, 0, check_len, readback));
+	for (size_t i = 0; i < check_len; i++) {
+		uint8_t expected = 0xff;
+		if (i >= start + 0x2000 && i < start + 0x2100)
+			expected = 0xa5;
+		else if (i >= start && i < start + len)
+			expected = 0x5a;
+		assert_int_equal(expected, readback[i]);
+	}
+	assert_int_equal(3, flashrom_region_verify(&flashctx, start, len, readback));
+
+	teardown(&flashctx);
+
+	free(readback);
+	free(newcontents);
+}
+
+static void one_locked_block_get_region(const struct flashctx *flash, unsigned int addr, struct flash_region *region)
+{
+	/* The second 4 KiB block is protected, the rest of the chip is writable. */
+	region->start = addr < 0x1000 ? 0 : addr < 0x2000 ? 0x1000 : 0x2000;
+	region->end = addr < 0x1000 ? 0xfff : addr < 0x2000 ? 0x1fff : flashrom_flash_getsize(flash) - 1;
+	region->read_prot = false;
+	region->write_prot = region->start == 0x1000;
+	region->name = strdup(region->write_prot ? "locked" : "open");
+}
+
+void region_write_protected_block_with_dummyflasher_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip mock_chip = chip_W25Q128_V;
+	const char *param_dup = "bus=spi,emulate=W25Q128FV";
+	/* Half of a 64 KiB window, the locked block is in it. */
+	const size_t len = 0x8000;
+
+	uint8_t *const newcontents = malloc(len);
+	uint8_t *const readback = malloc(2 * len);
+	assert_non_null(newcontents);
+	assert_non_null(readback);
+
+	setup_chip(&flashctx, &mock_chip, param_dup, NULL);
+	flashrom_flag_set(&flashctx, FLASHROM_FLAG_VERIFY_AFTER_WRITE, true);
+
+	memset(newcontents, 0x5a, len);
+	assert_int_equal(0, flashrom_region_write(&flashctx, 0, len, newcontents));
+	flashctx.mst->spi.get_region = &one_locked_block_get_region;
+
+	printf("Region write next to a protected block..\n");
+	/* Needs an erase of the writable first 4 KiB block only. */
+	memset(newcontents, 0xa5, len);
+	assert_int_equal(0, flashrom_region_write(&flashctx, 0x100, 0x100, newcontents));
+	/* Writing into the protected block fails, unless protected regions are skipped. */
+	assert_int_not_equal(0, flashrom_region_write(&flashctx, 0x1800, 0x10, newcontents));
+	printf("Region write next to a protected block done.\n");
+
+	printf("Region write over a protected block..\n");
+	/* A 32 KiB erase would be cheaper, but it would wipe the protected block. */
+	flashctx.sacrifice_ratio = 50;
+	flashrom_flag_set(&flashctx, FLASHROM_FLAG_SKIP_UNWRITABLE_REGIONS, true);
+	assert_int_equal(0, flashrom_region_write(&flashctx, 0, len, newcontents));
+	printf("Region write over a protected block done.\n");
+
+	assert_int_equal(0, flashrom_region_read(&flashctx, 0, 2 * len, readback));
+	for (size_t i = 0; i < 2 * len; i++) {
+		uint8_t expected = 0xa5;
+		if (i >= len)
+			expected = 0xff;
+		else if (i >= 0x1000 && i < 0x2000)
+			expected = 0x5a;
+		assert_int_equal(expected, readback[i]);
+	}
+
+	teardown(&flashctx);
+	free(readback);
+	free(newcontents);
+}
+
 static size_t verify_chip_fread(void *state, void *buf, size_t size, size_t len, FILE *fp)
 {
 	/*
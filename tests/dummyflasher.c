@@ -94,6 +94,23 @@ void dummy_init_success_unhandled_param_test_success(void **state)
 				"bus=spi,emulate=W25Q128FV,voltage=3.5V", ERROR_FLASHROM_FATAL);
 }
 
+void dummy_init_twice_fails_until_shutdown(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashrom_programmer *flashprog = NULL;
+	const char *param = "bus=spi,emulate=W25Q128FV";
+
+	/* Only one programmer can be initialized at a time. */
+	assert_int_equal(0, flashrom_programmer_init(&flashprog, programmer_dummy.name, param));
+	assert_int_equal(ERROR_FLASHROM_LIMIT, flashrom_programmer_init(&flashprog, programmer_dummy.name, param));
+	assert_int_equal(0, flashrom_programmer_shutdown(flashprog));
+
+	/* After shutdown, the next init succeeds again. */
+	assert_int_equal(0, flashrom_programmer_init(&flashprog, programmer_dummy.name, param));
+	assert_int_equal(0, flashrom_programmer_shutdown(flashprog));
+}
+
 void dummy_null_prog_param_test_success(void **state)
 {
 	run_basic_lifecycle(state, NULL, &programmer_dummy, NULL);
@@ -263,6 +280,7 @@ void dummy_probe_and_read_repeated(void **state)
 	SKIP_TEST(dummy_init_fails_unhandled_param_test_success)
 	SKIP_TEST(dummy_init_success_invalid_param_test_success)
 	SKIP_TEST(dummy_init_success_unhandled_param_test_success)
+	SKIP_TEST(dummy_init_twice_fails_until_shutdown)
 	SKIP_TEST(dummy_null_prog_param_test_success)
 	SKIP_TEST(dummy_all_buses_test_success)
 	SKIP_TEST(dummy_freq_param_init)
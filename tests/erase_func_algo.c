@@ -55,6 +55,8 @@ struct all_state {
 	uint8_t buf[MIN_REAL_CHIP_SIZE]; /* Buffer emulating the memory of the mock chip. */
 	bool was_modified[MIN_REAL_CHIP_SIZE]; /* Which bytes were modified, 0x1 if byte was modified. */
 	bool was_verified[MIN_REAL_CHIP_SIZE]; /* Which bytes were verified, 0x1 if byte was verified. */
+	unsigned int read_count[MIN_REAL_CHIP_SIZE]; /* How many times each byte was read. */
+	unsigned int write_count[MIN_REAL_CHIP_SIZE]; /* How many times each byte was written. */
 	struct erase_invoke eraseblocks_actual[MOCK_CHIP_SIZE]; /* The actual order of eraseblocks invocations. */
 	unsigned int eraseblocks_actual_ind; /* Actual number of eraseblocks invocations. */
 	const struct test_case* current_test_case; /* Currently executed test case. */
@@ -69,6 +71,9 @@ static int read_chip(struct flashctx *flash, uint8_t *buf, unsigned int start, u
 
 	memcpy(buf, &g_state.buf[start], len);
 
+	for (unsigned int i = start; i < start + len; i++)
+		g_state.read_count[i]++;
+
 	/* If these bytes were modified before => current read op is verify op, track it */
 	bool bytes_modified = false;
 	for (unsigned int i = start; i < start + len; i++)
@@ -91,6 +96,9 @@ static int write_chip(struct flashctx *flash, const uint8_t *buf, unsigned int s
 
 	memcpy(&g_state.buf[start], buf, len);
 
+	for (unsigned int i = start; i < start + len; i++)
+		g_state.write_count[i]++;
+
 	/* Track the bytes were written */
 	memset(&g_state.was_modified[start], true, len);
 	/* Clear the records of previous verification, if there were any */
@@ -207,6 +215,27 @@ static struct flashchip chip_8_16 = {
 	},
 };
 
+/* Same as chip_8_16 with the erasers in the wrong order, create_erase_layout() must refuse it. */
+static struct flashchip chip_16_8 = {
+	.vendor		= "aklm",
+	/* See comment on previous chip. */
+	.total_size	= 1,
+	.tested		= TEST_OK_PREW,
+	.gran		= WRITE_GRAN_1BYTE,
+	.read		= TEST_READ_INJECTOR,
+	.write		= TEST_WRITE_INJECTOR,
+	.block_erasers	=
+	{
+		{
+			.eraseblocks = { {16, MIN_REAL_CHIP_SIZE / 16} },
+			.block_erase = TEST_ERASE_INJECTOR_5,
+		}, {
+			.eraseblocks = { {8, MIN_REAL_CHIP_SIZE / 8} },
+			.block_erase = TEST_ERASE_INJECTOR_4,
+		}
+	},
+};
+
 static struct flashchip chip_1_4_16 = {
 	.vendor		= "aklm",
 	/* See comment on previous chip. */
@@ -277,6 +306,9 @@ static chipoff_t setup_chip(struct flashrom_flashctx *flashctx, struct flashrom_
 	memset(g_state.was_modified, false, MIN_REAL_CHIP_SIZE);
 	/* Clear the tracking of each byte verified. */
 	memset(g_state.was_verified, false, MIN_REAL_CHIP_SIZE);
+	/* Clear the read and write counters. */
+	memset(g_state.read_count, 0, sizeof(g_state.read_count));
+	memset(g_state.write_count, 0, sizeof(g_state.write_count));
 
 	/* Set the flag to verify after writing on chip */
 	flashrom_flag_set(flashctx, FLASHROM_FLAG_VERIFY_AFTER_WRITE, true);
@@ -337,6 +369,7 @@ static void teardown_chip(struct flashrom_layout **layout)
  * First half of test cases is set up for a chip with erasers: 1, 2, 4, 8, 16 bytes.
  * Second half repeates the same test cases for a chip with erasers: 1, 8, 16 bytes.
  * Tests from #16 onwards use the chip with erasers: 8, 16 bytes, to test unaligned layout regions.
+ * Test #20 uses the chip with erasers: 1, 4, 16 bytes, test #21 is back to 8, 16 bytes.
  */
 static struct test_case test_cases[] = {
 	{
@@ -963,6 +996,34 @@ static struct test_case test_cases[] = {
 		.write_eraseblocks_expected_ind = 10,
 		.erase_test_name = "Erase test case #20",
 		.write_test_name = "Write test case #20",
+	}, {
+		/*
+		 * Test case #21
+		 *
+		 * Initial vs written: 8d+8d, the first block only needs programming (erased
+		 * before, bits are only cleared), the second block only needs erasing (written
+		 * contents are the erased value).
+		 * Layout with one region covering the whole chip.
+		 * Chip with eraseblocks 8, 16.
+		 */
+		.chip =		&chip_8_16,
+		.regions =	{{0, MOCK_CHIP_SIZE - 1, "whole chip"}},
+		.initial_buf =	{ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE,
+					ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE,
+				 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0},
+		.erased_buf =	{ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE,
+					ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE,
+					ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE,
+					ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE},
+		.written_buf =	{0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+				 ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE,
+					ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE},
+		.eraseblocks_expected = {{0x0, 0x10, TEST_ERASE_INJECTOR_5}},
+		.eraseblocks_expected_ind = 1,
+		.write_eraseblocks_expected = {{0x8, 0x8, TEST_ERASE_INJECTOR_4}},
+		.write_eraseblocks_expected_ind = 1,
+		.erase_test_name = "Erase test case #21",
+		.write_test_name = "Write test case #21",
 	},
 };
 
@@ -1188,6 +1249,14 @@ static void test_write_with_sacrifice_ratio50(void **);
 static void erase_unwritable_regions_skipflag_on_test_success(void **);
 static void write_unwritable_regions_skipflag_on_test_success(void **);
 static void test_erase_with_noverify(void **);
+static void test_write_with_verify_changed(void **);
+static void test_write_with_time_optimal_erase(void **);
+static void test_write_program_only_and_erase_only_blocks(void **);
+static void test_erase_fails_for_unsorted_erasers(void **);
+static void test_write_minimal_preread_across_access_regions(void **);
+static void test_write_minimal_preread_unsampled_data(void **);
+static void test_write_verify_reads_region(void **);
+static void test_write_verify_reads_whole_chip(void **);
 
 /*
  * Creates the array of tests for each test case in test_cases_protected_region[].
@@ -1195,7 +1264,7 @@ static void test_erase_with_noverify(void **);
  */
 struct CMUnitTest *get_erase_protected_region_algo_tests(size_t *num_tests) {
 	const size_t num_parameterized = ARRAY_SIZE(test_cases_protected_region);
-	const size_t num_unparameterized = 3;
+	const size_t num_unparameterized = 11;
 	// Twice the number of parameterized test cases, because each test case is run twice:
 	// for erase and write.
 	const size_t num_cases = num_parameterized * 2 + num_unparameterized;
@@ -1235,6 +1304,38 @@ struct CMUnitTest *get_erase_protected_region_algo_tests(size_t *num_tests) {
 				.name = "erase with noverify",
 				.test_func = test_erase_with_noverify,
 			},
+			(const struct CMUnitTest) {
+				.name = "write with verify changed",
+				.test_func = test_write_with_verify_changed,
+			},
+			(const struct CMUnitTest) {
+				.name = "write with time optimal erase",
+				.test_func = test_write_with_time_optimal_erase,
+			},
+			(const struct CMUnitTest) {
+				.name = "write program-only and erase-only blocks",
+				.test_func = test_write_program_only_and_erase_only_blocks,
+			},
+			(const struct CMUnitTest) {
+				.name = "erase failure for unsorted erasers",
+				.test_func = test_erase_fails_for_unsorted_erasers,
+			},
+			(const struct CMUnitTest) {
+				.name = "write with minimal preread across access regions",
+				.test_func = test_write_minimal_preread_across_access_regions,
+			},
+			(const struct CMUnitTest) {
+				.name = "write with minimal preread and unsampled data",
+				.test_func = test_write_minimal_preread_unsampled_data,
+			},
+			(const struct CMUnitTest) {
+				.name = "write with verify, reads per block",
+				.test_func = test_write_verify_reads_region,
+			},
+			(const struct CMUnitTest) {
+				.name = "write with whole chip verify, reads per block",
+				.test_func = test_write_verify_reads_whole_chip,
+			},
 		},
 		sizeof(*all_cases) * num_unparameterized
 	);
@@ -1857,3 +1958,479 @@ static void test_erase_with_noverify(void **state)
 
 	assert_int_equal(0, all_erase_tests_result);
 }
+
+static void test_write_with_verify_changed(void **state)
+{
+	/* Any test case which modifies the chip will do, we want to test that every
+	 * modified byte is still verified when only changed blocks are verified. */
+	struct test_case* current_test_case = &test_cases[20];
+
+	int all_write_test_result = 0;
+	struct flashrom_flashctx flashctx = { 0 };
+	uint8_t newcontents[MIN_BUF_SIZE];
+	const char *param = ""; /* Default values for all params. */
+
+	struct flashrom_layout *layout;
+
+	const chipoff_t verify_end_boundary = setup_chip(&flashctx, &layout, param, current_test_case);
+	memcpy(&newcontents, current_test_case->written_buf, MOCK_CHIP_SIZE);
+
+	flashrom_flag_set(&flashctx, FLASHROM_FLAG_VERIFY_CHANGED, true);
+
+	/* Verifying only the changed blocks conflicts with verifying the whole chip. */
+	flashrom_flag_set(&flashctx, FLASHROM_FLAG_VERIFY_WHOLE_CHIP, true);
+	assert_int_equal(1, flashrom_image_write(&flashctx, &newcontents, MIN_BUF_SIZE, NULL));
+	assert_int_equal(0, g_state.eraseblocks_actual_ind);
+	flashrom_flag_set(&flashctx, FLASHROM_FLAG_VERIFY_WHOLE_CHIP, false);
+
+	printf("%s started.\n", __func__);
+	int ret = flashrom_image_write(&flashctx, &newcontents, MIN_BUF_SIZE, NULL);
+	printf("%s returned %d.\n", __func__, ret);
+
+	int chip_written = !memcmp(g_state.buf, current_test_case->written_buf, MOCK_CHIP_SIZE);
+
+	int eraseblocks_in_order = !memcmp(g_state.eraseblocks_actual,
+					current_test_case->write_eraseblocks_expected,
+					current_test_case->write_eraseblocks_expected_ind * sizeof(struct erase_invoke));
+
+	int eraseblocks_invocations = (g_state.eraseblocks_actual_ind ==
+					current_test_case->write_eraseblocks_expected_ind);
+
+	int chip_verified = 1;
+	for (unsigned int i = 0; i <= verify_end_boundary; i++)
+		if (g_state.was_modified[i] && !g_state.was_verified[i]) {
+			chip_verified = 0; /* the byte was modified, but not verified after */
+			printf("Error: byte 0x%x, modified: %d, verified: %d\n", i, g_state.was_modified[i], g_state.was_verified[i]);
+		}
+
+	/*
+	 * Apart from the pre-read, unmodified bytes are only read by the spot checks, at most 8
+	 * blocks of the 1 byte eraser. The layout covers the whole chip, so there are enough.
+	 */
+	unsigned int spot_checked = 0;
+	for (unsigned int i = 0; i < MIN_REAL_CHIP_SIZE; i++)
+		if (!g_state.was_modified[i] && g_state.read_count[i] > 1)
+			spot_checked++;
+	int only_spot_checks = spot_checked > 0 && spot_checked <= 8;
+	if (!only_spot_checks)
+		printf("Error: %u unmodified bytes were read back\n", spot_checked);
+
+	if (chip_written)
+		printf("Written chip memory state for %s is CORRECT\n", __func__);
+	else
+		printf("Written chip memory state for %s is WRONG\n", __func__);
+
+	if (eraseblocks_in_order)
+		printf("Eraseblocks order of invocation for %s is CORRECT\n", __func__);
+	else
+		printf("Eraseblocks order of invocation for %s is WRONG\n", __func__);
+
+	if (eraseblocks_invocations)
+		printf("Eraseblocks number of invocations for %s is CORRECT\n", __func__);
+	else
+		printf("Eraseblocks number of invocations for %s is WRONG, expected %d actual %d\n",
+			__func__,
+			current_test_case->write_eraseblocks_expected_ind,
+			g_state.eraseblocks_actual_ind);
+
+	if (chip_verified)
+		printf("Written chip memory state for %s was verified successfully\n", __func__);
+	else
+		printf("Written chip memory state for %s was NOT verified completely\n", __func__);
+
+	all_write_test_result |= ret;
+	all_write_test_result |= !chip_written;
+	all_write_test_result |= !eraseblocks_in_order;
+	all_write_test_result |= !eraseblocks_invocations;
+	all_write_test_result |= !chip_verified;
+	all_write_test_result |= !only_spot_checks;
+
+	teardown_chip(&layout);
+
+	assert_int_equal(0, all_write_test_result);
+}
+
+/*
+ * Writes test case #20 on `chip` with FLASHROM_FLAG_TIME_OPTIMAL_ERASE and checks the chosen
+ * erase blocks against the expectations.
+ */
+static int write_with_time_optimal_erase(struct flashchip *chip,
+					 const struct erase_invoke *eraseblocks_expected,
+					 unsigned int eraseblocks_expected_ind)
+{
+	struct test_case* current_test_case = &test_cases[20];
+
+	int all_write_test_result = 0;
+	struct flashrom_flashctx flashctx = { 0 };
+	uint8_t newcontents[MIN_BUF_SIZE];
+	const char *param = ""; /* Default values for all params. */
+
+	struct flashrom_layout *layout;
+
+	const chipoff_t verify_end_boundary = setup_chip(&flashctx, &layout, param, current_test_case);
+	flashctx.chip = chip;
+	memcpy(&newcontents, current_test_case->written_buf, MOCK_CHIP_SIZE);
+
+	flashrom_flag_set(&flashctx, FLASHROM_FLAG_TIME_OPTIMAL_ERASE, true);
+
+	printf("%s started.\n", __func__);
+	int ret = flashrom_image_write(&flashctx, &newcontents, MIN_BUF_SIZE, NULL);
+	printf("%s returned %d.\n", __func__, ret);
+
+	int chip_written = !memcmp(g_state.buf, current_test_case->written_buf, MOCK_CHIP_SIZE);
+
+	int eraseblocks_in_order = !memcmp(g_state.eraseblocks_actual, eraseblocks_expected,
+						eraseblocks_expected_ind * sizeof(struct erase_invoke));
+
+	int eraseblocks_invocations = (g_state.eraseblocks_actual_ind == eraseblocks_expected_ind);
+
+	int chip_verified = 1;
+	for (unsigned int i = 0; i <= verify_end_boundary; i++)
+		if (g_state.was_modified[i] && !g_state.was_verified[i]) {
+			chip_verified = 0; /* the byte was modified, but not verified after */
+			printf("Error: byte 0x%x, modified: %d, verified: %d\n", i, g_state.was_modified[i], g_state.was_verified[i]);
+		}
+
+	if (chip_written)
+		printf("Written chip memory state for %s is CORRECT\n", __func__);
+	else
+		printf("Written chip memory state for %s is WRONG\n", __func__);
+
+	if (eraseblocks_in_order)
+		printf("Eraseblocks order of invocation for %s is CORRECT\n", __func__);
+	else
+		printf("Eraseblocks order of invocation for %s is WRONG\n", __func__);
+
+	if (eraseblocks_invocations)
+		printf("Eraseblocks number of invocations for %s is CORRECT\n", __func__);
+	else
+		printf("Eraseblocks number of invocations for %s is WRONG, expected %d actual %d\n",
+			__func__,
+			eraseblocks_expected_ind,
+			g_state.eraseblocks_actual_ind);
+
+	if (chip_verified)
+		printf("Written chip memory state for %s was verified successfully\n", __func__);
+	else
+		printf("Written chip memory state for %s was NOT verified completely\n", __func__);
+
+	all_write_test_result |= ret;
+	all_write_test_result |= !chip_written;
+	all_write_test_result |= !eraseblocks_in_order;
+	all_write_test_result |= !eraseblocks_invocations;
+	all_write_test_result |= !chip_verified;
+
+	teardown_chip(&layout);
+
+	return all_write_test_result;
+}
+
+static void test_write_with_time_optimal_erase(void **state)
+{
+	struct flashchip chip = chip_1_4_16;
+
+	/*
+	 * Without known erase times the per-command time of the default cost model dominates,
+	 * erasing the whole area with the largest eraser in one go is the fastest option.
+	 */
+	const struct erase_invoke larger_expected[] = {
+		{0x0, 0x10, TEST_ERASE_INJECTOR_5},
+	};
+	assert_int_equal(0, write_with_time_optimal_erase(&chip, larger_expected, ARRAY_SIZE(larger_expected)));
+
+	/*
+	 * With a slow 16 byte eraser, the dirty 4 byte blocks are erased on their own. The last
+	 * 4 byte block has a single dirty byte, erasing it alone beats erasing and reprogramming
+	 * the unchanged bytes next to it.
+	 */
+	chip.block_erasers[0].timing.typ_us = 100;
+	chip.block_erasers[1].timing.typ_us = 150;
+	chip.block_erasers[2].timing.typ_us = 100000;
+	const struct erase_invoke smaller_expected[] = {
+		{0xf, 0x1, TEST_ERASE_INJECTOR_1},
+		{0x0, 0x4, TEST_ERASE_INJECTOR_3},
+		{0x4, 0x4, TEST_ERASE_INJECTOR_3},
+		{0x8, 0x4, TEST_ERASE_INJECTOR_3},
+	};
+	assert_int_equal(0, write_with_time_optimal_erase(&chip, smaller_expected, ARRAY_SIZE(smaller_expected)));
+}
+
+static void test_write_program_only_and_erase_only_blocks(void **state)
+{
+	/* The first block only needs programming, the second one only needs erasing. */
+	struct test_case* current_test_case = &test_cases[21];
+
+	int all_write_test_result = 0;
+	struct flashrom_flashctx flashctx = { 0 };
+	uint8_t newcontents[MIN_BUF_SIZE];
+	const char *param = ""; /* Default values for all params. */
+
+	struct flashrom_layout *layout;
+
+	setup_chip(&flashctx, &layout, param, current_test_case);
+	memcpy(&newcontents, current_test_case->written_buf, MOCK_CHIP_SIZE);
+
+	printf("%s started.\n", __func__);
+	int ret = flashrom_image_write(&flashctx, &newcontents, MIN_BUF_SIZE, NULL);
+	printf("%s returned %d.\n", __func__, ret);
+
+	int chip_written = !memcmp(g_state.buf, current_test_case->written_buf, MOCK_CHIP_SIZE);
+
+	/* Only the second block is erased, the first one keeps its erased state. */
+	int eraseblocks_correct = g_state.eraseblocks_actual_ind == 1 &&
+		!memcmp(g_state.eraseblocks_actual, current_test_case->write_eraseblocks_expected,
+			sizeof(struct erase_invoke));
+
+	/* The first block is programmed once, the second one is left at the erased value. */
+	int writes_correct = 1;
+	for (unsigned int i = 0; i < MOCK_CHIP_SIZE; i++) {
+		const unsigned int expected = i < 8 ? 1 : 0;
+		if (g_state.write_count[i] != expected) {
+			writes_correct = 0;
+			printf("Error: byte 0x%x written %u times, expected %u\n",
+				i, g_state.write_count[i], expected);
+		}
+	}
+
+	if (chip_written)
+		printf("Written chip memory state for %s is CORRECT\n", __func__);
+	else
+		printf("Written chip memory state for %s is WRONG\n", __func__);
+
+	if (eraseblocks_correct)
+		printf("Eraseblocks invocations for %s are CORRECT\n", __func__);
+	else
+		printf("Eraseblocks invocations for %s are WRONG, actual %d\n",
+			__func__, g_state.eraseblocks_actual_ind);
+
+	if (writes_correct)
+		printf("Written blocks for %s are CORRECT\n", __func__);
+	else
+		printf("Written blocks for %s are WRONG\n", __func__);
+
+	all_write_test_result |= ret;
+	all_write_test_result |= !chip_written;
+	all_write_test_result |= !eraseblocks_correct;
+	all_write_test_result |= !writes_correct;
+
+	teardown_chip(&layout);
+
+	assert_int_equal(0, all_write_test_result);
+}
+
+static void test_erase_fails_for_unsorted_erasers(void **state)
+{
+	struct test_case* current_test_case = &test_cases[21];
+	struct flashrom_flashctx flashctx = { 0 };
+	const char *param = ""; /* Default values for all params. */
+
+	struct flashrom_layout *layout;
+
+	setup_chip(&flashctx, &layout, param, current_test_case);
+	flashctx.chip = &chip_16_8;
+
+	printf("%s started.\n", __func__);
+	int ret = flashrom_flash_erase(&flashctx);
+	printf("%s returned %d.\n", __func__, ret);
+
+	teardown_chip(&layout);
+
+	/* The erase layout is refused, nothing must have been erased. */
+	assert_int_not_equal(0, ret);
+	assert_int_equal(0, g_state.eraseblocks_actual_ind);
+	assert_int_equal(0, memcmp(g_state.buf, current_test_case->initial_buf, MOCK_CHIP_SIZE));
+}
+
+#define SPLIT_ACCESS_REGION 6
+
+/* Two writable access regions, the first block of chip_8_16 crosses the boundary between them. */
+static void get_split_region(const struct flashctx *flash, unsigned int addr, struct flash_region *region)
+{
+	if (addr < SPLIT_ACCESS_REGION) {
+		region->name		= strdup("head");
+		region->start		= 0;
+		region->end		= SPLIT_ACCESS_REGION - 1;
+	} else {
+		region->name		= strdup("tail");
+		region->start		= SPLIT_ACCESS_REGION;
+		region->end		= flashrom_flash_getsize(flash) - 1;
+	}
+	region->read_prot	= false;
+	region->write_prot	= false;
+}
+
+/*
+ * Writes written_buf of the test case with FLASHROM_FLAG_MINIMAL_PREREAD set on chip_8_16
+ * with 2 byte pages, so only the first 2 bytes of each 8 byte block are sampled.
+ */
+static int write_with_minimal_preread(struct test_case *current_test_case, bool split_regions)
+{
+	struct flashrom_flashctx flashctx = { 0 };
+	struct flashchip chip = chip_8_16;
+	uint8_t newcontents[MIN_BUF_SIZE];
+	const char *param = ""; /* Default values for all params. */
+
+	struct flashrom_layout *layout;
+
+	chip.page_size = 2;
+	setup_chip(&flashctx, &layout, param, current_test_case);
+	flashctx.chip = &chip;
+	memcpy(&newcontents, current_test_case->written_buf, MOCK_CHIP_SIZE);
+	memset(newcontents + MOCK_CHIP_SIZE, ERASE_VALUE, MIN_BUF_SIZE - MOCK_CHIP_SIZE);
+
+	flashrom_flag_set(&flashctx, FLASHROM_FLAG_MINIMAL_PREREAD, true);
+	if (split_regions) {
+		/* Dummyflasher registers multiple masters, see erase_unwritable_regions_skipflag_on_test_success(). */
+		flashctx.mst->spi.get_region = &get_split_region;
+		flashctx.mst->opaque.get_region = &get_split_region;
+	}
+
+	printf("%s started.\n", __func__);
+	int ret = flashrom_image_write(&flashctx, &newcontents, MIN_BUF_SIZE, NULL);
+	printf("%s returned %d.\n", __func__, ret);
+
+	teardown_chip(&layout);
+
+	return ret;
+}
+
+static void test_write_minimal_preread_across_access_regions(void **state)
+{
+	/*
+	 * The first page of block 0x0..0x7 needs an erase, the rest of the block is unchanged
+	 * data. The block crosses an access region boundary, so it is never erased and its
+	 * unchanged bytes must be read instead of being assumed erased, or they are rewritten.
+	 */
+	struct test_case current_test_case = {
+		.chip =		&chip_8_16,
+		.regions =	{{0, MOCK_CHIP_SIZE - 1, "whole chip"}},
+		.initial_buf =	{0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+				 ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE,
+					ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE},
+		.written_buf =	{0x11, 0x11, 0x0, 0x0, 0x0, 0x0, 0x0, 0x0,
+				 ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE,
+					ERASE_VALUE, ERASE_VALUE, ERASE_VALUE, ERASE_VALUE},
+	};
+
+	assert_int_equal(0, write_with_minimal_preread(&current_test_case, true));
+
+	assert_int_equal(0, memcmp(g_state.buf, current_test_case.written_buf, MOCK_CHIP_SIZE));
+	assert_int_equal(0, g_state.eraseblocks_actual_ind);
+	for (unsigned int i = 0; i < MOCK_CHIP_SIZE; i++)
+		assert_int_equal(i < 2 ? 1 : 0, g_state.write_count[i]);
+}
+
+static void test_write_minimal_preread_unsampled_data(void **state)
+{
+	/*
+	 * The first page of block 0x0..0x7 needs an erase, the rest of the block holds data that
+	 * is not read before the erase. It must still be programmed back from the new contents.
+	 * Block 0x8..0x0f doesn't need an erase and is read in full.
+	 */
+	struct test_case current_test_case = {
+		.chip =		&chip_8_16,
+		.regions =	{{0, MOCK_CHIP_SIZE - 1, "whole chip"}},
+		.initial_buf =	{0x0, 0x0, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22,
+				 ERASE_VALUE, ERASE_VALUE, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33},
+		.written_buf =	{0x11, 0x11, 0x22, 0x22, 0x22, 0x22, 0x22, 0x22,
+				 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33, 0x33},
+	};
+	const struct erase_invoke eraseblocks_expected = {0x0, 0x8, TEST_ERASE_INJECTOR_4};
+
+	assert_int_equal(0, write_with_minimal_preread(&current_test_case, false));
+
+	assert_int_equal(0, memcmp(g_state.buf, current_test_case.written_buf, MOCK_CHIP_SIZE));
+	assert_int_equal(1, g_state.eraseblocks_actual_ind);
+	assert_int_equal(0, memcmp(g_state.eraseblocks_actual, &eraseblocks_expected, sizeof(eraseblocks_expected)));
+	for (unsigned int i = 0; i < 8; i++)
+		assert_int_equal(1, g_state.write_count[i]);
+	/* Only the verify reads back the unsampled bytes, the preread reads the whole second block. */
+	for (unsigned int i = 2; i < 8; i++)
+		assert_int_equal(1, g_state.read_count[i]);
+	for (unsigned int i = 8; i < MOCK_CHIP_SIZE; i++)
+		assert_true(g_state.read_count[i] >= 1);
+}
+
+/*
+ * Writes the test case with verification and returns in `reads` how often each byte of the
+ * mock chip was read during the whole operation, including the pre-read.
+ */
+static void write_and_count_verify_reads(struct test_case *current_test_case, bool whole_chip,
+					 unsigned int reads[MOCK_CHIP_SIZE])
+{
+	struct flashrom_flashctx flashctx = { 0 };
+	uint8_t newcontents[MIN_BUF_SIZE];
+	const char *param = ""; /* Default values for all params. */
+
+	struct flashrom_layout *layout;
+
+	setup_chip(&flashctx, &layout, param, current_test_case);
+	memcpy(&newcontents, current_test_case->written_buf, MOCK_CHIP_SIZE);
+	memset(newcontents + MOCK_CHIP_SIZE, ERASE_VALUE, MIN_BUF_SIZE - MOCK_CHIP_SIZE);
+
+	flashrom_flag_set(&flashctx, FLASHROM_FLAG_VERIFY_WHOLE_CHIP, whole_chip);
+	/* The whole chip verification uses the default layout, normally created while probing. */
+	assert_int_equal(0, flashrom_layout_new(&flashctx.default_layout));
+	assert_int_equal(0, flashrom_layout_add_region(flashctx.default_layout, 0, MIN_REAL_CHIP_SIZE - 1, "chip"));
+	assert_int_equal(0, flashrom_layout_include_region(flashctx.default_layout, "chip"));
+
+	printf("%s started.\n", __func__);
+	int ret = flashrom_image_write(&flashctx, &newcontents, MIN_BUF_SIZE, NULL);
+	printf("%s returned %d.\n", __func__, ret);
+	assert_int_equal(0, ret);
+	assert_int_equal(0, memcmp(g_state.buf, current_test_case->written_buf, MOCK_CHIP_SIZE));
+
+	memcpy(reads, g_state.read_count, MOCK_CHIP_SIZE * sizeof(*reads));
+
+	flashrom_layout_release(flashctx.default_layout);
+	teardown_chip(&layout);
+}
+
+static void test_write_verify_reads_region(void **state)
+{
+	unsigned int reads[MOCK_CHIP_SIZE];
+
+	/*
+	 * Regions cover the chip, every block is covered by the verification. Each byte is read
+	 * once before the write and once after it, either by the erase check of a block that
+	 * stays erased or by the verification, never by both.
+	 */
+	const unsigned int reads_covered[MOCK_CHIP_SIZE] = {
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	};
+	write_and_count_verify_reads(&test_cases[20], false, reads);
+	assert_int_equal(0, memcmp(reads, reads_covered, sizeof(reads)));
+
+	/*
+	 * Region 0x0..0x2 inside block 0x0..0x7. The block isn't covered by the verification, the
+	 * erase check reads all of it. 0x3..0x7 are read before the erase to restore them, and
+	 * are not verified. 0x0..0x2 are pre-read, erase checked and verified.
+	 */
+	const unsigned int reads_partial[MOCK_CHIP_SIZE] = {
+		3, 3, 3, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+	};
+	write_and_count_verify_reads(&test_cases[19], false, reads);
+	assert_int_equal(0, memcmp(reads, reads_partial, sizeof(reads)));
+}
+
+static void test_write_verify_reads_whole_chip(void **state)
+{
+	unsigned int reads[MOCK_CHIP_SIZE];
+
+	/* The whole chip is read once before the write and verified once after it. */
+	const unsigned int reads_covered[MOCK_CHIP_SIZE] = {
+		2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	};
+	write_and_count_verify_reads(&test_cases[20], true, reads);
+	assert_int_equal(0, memcmp(reads, reads_covered, sizeof(reads)));
+
+	/*
+	 * With region 0x0..0x2 the whole chip is still covered by the verification, so block
+	 * 0x0..0x7 is not erase checked. 0x3..0x7 are read once more to restore them.
+	 */
+	const unsigned int reads_partial[MOCK_CHIP_SIZE] = {
+		2, 2, 2, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+	};
+	write_and_count_verify_reads(&test_cases[19], true, reads);
+	assert_int_equal(0, memcmp(reads, reads_partial, sizeof(reads)));
+}
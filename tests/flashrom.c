@@ -6,6 +6,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <include/test.h>
 #include "tests.h"
@@ -62,3 +63,188 @@ void flashbuses_to_text_test_success(void **state)
 	text = flashbuses_to_text(bustype);
 	assert_equal_and_free(text, "None");
 }
+
+void need_erase_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	uint8_t have[100], want[100];
+
+	memset(have, 0xff, sizeof(have));
+	memset(want, 0x5a, sizeof(want));
+	/* Programming an erased area never requires an erase. */
+	assert_int_equal(0, need_erase(have, want, sizeof(have), WRITE_GRAN_1BIT, 0xff));
+	assert_int_equal(0, need_erase(have, want, sizeof(have), WRITE_GRAN_1BYTE, 0xff));
+
+	/* A single 0->1 transition at the tail only needs an erase for bitwise granularity. */
+	memcpy(have, want, sizeof(have));
+	have[97] = 0xff;
+	want[97] = 0x7f;
+	assert_int_equal(0, need_erase(have, want, sizeof(have), WRITE_GRAN_1BIT, 0xff));
+	have[97] = 0x3f;
+	assert_int_equal(1, need_erase(have, want, sizeof(have), WRITE_GRAN_1BIT, 0xff));
+	assert_int_equal(1, need_erase(have, want, sizeof(have), WRITE_GRAN_1BYTE, 0xff));
+
+	/* Changing a programmed byte needs an erase, rewriting it with itself does not. */
+	memcpy(have, want, sizeof(have));
+	assert_int_equal(0, need_erase(have, want, sizeof(have), WRITE_GRAN_1BYTE, 0xff));
+	want[33] = 0x00;
+	assert_int_equal(1, need_erase(have, want, sizeof(have), WRITE_GRAN_1BYTE, 0xff));
+	assert_int_equal(0, need_erase(have, want, sizeof(have), WRITE_GRAN_1BIT, 0xff));
+
+	/* Chunked granularity: a differing chunk must be fully erased. */
+	uint8_t have_gran[512], want_gran[512];
+	memset(have_gran, 0xff, sizeof(have_gran));
+	memset(want_gran, 0xff, sizeof(want_gran));
+	have_gran[300] = 0x00;
+	assert_int_equal(0, need_erase(have_gran, have_gran, sizeof(have_gran), WRITE_GRAN_256BYTES, 0xff));
+	assert_int_equal(1, need_erase(have_gran, want_gran, sizeof(have_gran), WRITE_GRAN_256BYTES, 0xff));
+	want_gran[10] = 0x00;
+	have_gran[300] = 0xff;
+	assert_int_equal(0, need_erase(have_gran, want_gran, sizeof(have_gran), WRITE_GRAN_256BYTES, 0xff));
+}
+
+void get_next_write_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	uint8_t have[1024], want[1024];
+	unsigned int start, len;
+
+	memset(have, 0xff, sizeof(have));
+	memcpy(want, have, sizeof(want));
+
+	start = 0;
+	assert_int_equal(0, get_next_write(have, want, sizeof(have), &start, WRITE_GRAN_1BYTE));
+
+	/* Bytewise granularity returns the exact differing run. */
+	memset(want + 37, 0x00, 50);
+	memset(want + 500, 0x00, 3);
+	start = 0;
+	len = get_next_write(have, want, sizeof(have), &start, WRITE_GRAN_1BYTE);
+	assert_int_equal(37, start);
+	assert_int_equal(50, len);
+	start += len;
+	len = get_next_write(have + start, want + start, sizeof(have) - start, &start, WRITE_GRAN_1BYTE);
+	assert_int_equal(500, start);
+	assert_int_equal(3, len);
+	start += len;
+	len = get_next_write(have + start, want + start, sizeof(have) - start, &start, WRITE_GRAN_1BYTE);
+	assert_int_equal(0, len);
+
+	/* A run reaching the end of the range is returned up to the end. */
+	memcpy(want, have, sizeof(want));
+	want[sizeof(want) - 1] = 0x00;
+	start = 0;
+	len = get_next_write(have, want, sizeof(have), &start, WRITE_GRAN_1BIT);
+	assert_int_equal(sizeof(want) - 1, start);
+	assert_int_equal(1, len);
+
+	/* Chunked granularity rounds the run to whole chunks. */
+	memcpy(want, have, sizeof(want));
+	want[300] = 0x00;
+	want[520] = 0x00;
+	start = 0;
+	len = get_next_write(have, want, sizeof(have), &start, WRITE_GRAN_256BYTES);
+	assert_int_equal(256, start);
+	assert_int_equal(512, len);
+}
+
+void get_next_write_burst_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashchip chip = {
+		.bustype = BUS_SPI,
+		.page_size = 256,
+		.gran = WRITE_GRAN_1BIT,
+		.write = SPI_CHIP_WRITE256,
+	};
+	struct registered_master mst = {
+		.buses_supported = BUS_SPI,
+		.spi.max_data_write = 64,
+	};
+	struct flashctx flash = { .chip = &chip, .mst = &mst };
+	uint8_t have[1024], want[1024];
+	unsigned int start, len;
+
+	memset(have, 0xff, sizeof(have));
+	memcpy(want, have, sizeof(want));
+	want[10] = 0x00;
+	want[20] = 0x00;
+	want[60] = 0x00;
+	want[100] = 0x00;
+	want[250] = 0x00;
+	want[260] = 0x00;
+
+	/* Runs fitting into one 64 byte command are merged, a run further away is not. */
+	start = 0;
+	len = get_next_write_burst(&flash, have, want, sizeof(have), &start);
+	assert_int_equal(10, start);
+	assert_int_equal(51, len);
+	start += len;
+	len = get_next_write_burst(&flash, have, want, sizeof(have), &start);
+	assert_int_equal(100, start);
+	assert_int_equal(1, len);
+	/* Page boundaries split commands, so runs on both sides stay separate. */
+	start += len;
+	len = get_next_write_burst(&flash, have, want, sizeof(have), &start);
+	assert_int_equal(250, start);
+	assert_int_equal(1, len);
+	start += len;
+	len = get_next_write_burst(&flash, have, want, sizeof(have), &start);
+	assert_int_equal(260, start);
+	assert_int_equal(1, len);
+	start += len;
+	assert_int_equal(0, get_next_write_burst(&flash, have, want, sizeof(have), &start));
+
+	/* A chip which must not be written twice is never coalesced. */
+	chip.gran = WRITE_GRAN_1BYTE;
+	start = 0;
+	len = get_next_write_burst(&flash, have, want, sizeof(have), &start);
+	assert_int_equal(10, start);
+	assert_int_equal(1, len);
+}
+
+static void three_regions_get_region(const struct flashctx *flash, unsigned int addr, struct flash_region *region)
+{
+	(void) flash; /* unused */
+
+	region->start = addr < 0x100 ? 0 : addr < 0x300 ? 0x100 : 0x300;
+	region->end = addr < 0x100 ? 0xff : addr < 0x300 ? 0x2ff : 0xfff;
+	region->read_prot = false;
+	region->write_prot = region->start == 0x100;
+	region->name = strdup(region->write_prot ? "locked" : "open");
+}
+
+void flash_region_table_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashchip chip = { .total_size = 4 }; /* 4 KiB */
+	struct registered_master mst = {
+		.buses_supported = BUS_SPI,
+		.spi.get_region = three_regions_get_region,
+	};
+	struct flashctx flash = { .chip = &chip, .mst = &mst };
+
+	const struct flash_region *region = lookup_flash_region(&flash, 0x180);
+	assert_non_null(region);
+	assert_int_equal(3, flash.region_table_len);
+	assert_int_equal(0x100, region->start);
+	assert_int_equal(0x2ff, region->end);
+	assert_true(region->write_prot);
+	assert_string_equal("locked", region->name);
+
+	assert_ptr_equal(&flash.region_table[0], lookup_flash_region(&flash, 0));
+	assert_ptr_equal(&flash.region_table[0], lookup_flash_region(&flash, 0xff));
+	assert_ptr_equal(&flash.region_table[2], lookup_flash_region(&flash, 0x300));
+	assert_ptr_equal(&flash.region_table[2], lookup_flash_region(&flash, 0xfff));
+
+	assert_int_equal(-1, check_for_unwritable_regions(&flash, 0x0, 0x101));
+	assert_int_equal(0, check_for_unwritable_regions(&flash, 0x300, 0x100));
+
+	release_flash_region_table(&flash);
+	assert_null(flash.region_table);
+	assert_int_equal(0, flash.region_table_len);
+}
@@ -90,6 +90,8 @@ struct io_mock {
 	int (*iom_ioctl)(void *state, int fd, unsigned long request, va_list args);
 	int (*iom_read)(void *state, int fd, void *buf, size_t sz);
 	int (*iom_write)(void *state, int fd, const void *buf, size_t sz);
+	ssize_t (*iom_pread)(void *state, int fd, void *buf, size_t sz, off_t offset);
+	ssize_t (*iom_pwrite)(void *state, int fd, const void *buf, size_t sz, off_t offset);
 
 	/* Standard I/O */
 	FILE* (*iom_fopen)(void *state, const char *pathname, const char *mode);
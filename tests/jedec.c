@@ -0,0 +1,163 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * SPDX-License-Identifier: GPL-2.0-only
+ * SPDX-FileCopyrightText: 2026 The flashrom authors
+ */
+
+#include <include/test.h>
+#include <string.h>
+
+#include "tests.h"
+#include "chipdrivers.h"
+#include "flash.h"
+#include "programmer.h"
+
+#define MOCK_MANUF_ID	0x01
+#define MOCK_MODEL_ID	0x7e
+
+/*
+ * A parallel chip that answers the JEDEC autoselect sequence with MOCK_MANUF_ID at
+ * offset 0 and MOCK_MODEL_ID everywhere else. Every bus cycle and delay is counted,
+ * a probe answered from the memo must not cause any of them.
+ */
+static struct {
+	bool id_mode;
+	unsigned int accesses;
+} jedec_mock;
+
+static void jedec_mock_writeb(const struct flashctx *flash, uint8_t val, chipaddr addr)
+{
+	jedec_mock.accesses++;
+	if (val == 0x90)
+		jedec_mock.id_mode = true;
+	else if (val == 0xf0)
+		jedec_mock.id_mode = false;
+}
+
+static uint8_t jedec_mock_readb(const struct flashctx *flash, const chipaddr addr)
+{
+	jedec_mock.accesses++;
+	if (!jedec_mock.id_mode)
+		return 0xff;
+	return addr == 0 ? MOCK_MANUF_ID : MOCK_MODEL_ID;
+}
+
+static void jedec_mock_delay(const struct flashctx *flash, unsigned int usecs)
+{
+	jedec_mock.accesses++;
+}
+
+static void setup_jedec_mock(struct registered_master *mst, struct flashchip *chip, struct flashctx *flash)
+{
+	memset(&jedec_mock, 0, sizeof(jedec_mock));
+	*mst = (struct registered_master) {
+		.buses_supported = BUS_PARALLEL,
+		.par = {
+			.chip_readb	= jedec_mock_readb,
+			.chip_writeb	= jedec_mock_writeb,
+			.delay		= jedec_mock_delay,
+		},
+	};
+	*chip = (struct flashchip) {
+		.vendor		= "aklm",
+		.name		= "JEDEC mock",
+		.bustype	= BUS_PARALLEL,
+		.manufacture_id	= MOCK_MANUF_ID,
+		.model_id	= MOCK_MODEL_ID,
+		.total_size	= 64,
+		.feature_bits	= FEATURE_ADDR_FULL | FEATURE_SHORT_RESET,
+		.probe_timing	= 10,
+	};
+	*flash = (struct flashctx) {
+		.chip	= chip,
+		.mst	= mst,
+	};
+}
+
+void probe_jedec_memo_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct registered_master mst;
+	struct flashchip chip;
+	struct flashctx flash;
+
+	setup_jedec_mock(&mst, &chip, &flash);
+
+	assert_int_equal(1, probe_jedec(&flash));
+	assert_int_not_equal(0, jedec_mock.accesses);
+
+	/* Same chip again, the IDs come from the memo. */
+	jedec_mock.accesses = 0;
+	assert_int_equal(1, probe_jedec(&flash));
+	assert_int_equal(0, jedec_mock.accesses);
+
+	/* Another chip with the same probe sequence is compared against the memo, too. */
+	struct flashchip other = chip;
+	other.model_id = MOCK_MODEL_ID + 1;
+	flash.chip = &other;
+	assert_int_equal(0, probe_jedec(&flash));
+	assert_int_equal(0, jedec_mock.accesses);
+
+	/* Feature bits that don't change the sequence don't matter either. */
+	other = chip;
+	other.feature_bits |= FEATURE_REGISTERMAP;
+	assert_int_equal(1, probe_jedec(&flash));
+	assert_int_equal(0, jedec_mock.accesses);
+}
+
+void probe_jedec_memo_miss_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct registered_master mst;
+	struct flashchip chip;
+	struct flashctx flash;
+
+	setup_jedec_mock(&mst, &chip, &flash);
+
+	assert_int_equal(1, probe_jedec(&flash));
+
+	struct flashchip other[] = { chip, chip, chip, chip };
+	other[0].feature_bits = FEATURE_ADDR_2AA | FEATURE_SHORT_RESET;		/* different mask */
+	other[1].feature_bits = FEATURE_ADDR_FULL | FEATURE_LONG_RESET;	/* different reset */
+	other[2].feature_bits = FEATURE_ADDR_FULL | FEATURE_SHORT_RESET | FEATURE_ADDR_SHIFTED;
+	other[3].probe_timing = TIMING_ZERO;					/* different timing */
+
+	for (size_t i = 0; i < ARRAY_SIZE(other); i++) {
+		flash.chip = &other[i];
+		jedec_mock.accesses = 0;
+		probe_jedec(&flash);
+		assert_int_not_equal(0, jedec_mock.accesses);
+
+		/* Each variant is remembered on its own. */
+		jedec_mock.accesses = 0;
+		probe_jedec(&flash);
+		assert_int_equal(0, jedec_mock.accesses);
+	}
+}
+
+void probe_jedec_29gl_memo_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct registered_master mst;
+	struct flashchip chip;
+	struct flashctx flash;
+
+	setup_jedec_mock(&mst, &chip, &flash);
+	chip.model_id = MOCK_MODEL_ID << 16 | MOCK_MODEL_ID << 8 | MOCK_MODEL_ID;
+
+	assert_int_equal(1, probe_jedec_29gl(&flash));
+	assert_int_not_equal(0, jedec_mock.accesses);
+
+	jedec_mock.accesses = 0;
+	assert_int_equal(1, probe_jedec_29gl(&flash));
+	assert_int_equal(0, jedec_mock.accesses);
+
+	/* The memo of one sequence never answers the other. */
+	chip.model_id = MOCK_MODEL_ID;
+	assert_int_equal(1, probe_jedec(&flash));
+	assert_int_not_equal(0, jedec_mock.accesses);
+}
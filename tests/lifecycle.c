@@ -81,8 +81,7 @@ void run_probe_v2_lifecycle(void **state, const struct io_mock *io,
 		const char *const chip_name,
 		const char **expected_matched_names, unsigned int expected_matched_count)
 {
-	/* Each probe lifecycle should run independently, without cache. */
-	clear_spi_id_cache();
+	/* Each probe lifecycle runs without cached IDs, since register_master() starts with an empty cache. */
 	run_lifecycle(state, io, prog, param, chip_name,
 			expected_matched_names, expected_matched_count, &probe_chip_v2);
 }
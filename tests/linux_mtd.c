@@ -11,8 +11,22 @@
 #include "helpers.h"
 
 #if CONFIG_LINUX_MTD == 1
+#include <errno.h>
+#include <mtd/mtd-user.h>
+
+#define MTD_SIZE	2048
+#define MTD_ERASESIZE	512
+#define MTD_BLOCKS	(MTD_SIZE / MTD_ERASESIZE)
+
 struct linux_mtd_io_state {
 	char *fopen_path;
+	/* Emulated device contents, eraseblocks marked unreadable fail every pread() touching them. */
+	uint8_t contents[MTD_SIZE];
+	bool unreadable[MTD_BLOCKS];
+	unsigned int pread_calls;
+	unsigned int pwrite_calls;
+	unsigned int erase_calls;
+	struct erase_info_user64 erases[MTD_BLOCKS];
 };
 
 static FILE *linux_mtd_fopen(void *state, const char *pathname, const char *mode)
@@ -33,8 +47,8 @@ static size_t linux_mtd_fread(void *state, void *buf, size_t size, size_t len, F
 	const struct linux_mtd_fread_mock_entry fread_mock_map[] = {
 		{ "/sys/class/mtd/mtd0/type",            "nor"    },
 		{ "/sys/class/mtd/mtd0/name",            "Device" },
-		{ "/sys/class/mtd/mtd0/flags",           ""       },
-		{ "/sys/class/mtd/mtd0/size",            "1024"   },
+		{ "/sys/class/mtd/mtd0/flags",           "0x400"  },
+		{ "/sys/class/mtd/mtd0/size",            "2048"   },
 		{ "/sys/class/mtd/mtd0/erasesize",       "512"    },
 		{ "/sys/class/mtd/mtd0/numeraseregions", "0"      },
 	};
@@ -67,12 +81,103 @@ static int linux_mtd_fclose(void *state, FILE *fp)
 	return 0;
 }
 
+static ssize_t linux_mtd_pread(void *state, int fd, void *buf, size_t sz, off_t offset)
+{
+	struct linux_mtd_io_state *io_state = state;
+
+	io_state->pread_calls++;
+	assert_true(offset + sz <= MTD_SIZE);
+	for (off_t addr = offset; addr < (off_t)(offset + sz); addr += MTD_ERASESIZE) {
+		if (io_state->unreadable[addr / MTD_ERASESIZE]) {
+			errno = EIO;
+			return -1;
+		}
+	}
+	memcpy(buf, io_state->contents + offset, sz);
+
+	return sz;
+}
+
+static ssize_t linux_mtd_pwrite(void *state, int fd, const void *buf, size_t sz, off_t offset)
+{
+	struct linux_mtd_io_state *io_state = state;
+
+	io_state->pwrite_calls++;
+	assert_true(offset + sz <= MTD_SIZE);
+	memcpy(io_state->contents + offset, buf, sz);
+
+	return sz;
+}
+
+static int linux_mtd_ioctl(void *state, int fd, unsigned long request, va_list args)
+{
+	struct linux_mtd_io_state *io_state = state;
+
+	if (request == MEMERASE64) {
+		const struct erase_info_user64 *erase_info = va_arg(args, struct erase_info_user64 *);
+
+		assert_true(io_state->erase_calls < MTD_BLOCKS);
+		assert_true(erase_info->start + erase_info->length <= MTD_SIZE);
+		io_state->erases[io_state->erase_calls++] = *erase_info;
+		memset(io_state->contents + erase_info->start, 0xff, erase_info->length);
+	}
+
+	return 0;
+}
+
+/* Fills eraseblock `block` of the emulated device with `value`. */
+static void fill_block(struct linux_mtd_io_state *io_state, unsigned int block, uint8_t value)
+{
+	memset(io_state->contents + block * MTD_ERASESIZE, value, MTD_ERASESIZE);
+}
+
+static void assert_erase(const struct linux_mtd_io_state *io_state, unsigned int i,
+			 uint64_t start, uint64_t length)
+{
+	assert_int_equal(start, io_state->erases[i].start);
+	assert_int_equal(length, io_state->erases[i].length);
+}
+
+static void init_and_probe(struct linux_mtd_io_state *io_state, struct io_mock_fallback_open_state *open_state,
+			   struct io_mock *io, const char *param,
+			   struct flashrom_programmer **flashprog, struct flashrom_flashctx **flashctx)
+{
+	*open_state = (struct io_mock_fallback_open_state){
+		.noc = 0,
+		.paths = { "/dev/mtd0", NULL },
+		.flags = { O_RDWR },
+	};
+	*io = (struct io_mock){
+		.state		= io_state,
+		.iom_fopen	= linux_mtd_fopen,
+		.iom_fread	= linux_mtd_fread,
+		.iom_fclose	= linux_mtd_fclose,
+		.iom_pread	= linux_mtd_pread,
+		.iom_pwrite	= linux_mtd_pwrite,
+		.iom_ioctl	= linux_mtd_ioctl,
+		.fallback_open_state = open_state,
+	};
+	io_mock_register(io);
+
+	assert_int_equal(0, flashrom_programmer_init(flashprog, "linux_mtd", param));
+	assert_int_equal(0, flashrom_flash_probe(flashctx, *flashprog, NULL));
+	assert_int_equal(MTD_SIZE, flashrom_flash_getsize(*flashctx));
+}
+
+static void release_and_shutdown(struct flashrom_programmer *flashprog, struct flashrom_flashctx *flashctx)
+{
+	flashrom_flash_release(flashctx);
+	assert_int_equal(0, flashrom_programmer_shutdown(flashprog));
+	io_mock_register(NULL);
+}
+
 void linux_mtd_probe_lifecycle_test_success(void **state)
 {
 	struct linux_mtd_io_state linux_mtd_io_state = { NULL };
 	struct io_mock_fallback_open_state linux_mtd_fallback_open_state = {
 		.noc = 0,
-		.paths = { NULL },
+		.paths = { "/dev/mtd0", NULL },
+		.flags = { O_RDWR },
 	};
 	const struct io_mock linux_mtd_io = {
 		.state	= &linux_mtd_io_state,
@@ -86,6 +191,116 @@ void linux_mtd_probe_lifecycle_test_success(void **state)
 	run_probe_v2_lifecycle(state, &linux_mtd_io, &programmer_linux_mtd, "", "Opaque flash chip",
 				expected_matched_names, 1);
 }
+
+void linux_mtd_erase_skips_erased_blocks_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct linux_mtd_io_state io_state;
+	struct io_mock_fallback_open_state open_state;
+	struct io_mock io;
+	struct flashrom_programmer *flashprog;
+	struct flashrom_flashctx *flashctx;
+
+	memset(&io_state, 0, sizeof(io_state));
+	fill_block(&io_state, 0, 0x00);
+	fill_block(&io_state, 1, 0xff);
+	fill_block(&io_state, 2, 0x5a);
+	fill_block(&io_state, 3, 0xff);
+	init_and_probe(&io_state, &open_state, &io, "", &flashprog, &flashctx);
+
+	/* A plain erase doesn't know the contents, so the driver reads every block back. */
+	assert_int_equal(0, flashrom_flash_erase(flashctx));
+	assert_int_equal(2, io_state.erase_calls);
+	assert_erase(&io_state, 0, 0 * MTD_ERASESIZE, MTD_ERASESIZE);
+	assert_erase(&io_state, 1, 2 * MTD_ERASESIZE, MTD_ERASESIZE);
+	for (unsigned int i = 0; i < MTD_SIZE; i++)
+		assert_int_equal(0xff, io_state.contents[i]);
+
+	/* Erasing the erased device issues no MEMERASE64 at all. */
+	io_state.erase_calls = 0;
+	assert_int_equal(0, flashrom_flash_erase(flashctx));
+	assert_int_equal(0, io_state.erase_calls);
+
+	release_and_shutdown(flashprog, flashctx);
+}
+
+void linux_mtd_write_erases_without_read_back_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct linux_mtd_io_state io_state;
+	static uint8_t oldcontents[MTD_SIZE], newcontents[MTD_SIZE];
+	struct io_mock_fallback_open_state open_state;
+	struct io_mock io;
+	struct flashrom_programmer *flashprog;
+	struct flashrom_flashctx *flashctx;
+
+	memset(&io_state, 0, sizeof(io_state));
+	fill_block(&io_state, 0, 0xff);
+	fill_block(&io_state, 1, 0x5a);
+	fill_block(&io_state, 2, 0xff);
+	fill_block(&io_state, 3, 0x33);
+	memcpy(oldcontents, io_state.contents, MTD_SIZE);
+	memcpy(newcontents, io_state.contents, MTD_SIZE);
+	memset(newcontents + 1 * MTD_ERASESIZE, 0xa5, MTD_ERASESIZE);
+	memset(newcontents + 2 * MTD_ERASESIZE, 0x11, MTD_ERASESIZE);
+	init_and_probe(&io_state, &open_state, &io, "", &flashprog, &flashctx);
+
+	/*
+	 * With the contents known, only block 1 needs an erase and nothing is
+	 * read from the device, neither for the write nor for the erase.
+	 */
+	assert_int_equal(0, flashrom_image_write(flashctx, newcontents, MTD_SIZE, oldcontents));
+	assert_int_equal(0, io_state.pread_calls);
+	assert_int_equal(1, io_state.erase_calls);
+	assert_erase(&io_state, 0, 1 * MTD_ERASESIZE, MTD_ERASESIZE);
+	assert_memory_equal(newcontents, io_state.contents, MTD_SIZE);
+
+	release_and_shutdown(flashprog, flashctx);
+}
+
+void linux_mtd_read_ignore_errors_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	static struct linux_mtd_io_state io_state;
+	struct io_mock_fallback_open_state open_state;
+	struct io_mock io;
+	struct flashrom_programmer *flashprog;
+	struct flashrom_flashctx *flashctx;
+	uint8_t buf[MTD_SIZE];
+
+	memset(&io_state, 0, sizeof(io_state));
+	for (unsigned int i = 0; i < MTD_SIZE; i++)
+		io_state.contents[i] = i * 7;
+	io_state.unreadable[1] = true;
+	io_state.unreadable[3] = true;
+
+	/* Without ignore_read_errors the read fails. */
+	init_and_probe(&io_state, &open_state, &io, "", &flashprog, &flashctx);
+	assert_int_not_equal(0, flashrom_image_read(flashctx, buf, sizeof(buf)));
+	release_and_shutdown(flashprog, flashctx);
+
+	/*
+	 * The failed whole-device request is retried per eraseblock, once.
+	 * Only the unreadable blocks are filled, the blocks around them are read.
+	 */
+	init_and_probe(&io_state, &open_state, &io, "ignore_read_errors=yes", &flashprog, &flashctx);
+	io_state.pread_calls = 0;
+	assert_int_equal(0, flashrom_image_read(flashctx, buf, sizeof(buf)));
+	assert_int_equal(1 + MTD_BLOCKS, io_state.pread_calls);
+	for (unsigned int i = 0; i < MTD_SIZE; i++) {
+		if (i / MTD_ERASESIZE == 1 || i / MTD_ERASESIZE == 3)
+			assert_int_equal(0xff, buf[i]);
+		else
+			assert_int_equal(io_state.contents[i], buf[i]);
+	}
+	release_and_shutdown(flashprog, flashctx);
+}
 #else
 	SKIP_TEST(linux_mtd_probe_lifecycle_test_success)
+	SKIP_TEST(linux_mtd_erase_skips_erased_blocks_test_success)
+	SKIP_TEST(linux_mtd_write_erases_without_read_back_test_success)
+	SKIP_TEST(linux_mtd_read_ignore_errors_test_success)
 #endif /* CONFIG_LINUX_MTD */
@@ -62,6 +62,104 @@ void linux_spi_probe_lifecycle_test_success(void **state)
 	run_probe_v2_lifecycle(state, &linux_spi_io, &programmer_linux_spi, "dev=/dev/null", "W25Q128.V",
 				expected_matched_names, 1);
 }
+
+struct linux_spi_batch_state {
+	const char *bufsiz;
+	unsigned int messages;
+	unsigned int transfers[4];
+	uint32_t cs_changes[4];
+};
+
+static int linux_spi_batch_ioctl(void *state, int fd, unsigned long request, va_list args)
+{
+	struct linux_spi_batch_state *s = state;
+
+	for (unsigned int n = 1; n <= 16; n++) {
+		if (request != SPI_IOC_MESSAGE(n))
+			continue;
+		const struct spi_ioc_transfer *msg = va_arg(args, struct spi_ioc_transfer *);
+		assert_true(s->messages < ARRAY_SIZE(s->transfers));
+		s->transfers[s->messages] = n;
+		/* One bit per transfer that releases chip select after it. */
+		for (unsigned int i = 0; i < n; i++)
+			s->cs_changes[s->messages] |= (uint32_t)!!msg[i].cs_change << i;
+		s->messages++;
+		return 0;
+	}
+
+	return 0;
+}
+
+static char *linux_spi_batch_fgets(void *state, char *buf, int len, FILE *fp)
+{
+	struct linux_spi_batch_state *s = state;
+
+	return memcpy(buf, s->bufsiz, min(len, strlen(s->bufsiz) + 1));
+}
+
+void linux_spi_multicommand_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	unsigned char status[2];
+	struct spi_command cmds[] = {
+	{
+		.writecnt = JEDEC_WREN_OUTSIZE,
+		.writearr = (const unsigned char[]){ JEDEC_WREN },
+	}, {
+		.writecnt = JEDEC_RDSR_OUTSIZE,
+		.writearr = (const unsigned char[]){ JEDEC_RDSR },
+		.readcnt = JEDEC_RDSR_INSIZE,
+		.readarr = &status[0],
+	}, {
+		.writecnt = JEDEC_RDSR_OUTSIZE,
+		.writearr = (const unsigned char[]){ JEDEC_RDSR },
+		.readcnt = JEDEC_RDSR_INSIZE,
+		.readarr = &status[1],
+	},
+		NULL_SPI_CMD,
+	};
+	struct io_mock_fallback_open_state linux_spi_fallback_open_state = {
+		.noc = 0,
+		.paths = { "/dev/null", NULL },
+		.flags = { O_RDWR },
+	};
+
+	/* All commands go out in one message, chip select is released between them. */
+	struct linux_spi_batch_state batch_state = { .bufsiz = "4096" };
+	const struct io_mock linux_spi_io = {
+		.state		= &batch_state,
+		.iom_fgets	= linux_spi_batch_fgets,
+		.iom_ioctl	= linux_spi_batch_ioctl,
+		.fallback_open_state = &linux_spi_fallback_open_state,
+	};
+	struct flashrom_flashctx flashctx = { 0 };
+
+	io_mock_register(&linux_spi_io);
+	assert_int_equal(0, programmer_init(&programmer_linux_spi, "dev=/dev/null"));
+	flashctx.mst = &registered_masters[0];
+	assert_int_equal(0, spi_send_multicommand(&flashctx, cmds));
+	assert_int_equal(0, programmer_shutdown());
+	assert_int_equal(1, batch_state.messages);
+	assert_int_equal(5, batch_state.transfers[0]);
+	assert_int_equal(0x5, batch_state.cs_changes[0]);
+
+	/* A kernel buffer of 4 bytes only takes two of the commands at once. */
+	batch_state = (struct linux_spi_batch_state){ .bufsiz = "4" };
+	linux_spi_fallback_open_state.noc = 0;
+	assert_int_equal(0, programmer_init(&programmer_linux_spi, "dev=/dev/null"));
+	flashctx.mst = &registered_masters[0];
+	assert_int_equal(0, spi_send_multicommand(&flashctx, cmds));
+	assert_int_equal(0, programmer_shutdown());
+	assert_int_equal(2, batch_state.messages);
+	assert_int_equal(3, batch_state.transfers[0]);
+	assert_int_equal(0x1, batch_state.cs_changes[0]);
+	assert_int_equal(2, batch_state.transfers[1]);
+	assert_int_equal(0x0, batch_state.cs_changes[1]);
+
+	io_mock_register(NULL);
+}
 #else
 	SKIP_TEST(linux_spi_probe_lifecycle_test_success)
+	SKIP_TEST(linux_spi_multicommand_test_success)
 #endif /* CONFIG_LINUX_SPI */
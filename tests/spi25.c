@@ -147,12 +147,54 @@ void spi_write_disable_test_success(void **state)
 	assert_int_equal(0, spi_write_disable(&flashctx));
 }
 
+void spi_read_unique_id_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	uint8_t id[JEDEC_RDUID_INSIZE];
+	struct flashctx flashctx = { .chip = &mock_chip };
+
+	/* The wrap only answers for mock_chip itself, restored below. */
+	mock_chip.feature_bits |= FEATURE_UNIQUE_ID;
+
+	/* Opcode and four dummy bytes. */
+	expect_memory(__wrap_spi_send_command, flash, &flashctx, sizeof(flashctx));
+	will_return(__wrap_spi_send_command, JEDEC_RDUID_OUTSIZE);
+	will_return(__wrap_spi_send_command, JEDEC_RDUID);
+	will_return(__wrap_spi_send_command, JEDEC_RDUID_INSIZE);
+	assert_int_equal(0, spi_read_unique_id(&flashctx, id, sizeof(id)));
+	for (unsigned int i = 0; i < sizeof(id); i++)
+		assert_int_equal(i, id[i]);
+
+	/* One more dummy byte in 4BA mode. */
+	flashctx.in_4ba_mode = true;
+	expect_memory(__wrap_spi_send_command, flash, &flashctx, sizeof(flashctx));
+	will_return(__wrap_spi_send_command, JEDEC_RDUID_OUTSIZE + 1);
+	will_return(__wrap_spi_send_command, JEDEC_RDUID);
+	will_return(__wrap_spi_send_command, JEDEC_RDUID_INSIZE);
+	assert_int_equal(0, spi_read_unique_id(&flashctx, id, sizeof(id)));
+
+	mock_chip.feature_bits &= ~FEATURE_UNIQUE_ID;
+}
+
+void spi_read_unique_id_unsupported_chip(void **state)
+{
+	(void) state; /* unused */
+
+	uint8_t id[JEDEC_RDUID_INSIZE];
+	struct flashctx flashctx = { .chip = &mock_chip };
+
+	/* Without FEATURE_UNIQUE_ID nothing must be sent, the wrap would fail without expectations. */
+	assert_int_equal(1, spi_read_unique_id(&flashctx, id, sizeof(id)));
+}
+
 void probe_spi_rdid_test_success(void **state)
 {
 	(void) state; /* unused */
 
 	/* setup initial test state. */
-	struct flashctx flashctx = { .chip = &mock_chip };
+	struct registered_master mst = { 0 };
+	struct flashctx flashctx = { .chip = &mock_chip, .mst = &mst };
 	expect_memory(__wrap_spi_send_command, flash,
 			&flashctx, sizeof(flashctx));
 
@@ -167,7 +209,8 @@ void probe_spi_rdid4_test_success(void **state)
 	(void) state; /* unused */
 
 	/* setup initial test state. */
-	struct flashctx flashctx = { .chip = &mock_chip };
+	struct registered_master mst = { 0 };
+	struct flashctx flashctx = { .chip = &mock_chip, .mst = &mst };
 	expect_memory(__wrap_spi_send_command, flash,
 			&flashctx, sizeof(flashctx));
 
@@ -182,7 +225,8 @@ void probe_spi_rems_test_success(void **state)
 	(void) state; /* unused */
 
 	/* setup initial test state. */
-	struct flashctx flashctx = { .chip = &mock_chip };
+	struct registered_master mst = { 0 };
+	struct flashctx flashctx = { .chip = &mock_chip, .mst = &mst };
 	expect_memory(__wrap_spi_send_command, flash,
 			&flashctx, sizeof(flashctx));
 
@@ -197,7 +241,8 @@ void probe_spi_res1_test_success(void **state)
 	(void) state; /* unused */
 
 	/* setup initial test state. */
-	struct flashctx flashctx = { .chip = &mock_chip };
+	struct registered_master mst = { 0 };
+	struct flashctx flashctx = { .chip = &mock_chip, .mst = &mst };
 	expect_memory(__wrap_spi_send_command, flash,
 			&flashctx, sizeof(flashctx));
 
@@ -212,8 +257,8 @@ void probe_spi_res2_test_success(void **state)
 	(void) state; /* unused */
 
 	/* setup initial test state. */
-	clear_spi_id_cache();
-	struct flashctx flashctx = { .chip = &mock_chip };
+	struct registered_master mst = { 0 };
+	struct flashctx flashctx = { .chip = &mock_chip, .mst = &mst };
 	expect_memory(__wrap_spi_send_command, flash,
 			&flashctx, sizeof(flashctx));
 
@@ -228,7 +273,8 @@ void probe_spi_res3_test_success(void **state)
 	(void) state; /* unused */
 
 	/* setup initial test state. */
-	struct flashctx flashctx = { .chip = &mock_chip };
+	struct registered_master mst = { 0 };
+	struct flashctx flashctx = { .chip = &mock_chip, .mst = &mst };
 	expect_memory(__wrap_spi_send_command, flash,
 			&flashctx, sizeof(flashctx));
 
@@ -253,6 +299,41 @@ void probe_spi_at25f_test_success(void **state)
 	assert_int_equal(0, probe_spi_at25f(&flashctx));
 }
 
+void spi_probe_may_match_test_success(void **state)
+{
+	(void) state; /* unused */
+
+	struct flashchip rdid_chip = { .probe = PROBE_SPI_RDID, .manufacture_id = 0x00, .model_id = 0x0102 };
+	struct flashchip other_chip = { .probe = PROBE_SPI_RDID, .manufacture_id = 0x00, .model_id = 0x0103 };
+	struct flashchip rems_chip = { .probe = PROBE_SPI_REMS, .manufacture_id = 0x01, .model_id = 0x02 };
+
+	struct registered_master mst = { 0 };
+
+	/* Without a cached ID every chip may match. */
+	assert_true(spi_probe_may_match(&mst, &rdid_chip));
+	assert_true(spi_probe_may_match(&mst, &other_chip));
+
+	/* The mock answers RDID with 00 01 02. */
+	struct flashctx flashctx = { .chip = &mock_chip, .mst = &mst };
+	expect_memory(__wrap_spi_send_command, flash,
+			&flashctx, sizeof(flashctx));
+
+	will_return(__wrap_spi_send_command, JEDEC_RDID_OUTSIZE);
+	will_return(__wrap_spi_send_command, JEDEC_RDID);
+	will_return(__wrap_spi_send_command, JEDEC_RDID_INSIZE);
+	assert_int_equal(0, probe_spi_rdid(&flashctx));
+
+	assert_true(spi_probe_may_match(&mst, &rdid_chip));
+	assert_false(spi_probe_may_match(&mst, &other_chip));
+	assert_false(spi_probe_may_match(&mst, &mock_chip));
+	/* REMS was not sent yet. */
+	assert_true(spi_probe_may_match(&mst, &rems_chip));
+
+	/* Another master does not see the ID. */
+	struct registered_master other_mst = { 0 };
+	assert_true(spi_probe_may_match(&other_mst, &other_chip));
+}
+
 /* spi95.c */
 void probe_spi_st95_test_success(void **state)
 {
@@ -189,6 +189,38 @@ int __wrap_read(int fd, void *buf, size_t sz)
 	return sz;
 }
 
+ssize_t __wrap_pread(int fd, void *buf, size_t sz, off_t offset)
+{
+	LOG_ME;
+	if (get_io() && get_io()->iom_pread)
+		return get_io()->iom_pread(get_io()->state, fd, buf, sz, offset);
+	return sz;
+}
+
+ssize_t __wrap_pread64(int fd, void *buf, size_t sz, off_t offset)
+{
+	LOG_ME;
+	if (get_io() && get_io()->iom_pread)
+		return get_io()->iom_pread(get_io()->state, fd, buf, sz, offset);
+	return sz;
+}
+
+ssize_t __wrap_pwrite(int fd, const void *buf, size_t sz, off_t offset)
+{
+	LOG_ME;
+	if (get_io() && get_io()->iom_pwrite)
+		return get_io()->iom_pwrite(get_io()->state, fd, buf, sz, offset);
+	return sz;
+}
+
+ssize_t __wrap_pwrite64(int fd, const void *buf, size_t sz, off_t offset)
+{
+	LOG_ME;
+	if (get_io() && get_io()->iom_pwrite)
+		return get_io()->iom_pwrite(get_io()->state, fd, buf, sz, offset);
+	return sz;
+}
+
 FILE *__wrap_fopen(const char *pathname, const char *mode)
 {
 	LOG_ME;
@@ -476,6 +508,10 @@ int main(int argc, char *argv[])
 
 	const struct CMUnitTest flashrom_tests[] = {
 		cmocka_unit_test(flashbuses_to_text_test_success),
+		cmocka_unit_test(need_erase_test_success),
+		cmocka_unit_test(get_next_write_test_success),
+		cmocka_unit_test(get_next_write_burst_test_success),
+		cmocka_unit_test(flash_region_table_test_success),
 	};
 	ret |= cmocka_run_group_tests_name("flashrom.c tests", flashrom_tests, NULL, NULL);
 
@@ -493,6 +529,8 @@ int main(int argc, char *argv[])
 		cmocka_unit_test(spi_write_enable_test_success),
 		cmocka_unit_test(spi_write_disable_test_success),
 		cmocka_unit_test(default_spi_read_test_success),
+		cmocka_unit_test(spi_read_unique_id_test_success),
+		cmocka_unit_test(spi_read_unique_id_unsupported_chip),
 		cmocka_unit_test(probe_spi_rdid_test_success),
 		cmocka_unit_test(probe_spi_rdid4_test_success),
 		cmocka_unit_test(probe_spi_rems_test_success),
@@ -500,6 +538,7 @@ int main(int argc, char *argv[])
 		cmocka_unit_test(probe_spi_res2_test_success),
 		cmocka_unit_test(probe_spi_res3_test_success),
 		cmocka_unit_test(probe_spi_at25f_test_success),
+		cmocka_unit_test(spi_probe_may_match_test_success),
 		cmocka_unit_test(probe_spi_st95_test_success), /* spi95.c */
 	};
 	ret |= cmocka_run_group_tests_name("spi25.c tests", spi25_tests, NULL, NULL);
@@ -514,6 +553,13 @@ int main(int argc, char *argv[])
 	};
 	ret |= cmocka_run_group_tests_name("probe_spi.c tests", probe_spi_tests, NULL, NULL);
 
+	const struct CMUnitTest jedec_tests[] = {
+		cmocka_unit_test(probe_jedec_memo_test_success),
+		cmocka_unit_test(probe_jedec_memo_miss_test_success),
+		cmocka_unit_test(probe_jedec_29gl_memo_test_success),
+	};
+	ret |= cmocka_run_group_tests_name("jedec.c tests", jedec_tests, NULL, NULL);
+
 	const struct CMUnitTest lifecycle_tests[] = {
 		cmocka_unit_test(dummy_basic_lifecycle_test_success),
 		cmocka_unit_test(dummy_probe_lifecycle_test_success),
@@ -525,6 +571,7 @@ int main(int argc, char *argv[])
 		cmocka_unit_test(dummy_init_fails_unhandled_param_test_success),
 		cmocka_unit_test(dummy_init_success_invalid_param_test_success),
 		cmocka_unit_test(dummy_init_success_unhandled_param_test_success),
+		cmocka_unit_test(dummy_init_twice_fails_until_shutdown),
 		cmocka_unit_test(dummy_null_prog_param_test_success),
 		cmocka_unit_test(dummy_all_buses_test_success),
 		cmocka_unit_test(dummy_freq_param_init),
@@ -540,7 +587,11 @@ int main(int argc, char *argv[])
 		cmocka_unit_test(raiden_debug_target1_basic_lifecycle_test_success),
 		cmocka_unit_test(dediprog_basic_lifecycle_test_success),
 		cmocka_unit_test(linux_mtd_probe_lifecycle_test_success),
+		cmocka_unit_test(linux_mtd_erase_skips_erased_blocks_test_success),
+		cmocka_unit_test(linux_mtd_write_erases_without_read_back_test_success),
+		cmocka_unit_test(linux_mtd_read_ignore_errors_test_success),
 		cmocka_unit_test(linux_spi_probe_lifecycle_test_success),
+		cmocka_unit_test(linux_spi_multicommand_test_success),
 		cmocka_unit_test(parade_lspcon_basic_lifecycle_test_success),
 		cmocka_unit_test(parade_lspcon_no_allow_brick_test_success),
 		cmocka_unit_test(mediatek_i2c_spi_basic_lifecycle_test_success),
@@ -582,16 +633,28 @@ int main(int argc, char *argv[])
 		cmocka_unit_test(erase_chip_test_success),
 		cmocka_unit_test(erase_chip_with_progress),
 		cmocka_unit_test(erase_chip_with_dummyflasher_test_success),
+		cmocka_unit_test(erase_chip_cancelled_with_dummyflasher),
+		cmocka_unit_test(erase_chip_failed_while_cancelled),
+		cmocka_unit_test(write_chip_failed_while_cancelled),
 		cmocka_unit_test(erase_chip_dual_die_c2),
 		cmocka_unit_test(read_chip_test_success),
 		cmocka_unit_test(read_chip_with_progress),
 		cmocka_unit_test(read_chip_with_dummyflasher_test_success),
+		cmocka_unit_test(read_chip_multi_io_with_dummyflasher_test_success),
+		cmocka_unit_test(read_chip_sfdp_with_dummyflasher_test_success),
+		cmocka_unit_test(probe_sfdp_jesd216b_with_dummyflasher_test_success),
+		cmocka_unit_test(read_unique_id_with_dummyflasher_test_success),
+		cmocka_unit_test(spi_poll_wip_timeout_test),
+		cmocka_unit_test(spi_poll_wip_slow_chip_test_success),
+		cmocka_unit_test(spi_poll_wip_busy_time_converges_test_success),
 		cmocka_unit_test(write_chip_test_success),
 		cmocka_unit_test(write_chip_with_progress),
 		cmocka_unit_test(write_chip_with_dummyflasher_test_success),
 		cmocka_unit_test(write_chip_feature_no_erase),
 		cmocka_unit_test(write_chip_feature_no_erase_with_progress),
 		cmocka_unit_test(write_nonaligned_region_with_dummyflasher_test_success),
+		cmocka_unit_test(region_ops_with_dummyflasher_test_success),
+		cmocka_unit_test(region_write_protected_block_with_dummyflasher_test_success),
 		cmocka_unit_test(verify_chip_test_success),
 		cmocka_unit_test(verify_chip_with_dummyflasher_test_success),
 		cmocka_unit_test(erase_chip_bad_status_test),
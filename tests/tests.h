@@ -29,6 +29,10 @@ void i2c_require_allow_brick_invalid_test_success(void **state);
 
 /* flashrom.c */
 void flashbuses_to_text_test_success(void **state);
+void need_erase_test_success(void **state);
+void get_next_write_test_success(void **state);
+void get_next_write_burst_test_success(void **state);
+void flash_region_table_test_success(void **state);
 
 /* libflashrom.c */
 void flashrom_set_log_callback_test_success(void **state);
@@ -42,6 +46,8 @@ void flashrom_layout_compare_test_success(void **state);
 void spi_write_enable_test_success(void **state);
 void spi_write_disable_test_success(void **state);
 void default_spi_read_test_success(void **state);
+void spi_read_unique_id_test_success(void **state);
+void spi_read_unique_id_unsupported_chip(void **state);
 void probe_spi_rdid_test_success(void **state);
 void probe_spi_rdid4_test_success(void **state);
 void probe_spi_rems_test_success(void **state);
@@ -49,6 +55,7 @@ void probe_spi_res1_test_success(void **state);
 void probe_spi_res2_test_success(void **state);
 void probe_spi_res3_test_success(void **state);
 void probe_spi_at25f_test_success(void **state);
+void spi_probe_may_match_test_success(void **state);
 void probe_spi_st95_test_success(void **state); /* spi95.c */
 
 /* probe_spi.c */
@@ -59,6 +66,11 @@ void probe_jedec_res1_fixed_chipname(void **state);
 void probe_jedec_res1_try_all_flashchips(void **state);
 void probe_jedec_res1_no_matches_found(void **state);
 
+/* jedec.c */
+void probe_jedec_memo_test_success(void **state);
+void probe_jedec_memo_miss_test_success(void **state);
+void probe_jedec_29gl_memo_test_success(void **state);
+
 /* lifecycle.c */
 void dummy_basic_lifecycle_test_success(void **state);
 void dummy_probe_lifecycle_test_success(void **state);
@@ -70,6 +82,7 @@ void dummy_probe_variable_size_test_success(void **state);
 void dummy_init_fails_unhandled_param_test_success(void **state);
 void dummy_init_success_invalid_param_test_success(void **state);
 void dummy_init_success_unhandled_param_test_success(void **state);
+void dummy_init_twice_fails_until_shutdown(void **state);
 void dummy_null_prog_param_test_success(void **state);
 void dummy_all_buses_test_success(void **state);
 void dummy_freq_param_init(void **state);
@@ -85,7 +98,11 @@ void raiden_debug_target0_basic_lifecycle_test_success(void **state);
 void raiden_debug_target1_basic_lifecycle_test_success(void **state);
 void dediprog_basic_lifecycle_test_success(void **state);
 void linux_mtd_probe_lifecycle_test_success(void **state);
+void linux_mtd_erase_skips_erased_blocks_test_success(void **state);
+void linux_mtd_write_erases_without_read_back_test_success(void **state);
+void linux_mtd_read_ignore_errors_test_success(void **state);
 void linux_spi_probe_lifecycle_test_success(void **state);
+void linux_spi_multicommand_test_success(void **state);
 void parade_lspcon_basic_lifecycle_test_success(void **state);
 void parade_lspcon_no_allow_brick_test_success(void **state);
 void mediatek_i2c_spi_basic_lifecycle_test_success(void **state);
@@ -123,16 +140,28 @@ void layout_region_invalid_range_test_success(void **state);
 void erase_chip_test_success(void **state);
 void erase_chip_with_progress(void **state);
 void erase_chip_with_dummyflasher_test_success(void **state);
+void erase_chip_cancelled_with_dummyflasher(void **state);
+void erase_chip_failed_while_cancelled(void **state);
+void write_chip_failed_while_cancelled(void **state);
 void erase_chip_dual_die_c2(void **state);
 void read_chip_test_success(void **state);
 void read_chip_with_progress(void **state);
 void read_chip_with_dummyflasher_test_success(void **state);
+void read_chip_multi_io_with_dummyflasher_test_success(void **state);
+void read_chip_sfdp_with_dummyflasher_test_success(void **state);
+void probe_sfdp_jesd216b_with_dummyflasher_test_success(void **state);
+void read_unique_id_with_dummyflasher_test_success(void **state);
+void spi_poll_wip_timeout_test(void **state);
+void spi_poll_wip_slow_chip_test_success(void **state);
+void spi_poll_wip_busy_time_converges_test_success(void **state);
 void write_chip_test_success(void **state);
 void write_chip_with_progress(void **state);
 void write_chip_with_dummyflasher_test_success(void **state);
 void write_chip_feature_no_erase(void **state);
 void write_chip_feature_no_erase_with_progress(void **state);
 void write_nonaligned_region_with_dummyflasher_test_success(void **state);
+void region_ops_with_dummyflasher_test_success(void **state);
+void region_write_protected_block_with_dummyflasher_test_success(void **state);
 void verify_chip_test_success(void **state);
 void verify_chip_with_dummyflasher_test_success(void **state);
 void erase_chip_bad_status_test(void **state);
@@ -30,6 +30,10 @@ int __wrap_fcntl64(int fd, int cmd, ...);
 int __wrap_ioctl(int fd, unsigned long int request, ...);
 int __wrap_write(int fd, const void *buf, size_t sz);
 int __wrap_read(int fd, void *buf, size_t sz);
+ssize_t __wrap_pread(int fd, void *buf, size_t sz, off_t offset);
+ssize_t __wrap_pread64(int fd, void *buf, size_t sz, off_t offset);
+ssize_t __wrap_pwrite(int fd, const void *buf, size_t sz, off_t offset);
+ssize_t __wrap_pwrite64(int fd, const void *buf, size_t sz, off_t offset);
 FILE *__wrap_fopen(const char *pathname, const char *mode);
 FILE *__real_fopen(const char *pathname, const char *mode);
 FILE *__wrap_fopen64(const char *pathname, const char *mode);
@@ -0,0 +1,548 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileCopyrightText: 2026 The flashrom authors
+ */
+
+/*
+ * flashromd keeps a programmer session and a probed flash chip open and serves
+ * requests from local clients over a Unix domain socket, so that repeated
+ * operations do not pay for programmer initialization and probing each time.
+ * See README.md for the protocol.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libflashrom.h"
+
+#define REQUEST_MAX	4096
+/* Blocks read to check remembered contents before a write, see check_contents(). */
+#define CHECK_SAMPLES		8
+#define CHECK_SAMPLE_LEN	4096
+
+struct session {
+	bool initialized;
+	struct flashrom_programmer *prog;
+	struct flashrom_flashctx *flash;
+	size_t size;
+	/*
+	 * Chip contents after the last read, verify or verified write; NULL if
+	 * unknown. Used as reference contents for the next write once they pass
+	 * check_contents().
+	 */
+	uint8_t *contents;
+};
+
+struct client {
+	FILE *out;
+	enum flashrom_progress_stage stage;
+	unsigned int percent;
+};
+
+static volatile sig_atomic_t terminate;
+static enum flashrom_log_level log_level = FLASHROM_MSG_INFO;
+
+static void handle_signal(int sig)
+{
+	terminate = 1;
+}
+
+static void log_to_stderr(enum flashrom_log_level level, const char *message, void *user_data)
+{
+	if (level <= log_level)
+		fputs(message, stderr);
+}
+
+static void reply(struct client *client, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	vfprintf(client->out, fmt, ap);
+	va_end(ap);
+	fputc('\n', client->out);
+	fflush(client->out);
+}
+
+static const char *const stage_names[] = {
+	[FLASHROM_PROGRESS_READ]	= "read",
+	[FLASHROM_PROGRESS_WRITE]	= "write",
+	[FLASHROM_PROGRESS_ERASE]	= "erase",
+};
+
+/* Forwards progress to the client, at most once per percent and stage. */
+static void progress_to_client(enum flashrom_progress_stage stage, size_t current, size_t total, void *user_data)
+{
+	struct client *const client = user_data;
+
+	if (stage >= FLASHROM_PROGRESS_NR || !total)
+		return;
+	const unsigned int percent = current * 100 / total;
+	if (stage == client->stage && percent == client->percent)
+		return;
+	client->stage = stage;
+	client->percent = percent;
+	reply(client, "progress %s %zu %zu", stage_names[stage], current, total);
+}
+
+static void forget_contents(struct session *session)
+{
+	free(session->contents);
+	session->contents = NULL;
+}
+
+static void remember_contents(struct session *session, const uint8_t *buf)
+{
+	if (!session->contents)
+		session->contents = malloc(session->size);
+	if (session->contents)
+		memcpy(session->contents, buf, session->size);
+}
+
+/*
+ * Compares a few blocks spread over the chip, at random offsets, with the
+ * remembered contents. The chip may have been changed by other means since
+ * they were taken, and writing against stale contents would skip blocks that
+ * need to be written. Contents that don't match or can't be checked are
+ * dropped, so that the write reads the chip.
+ */
+static void check_contents(struct session *session)
+{
+	if (!session->contents)
+		return;
+
+	const size_t len = session->size < CHECK_SAMPLE_LEN ? session->size : CHECK_SAMPLE_LEN;
+	const size_t stride = session->size / CHECK_SAMPLES;
+	uint8_t *const buf = malloc(len);
+	bool match = buf != NULL;
+
+	for (size_t i = 0; match && i < CHECK_SAMPLES; i++) {
+		size_t start = i * stride;
+		if (stride > len)
+			start += rand() % (stride - len);
+		if (start > session->size - len)
+			start = session->size - len;
+		match = !flashrom_region_read(session->flash, start, len, buf) &&
+			!memcmp(buf, session->contents + start, len);
+	}
+	free(buf);
+
+	if (!match) {
+		fprintf(stderr, "Remembered contents do not match the chip, reading it again.\n");
+		forget_contents(session);
+	}
+}
+
+static void release_chip(struct session *session)
+{
+	forget_contents(session);
+	flashrom_flash_release(session->flash);
+	session->flash = NULL;
+	session->size = 0;
+}
+
+static void end_session(struct session *session)
+{
+	release_chip(session);
+	if (session->initialized) {
+		flashrom_programmer_shutdown(session->prog);
+		session->initialized = false;
+	}
+}
+
+static int read_file(const char *path, uint8_t *buf, size_t size)
+{
+	FILE *const file = fopen(path, "rb");
+	if (!file)
+		return 1;
+
+	int ret = 0;
+	struct stat st;
+	if (fstat(fileno(file), &st) || (size_t)st.st_size != size || fread(buf, 1, size, file) != size)
+		ret = 1;
+	fclose(file);
+	return ret;
+}
+
+static int write_file(const char *path, const uint8_t *buf, size_t size)
+{
+	FILE *const file = fopen(path, "wb");
+	if (!file)
+		return 1;
+
+	int ret = fwrite(buf, 1, size, file) != size;
+	if (fclose(file))
+		ret = 1;
+	return ret;
+}
+
+static void do_init(struct session *session, struct client *client, char *arg)
+{
+	if (!arg) {
+		reply(client, "error missing programmer");
+		return;
+	}
+	if (session->initialized) {
+		reply(client, "error programmer already initialized");
+		return;
+	}
+
+	char *const params = strchr(arg, ':');
+	if (params)
+		*params = '\0';
+	if (flashrom_programmer_init(&session->prog, arg, params ? params + 1 : NULL)) {
+		/* A failed init may have registered shutdown functions. */
+		flashrom_programmer_shutdown(session->prog);
+		reply(client, "error programmer initialization failed");
+		return;
+	}
+	session->initialized = true;
+	reply(client, "ok");
+}
+
+static void do_probe(struct session *session, struct client *client, const char *chip_name)
+{
+	const char **matched = NULL;
+
+	if (!session->initialized) {
+		reply(client, "error no programmer initialized");
+		return;
+	}
+	release_chip(session);
+	if (flashrom_create_context(&session->flash)) {
+		reply(client, "error out of memory");
+		return;
+	}
+
+	const int count = flashrom_flash_probe_v2(session->flash, &matched, session->prog, chip_name);
+	if (count == 1) {
+		session->size = flashrom_flash_getsize(session->flash);
+		flashrom_flag_set(session->flash, FLASHROM_FLAG_VERIFY_AFTER_WRITE, true);
+		flashrom_flag_set(session->flash, FLASHROM_FLAG_VERIFY_WHOLE_CHIP, true);
+		reply(client, "ok %zu %s", session->size, matched[0]);
+	} else {
+		release_chip(session);
+		if (count < 0)
+			reply(client, "error probing failed");
+		else if (count == 0)
+			reply(client, "error no flash chip found");
+		else
+			reply(client, "error %d flash chips match, specify one", count);
+	}
+	flashrom_data_free(matched);
+}
+
+static void do_read(struct session *session, struct client *client, const char *path)
+{
+	if (!path) {
+		reply(client, "error missing file");
+		return;
+	}
+
+	uint8_t *const buf = malloc(session->size);
+	if (!buf) {
+		reply(client, "error out of memory");
+		return;
+	}
+
+	if (flashrom_image_read(session->flash, buf, session->size)) {
+		reply(client, "error read failed");
+		goto out;
+	}
+	remember_contents(session, buf);
+
+	if (write_file(path, buf, session->size))
+		reply(client, "error writing \"%s\" failed: %s", path, strerror(errno));
+	else
+		reply(client, "ok");
+out:
+	free(buf);
+}
+
+static void do_write_or_verify(struct session *session, struct client *client, const char *path, bool write)
+{
+	if (!path) {
+		reply(client, "error missing file");
+		return;
+	}
+
+	uint8_t *const buf = malloc(session->size);
+	if (!buf) {
+		reply(client, "error out of memory");
+		return;
+	}
+	if (read_file(path, buf, session->size)) {
+		reply(client, "error \"%s\" can not be read or does not match the chip size", path);
+		goto out;
+	}
+
+	int ret;
+	if (write) {
+		check_contents(session);
+		ret = flashrom_image_write(session->flash, buf, session->size, session->contents);
+	}
+	else
+		ret = flashrom_image_verify(session->flash, buf, session->size);
+
+	if (ret) {
+		forget_contents(session);
+		reply(client, "error %s failed", write ? "write" : "verify");
+	} else {
+		/* Writes are verified, so the chip now holds exactly the image. */
+		remember_contents(session, buf);
+		reply(client, "ok");
+	}
+out:
+	free(buf);
+}
+
+static void do_erase(struct session *session, struct client *client)
+{
+	forget_contents(session);
+	if (flashrom_flash_erase(session->flash))
+		reply(client, "error erase failed");
+	else
+		reply(client, "ok");
+}
+
+static const char *const wp_mode_names[] = {
+	[FLASHROM_WP_MODE_DISABLED]	= "disabled",
+	[FLASHROM_WP_MODE_HARDWARE]	= "hardware",
+	[FLASHROM_WP_MODE_POWER_CYCLE]	= "power_cycle",
+	[FLASHROM_WP_MODE_PERMANENT]	= "permanent",
+};
+
+static void do_wp(struct session *session, struct client *client, const char *cmd)
+{
+	struct flashrom_wp_cfg *cfg = NULL;
+	enum flashrom_wp_result ret = flashrom_wp_cfg_new(&cfg);
+
+	if (ret == FLASHROM_WP_OK)
+		ret = flashrom_wp_read_cfg(cfg, session->flash);
+	if (ret == FLASHROM_WP_OK && strcmp(cmd, "wp-status")) {
+		flashrom_wp_set_mode(cfg, strcmp(cmd, "wp-enable") ?
+					  FLASHROM_WP_MODE_DISABLED : FLASHROM_WP_MODE_HARDWARE);
+		ret = flashrom_wp_write_cfg(session->flash, cfg);
+	}
+
+	if (ret != FLASHROM_WP_OK) {
+		reply(client, "error write protection operation failed (%d)", ret);
+	} else {
+		size_t start, len;
+		flashrom_wp_get_range(&start, &len, cfg);
+		reply(client, "ok mode=%s start=0x%zx len=0x%zx",
+		      wp_mode_names[flashrom_wp_get_mode(cfg)], start, len);
+	}
+	flashrom_wp_cfg_release(cfg);
+}
+
+/* Handles one request. Returns false if the client asked to close the connection. */
+static bool handle_request(struct session *session, struct client *client, char *line)
+{
+	char *saveptr = NULL;
+	const char *const cmd = strtok_r(line, " \t\r\n", &saveptr);
+	char *const arg = strtok_r(NULL, "\r\n", &saveptr);
+
+	if (!cmd)
+		return true;
+
+	if (!strcmp(cmd, "quit")) {
+		reply(client, "ok");
+		return false;
+	}
+	if (!strcmp(cmd, "init")) {
+		do_init(session, client, arg);
+		return true;
+	}
+	if (!strcmp(cmd, "shutdown")) {
+		end_session(session);
+		reply(client, "ok");
+		return true;
+	}
+	if (!strcmp(cmd, "probe")) {
+		do_probe(session, client, arg);
+		return true;
+	}
+
+	if (!session->flash) {
+		reply(client, "error no flash chip probed");
+		return true;
+	}
+
+	client->stage = FLASHROM_PROGRESS_NR;
+	flashrom_set_progress_callback_v2(session->flash, progress_to_client, client);
+	if (!strcmp(cmd, "read"))
+		do_read(session, client, arg);
+	else if (!strcmp(cmd, "write"))
+		do_write_or_verify(session, client, arg, true);
+	else if (!strcmp(cmd, "verify"))
+		do_write_or_verify(session, client, arg, false);
+	else if (!strcmp(cmd, "erase"))
+		do_erase(session, client);
+	else if (!strcmp(cmd, "wp-status") || !strcmp(cmd, "wp-enable") || !strcmp(cmd, "wp-disable"))
+		do_wp(session, client, cmd);
+	else
+		reply(client, "error unknown command \"%s\"", cmd);
+	flashrom_set_progress_callback_v2(session->flash, NULL, NULL);
+	return true;
+}
+
+static void serve_client(struct session *session, int fd)
+{
+	const int out_fd = dup(fd);
+	FILE *const in = fdopen(fd, "r");
+	struct client client = { .out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL };
+
+	if (!in || !client.out) {
+		fprintf(stderr, "Setting up client connection failed: %s\n", strerror(errno));
+		if (in)
+			fclose(in);
+		else
+			close(fd);
+		if (client.out)
+			fclose(client.out);
+		else if (out_fd >= 0)
+			close(out_fd);
+		return;
+	}
+
+	/* A signal must not cut short any delay while the chip is accessed. */
+	sigset_t signals;
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+
+	char line[REQUEST_MAX];
+	while (!terminate && fgets(line, sizeof(line), in)) {
+		if (!strchr(line, '\n') && !feof(in)) {
+			reply(&client, "error request too long");
+			break;
+		}
+		sigprocmask(SIG_BLOCK, &signals, NULL);
+		const bool keep_open = handle_request(session, &client, line);
+		sigprocmask(SIG_UNBLOCK, &signals, NULL);
+		if (!keep_open)
+			break;
+	}
+
+	fclose(in);
+	fclose(client.out);
+}
+
+static int open_socket(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path \"%s\" is too long.\n", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	/* Replace the socket of an earlier daemon, but nothing else. */
+	struct stat st;
+	if (!lstat(path, &st)) {
+		if (!S_ISSOCK(st.st_mode)) {
+			fprintf(stderr, "\"%s\" exists and is not a socket, refusing to replace it.\n", path);
+			return -1;
+		}
+		unlink(path);
+	}
+
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		fprintf(stderr, "Creating socket failed: %s\n", strerror(errno));
+		return -1;
+	}
+	/* Only the user running the daemon may connect, see README.md. */
+	const mode_t old_mask = umask(0177);
+	const int ret = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+	umask(old_mask);
+	if (ret || listen(fd, 4)) {
+		fprintf(stderr, "Listening on \"%s\" failed: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-V[V[V]]] <socket>\n", name);
+	exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+	struct session session = { 0 };
+	int opt;
+
+	while ((opt = getopt(argc, argv, "V")) != -1) {
+		switch (opt) {
+		case 'V':
+			if (log_level < FLASHROM_MSG_SPEW)
+				log_level++;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc - 1)
+		usage(argv[0]);
+	const char *const socket_path = argv[optind];
+
+	flashrom_set_log_callback_v2(log_to_stderr, NULL);
+	if (flashrom_init(1))
+		return 1;
+
+	const struct sigaction sa = { .sa_handler = handle_signal };
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+
+	const int listen_fd = open_socket(socket_path);
+	if (listen_fd < 0)
+		return 1;
+
+	/* Samples of check_contents() differ between runs. */
+	srand(time(NULL) ^ getpid());
+
+	/* Clients are served one after another, they share the session. */
+	int ret = 0;
+	while (!terminate) {
+		const int fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0) {
+			const int err = errno;
+			if (err == EINTR || err == ECONNABORTED)
+				continue;
+			fprintf(stderr, "Accepting connection failed: %s\n", strerror(err));
+			/* Running out of descriptors or memory may pass, anything else will not. */
+			if (err == EMFILE || err == ENFILE || err == ENOBUFS || err == ENOMEM) {
+				sleep(1);
+				continue;
+			}
+			ret = 1;
+			break;
+		}
+		serve_client(&session, fd);
+	}
+
+	end_session(&session);
+	close(listen_fd);
+	unlink(socket_path);
+	flashrom_shutdown();
+	return ret;
+}
@@ -0,0 +1,162 @@
+/*
+ * This file is part of the flashrom project.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ * SPDX-FileCopyrightText: 2026 The flashrom authors
+ */
+
+/*
+ * Protocol test of flashromd against the dummy programmer. The daemon is built
+ * into this test, so requests are handled in-process and the session can be
+ * inspected between them.
+ */
+
+int flashromd_main(int argc, char *argv[]);
+#define main flashromd_main
+#include "flashromd.c"
+#undef main
+
+#define CHIP_SIZE	(128 * 1024)
+
+static int failures;
+
+#define check(cond) do { \
+	if (!(cond)) { \
+		fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+		failures++; \
+	} \
+} while (0)
+
+static char dir[] = "/tmp/flashromd_test.XXXXXX";
+
+static char *path_in_dir(const char *name)
+{
+	static char path[sizeof(dir) + 32];
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	return path;
+}
+
+/* Sends one request and returns the final response line of the daemon. */
+static const char *request(struct session *session, const char *fmt, ...)
+{
+	static char last[REQUEST_MAX];
+	char line[REQUEST_MAX];
+	char *buf = NULL;
+	size_t len = 0;
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(line, sizeof(line), fmt, ap);
+	va_end(ap);
+
+	struct client client = { .out = open_memstream(&buf, &len) };
+	if (!client.out)
+		exit(1);
+	handle_request(session, &client, line);
+	fclose(client.out);
+
+	/* Skip progress lines, keep the final one without its newline. */
+	char *const end = len ? buf + len - 1 : buf;
+	*end = '\0';
+	char *const start = strrchr(buf, '\n');
+	snprintf(last, sizeof(last), "%s", start ? start + 1 : buf);
+	free(buf);
+	return last;
+}
+
+static void fill_image(const char *name, uint8_t *buf, uint8_t seed)
+{
+	for (size_t i = 0; i < CHIP_SIZE; i++)
+		buf[i] = seed + i * 7;
+	if (write_file(path_in_dir(name), buf, CHIP_SIZE))
+		exit(1);
+}
+
+static void test_open_socket(void)
+{
+	const char *const path = path_in_dir("sock");
+	struct stat st;
+
+	/* A regular file in the way stays untouched. */
+	check(!write_file(path, (const uint8_t *)"data", 4));
+	check(open_socket(path) < 0);
+	check(!lstat(path, &st) && S_ISREG(st.st_mode) && st.st_size == 4);
+	unlink(path);
+
+	/* The socket is only accessible by its owner. */
+	int fd = open_socket(path);
+	check(fd >= 0);
+	check(!lstat(path, &st) && S_ISSOCK(st.st_mode) && (st.st_mode & 0777) == 0600);
+	close(fd);
+
+	/* The socket of an earlier daemon is replaced. */
+	fd = open_socket(path);
+	check(fd >= 0);
+	close(fd);
+	unlink(path);
+}
+
+static void test_protocol(void)
+{
+	struct session session = { 0 };
+	static uint8_t image_a[CHIP_SIZE], image_b[CHIP_SIZE], buf[CHIP_SIZE];
+
+	fill_image("a.rom", image_a, 0x11);
+	fill_image("b.rom", image_b, 0x22);
+	/* b differs from a in its first half only. */
+	memcpy(image_b + CHIP_SIZE / 2, image_a + CHIP_SIZE / 2, CHIP_SIZE / 2);
+	check(!write_file(path_in_dir("b.rom"), image_b, CHIP_SIZE));
+
+	check(!strcmp(request(&session, "read %s", path_in_dir("out.rom")), "error no flash chip probed"));
+	check(!strcmp(request(&session, "probe"), "error no programmer initialized"));
+	check(!strcmp(request(&session, "init dummy:bus=spi,emulate=M25P10.RES"), "ok"));
+	check(!strcmp(request(&session, "probe"), "ok 131072 M25P10"));
+
+	check(!strcmp(request(&session, "write %s", path_in_dir("a.rom")), "ok"));
+	check(session.contents && !memcmp(session.contents, image_a, CHIP_SIZE));
+	check(!strcmp(request(&session, "verify %s", path_in_dir("a.rom")), "ok"));
+
+	/*
+	 * The chip changes behind the back of the daemon, which still remembers a.
+	 * Writing b against that stale reference would leave the second half
+	 * alone. The sampled check notices the change, so the chip is read first
+	 * and the write succeeds.
+	 */
+	memset(buf, 0x5a, sizeof(buf));
+	check(!flashrom_image_write(session.flash, buf, CHIP_SIZE, NULL));
+	check(!strcmp(request(&session, "write %s", path_in_dir("b.rom")), "ok"));
+	check(session.contents && !memcmp(session.contents, image_b, CHIP_SIZE));
+	check(!strcmp(request(&session, "read %s", path_in_dir("out.rom")), "ok"));
+	check(!read_file(path_in_dir("out.rom"), buf, CHIP_SIZE) && !memcmp(buf, image_b, CHIP_SIZE));
+
+	check(!strncmp(request(&session, "write %s", path_in_dir("missing.rom")), "error ", 6));
+	check(!strcmp(request(&session, "erase"), "ok"));
+	check(!session.contents);
+	check(!strcmp(request(&session, "frobnicate"), "error unknown command \"frobnicate\""));
+	check(!strcmp(request(&session, "shutdown"), "ok"));
+	check(!session.initialized && !session.flash);
+
+	end_session(&session);
+}
+
+int main(void)
+{
+	if (!mkdtemp(dir))
+		return 1;
+
+	flashrom_set_log_callback_v2(log_to_stderr, NULL);
+	if (flashrom_init(1))
+		return 1;
+
+	test_open_socket();
+	test_protocol();
+
+	flashrom_shutdown();
+	unlink(path_in_dir("a.rom"));
+	unlink(path_in_dir("b.rom"));
+	unlink(path_in_dir("out.rom"));
+	rmdir(dir);
+
+	return failures ? 1 : 0;
+}